@@ -1,12 +1,82 @@
 // Sudoku solver
 #include <stdio.h>      // For standard IO
 #include <stdlib.h>     // For standard stuff
-#include <string.h>     // strlen
+#include <string.h>     // strlen, strcmp, strspn
 #include <getopt.h>     // getopt_long
 
 #include <time.h>       // For program timing
+#include <stdint.h>     // uintmax_t
 
 #include "sudoku_general_tools.h"
+#include "sudoku_batch.h"
+#include "sudoku_parallel.h"
+#include "sudoku_kernel.h"
+#include "sudoku_generate.h"
+#include "sudoku_bench.h"
+#include "sudoku_pack.h"
+#include "sudoku_daemon.h"
+#include "sudoku_cache.h"
+
+/**
+    Solves a copy of the input sudoku, on several threads if asked to.
+
+    @param {sudoku_field*} s - Input sudoku to solve.
+    @param {int} engine - The engine to solve with.
+    @param {int} threads - Number of threads.
+    @return {sudoku_field*} - A solved sudoku if successful. NULL otherwise.
+*/
+static sudoku_field* solve_copy(const sudoku_field* s, int engine, int threads){
+    sudoku_field* ret;
+    if(threads == 1)
+        return init_sudoku_solve_engine(s, engine);
+    ret = copy_sudoku_field(s);
+    if(sudoku_solve_parallel(ret, engine, threads) == NULL){
+        free_sudoku_field(ret);
+        return NULL;
+    }
+    return ret;
+}
+/**
+    Solves and prints a sudoku of a size chosen at runtime.
+
+    @param {char*} sudoku_str - The puzzle, size*size characters.
+    @param {int} size - Number of rows.
+    @param {int} iterations - Number of times to solve it, for timing.
+    @param {int} threads - Number of threads.
+    @return {int} - 0 if solved. Non-zero otherwise.
+*/
+static int solve_sized_main(const char* sudoku_str, int size, int iterations, int threads){
+    char solution[SUDOKU_MAX_SIZE * SUDOKU_MAX_SIZE];
+    clock_t sudoku_timing_start;
+    clock_t sudoku_timing_end;
+    int ret = 0;
+    int i, r;
+
+    if(strlen(sudoku_str) != (size_t) (size * size)){
+        fprintf(stderr, "Input Sudoku not correct size. Line %d. Exiting...\n",__LINE__);
+        exit(1);
+    }
+    printf("Solving %dx%d sudoku. A total of %d iterations will be made...\n", size, size, iterations);
+    if(threads != 1)
+        printf("Solving on %d threads.\n", threads);
+    sudoku_timing_start = clock();
+    ret = sudoku_solve_sized_parallel(size, sudoku_str, solution, threads); // At least once, whatever iterations is.
+    for(i = 1; i < iterations; i++)
+        ret = sudoku_solve_sized_parallel(size, sudoku_str, solution, threads);
+    sudoku_timing_end = clock();
+
+    if(ret == SUDOKU_SIZED_BAD_INPUT){
+        printf("Sudoku could not be read.\n");
+    }else if(ret == SUDOKU_SIZED_UNSOLVABLE){
+        printf("Sudoku not solvable.\n");
+    }else{
+        printf("Sudoku solved:\n");
+        for(r = 0; r < size; r++)
+            printf(" %.*s\n", size, solution + r * size);
+    }
+    printf("Execution time: %.3f In clock_t: %ju\n", (double) (sudoku_timing_end - sudoku_timing_start)/CLOCKS_PER_SEC,  (uintmax_t) (sudoku_timing_end - sudoku_timing_start) );
+    return ret;
+}
 /**
     Main
 */
@@ -21,11 +91,83 @@ int main(int argc, char* argv[])
           {"size",     required_argument,      NULL, 's'},
           {"sudoku",  required_argument,       NULL, 'f'},
           {"iterations",  optional_argument, NULL, 'i'},
+          {"engine",  required_argument,       NULL, 'e'},
+          {"batch",  optional_argument,        NULL, 'b'},
+          {"threads",  required_argument,      NULL, 't'},
+          {"count",  optional_argument,        NULL, 'c'},
+          {"generate",  required_argument,     NULL, 'g'},
+          {"clues",  required_argument,        NULL, 'k'},
+          {"symmetry",  required_argument,     NULL, 'y'},
+          {"seed",  required_argument,         NULL, 'r'},
+          {"bench",  required_argument,        NULL, 'B'},
+          {"warmup",  required_argument,       NULL, 'w'},
+          {"format",  required_argument,       NULL, 'F'},
+          {"packed",  no_argument,             NULL, 'p'},
+          {"pack",  required_argument,         NULL, 'P'},
+          {"unpack",  required_argument,       NULL, 'U'},
+          {"daemon",  required_argument,       NULL, 'D'},
+          {"cache",  required_argument,        NULL, 'C'},
+          {"verify",  required_argument,       NULL, 'V'},
+          {"pipeline",  no_argument,           NULL, 'Q'},
+          {"max-nodes",  required_argument,    NULL, 'N'},
+          {"time-limit",  required_argument,   NULL, 'T'},
+          {"retry-engine",  required_argument, NULL, 'R'},
+          {"portfolio",  optional_argument,    NULL, 'O'},
           {NULL, 0, NULL, 0}
         };
     // Input variables (aka, almost flags or something)
     int iterations = 1;
     int i;
+    int engine = SUDOKU_ENGINE_DEFAULT;
+    int batch = 0;
+    int threads = 1;
+    int size = 0; // 0 uses the sudoku_field engines, other sizes the sized kernels.
+    int count_limit = 0; // 0 solves, otherwise solutions are counted up to it.
+    int count;
+    long generate = 0; // Number of puzzles to generate.
+    int symmetry;
+    sudoku_generate_opts gen_opts;
+    sudoku_generate_stats gen_stats;
+    const char* batch_path = NULL; // NULL or "-" reads from stdin.
+    const char* bench_path = NULL; // Corpus to benchmark, "-" reads from stdin.
+    int bench_engines[SUDOKU_ENGINE_COUNT]; // Every -e given, in order.
+    int n_bench_engines = 0;
+    int bench_format = SUDOKU_BENCH_TEXT;
+    FILE* bench_in;
+    sudoku_bench_corpus bench_corpus;
+    sudoku_bench_opts bench_opts;
+    sudoku_bench_result bench_results[SUDOKU_ENGINE_COUNT];
+#ifdef SUDOKU_STATS
+    sudoku_search_stats search_stats;
+#endif
+    const char* sudoku_str = NULL;
+    FILE* batch_in;
+    int packed = 0; // Batch solutions are written as a packed file.
+    const char* pack_path = NULL; // Text puzzles to convert to a packed file.
+    const char* unpack_path = NULL; // Packed file to convert to text.
+    FILE* pack_in;
+    long pack_skipped;
+    int pack_ret;
+    const char* daemon_path = NULL; // Socket to serve requests on.
+    sudoku_daemon_opts daemon_opts;
+    sudoku_daemon_stats daemon_stats;
+    int cache_size = 0; // Entries of the batch solution cache, 0 for none.
+    int pipeline = 0; // Batch reading, solving and writing run at the same time.
+    long long max_nodes = 0; // Search nodes allowed per puzzle, 0 for no limit.
+    double max_seconds = 0; // Time allowed per puzzle, 0 for no limit.
+    int retry_engine = -1; // Engine for puzzles over budget, -1 for none.
+    int portfolio = 0; // Racers of a portfolio solve, 0 for none.
+    sudoku_racer racers[SUDOKU_PORTFOLIO_MAX];
+    su_engine_t race_engines[SUDOKU_ENGINE_COUNT]; // The -e engines, if given.
+    sudoku_solve_ctl solve_ctl;
+    sudoku_solve_ctl* budget = NULL; // &solve_ctl if a budget is given.
+    int solve_status = SUDOKU_SOLVE_UNSOLVABLE;
+    int race_winner = -1;
+    sudoku_batch_opts batch_opts;
+    sudoku_batch_stats batch_stats;
+    const char* verify_path = NULL; // Solutions to verify, "-" reads from stdin.
+    FILE* verify_puzzles = NULL; // Puzzles of the solutions, if given.
+    sudoku_verify_stats verify_stats;
 
     // Sudoku
     sudoku_field* s = NULL;
@@ -34,13 +176,18 @@ int main(int argc, char* argv[])
     clock_t sudoku_timing_start; // Counts CPU cycles. Use the macro CLOCKS_PER_SEC to convert to real time
     clock_t sudoku_timing_end;
 
+    bench_opts.warmup = 1;
+    gen_opts.clues = 25;
+    gen_opts.symmetry = SUDOKU_SYM_NONE;
+    gen_opts.seed = (uint64_t) time(NULL);
+
     // INPUT-HANDLING HERE
 
     while(1){
     /* getopt_long stores the option index here. */
       option_index = 0;
 
-      option_info = getopt_long (argc, argv, "s:f:i::",
+      option_info = getopt_long (argc, argv, "s:f:i::e:b::t:c::g:k:y:r:B:w:F:pP:U:D:C:V:QN:T:R:O::",
                        long_options, &option_index);
 
       /* Detect the end of the options. */
@@ -60,27 +207,158 @@ int main(int argc, char* argv[])
           break;
 
         case 's':
-            printf("Sudoku size set to %d, but will be 9 anyway since this\n options hasn't been properly implemented yet.\n", atoi(optarg) );
+            size = atoi(optarg);
+            if(!sudoku_size_supported(size)){
+                fprintf(stderr, "Sudoku size %d not supported, use 4, 9, 16 or 25. Line %d. Exiting...\n", size, __LINE__);
+                exit(1);
+            }
             break;
 
         case 'f':
-          printf("Reading Sudoku from input\n");
-          if(strlen(optarg) != (SUDOKU_SIZE * SUDOKU_SIZE)){
-            fprintf(stderr, "Input Sudoku not correct size. Line %d. Exiting...\n",__LINE__);
-            exit(1);
-          }
-          s = sudoku_from_input(optarg);
+          sudoku_str = optarg;
           break;
 
         case 'i':
             if(optarg != NULL){
                 iterations = atoi(optarg);
-                printf ("Number of iterations set to %d.\n", iterations);
-
             }else{
-                printf("Number of iterations set to its default value (30000).\n");
                 iterations = 30000;
             }
+            if(iterations < 1){
+                fprintf(stderr, "Number of iterations must be at least 1. Line %d. Exiting...\n", __LINE__);
+                exit(1);
+            }
+            break;
+        case 'e':
+            engine = sudoku_engine_from_name(optarg);
+            if(engine < 0){
+                fprintf(stderr, "Unknown solver engine %s. Line %d. Exiting...\n", optarg, __LINE__);
+                exit(1);
+            }
+            for(i = 0; i < n_bench_engines && bench_engines[i] != engine; i++)
+                ;
+            if(i == n_bench_engines)
+                bench_engines[n_bench_engines++] = engine;
+            break;
+        case 'b':
+            batch = 1;
+            batch_path = optarg;
+            break;
+        case 't':
+            threads = atoi(optarg);
+            if(threads < 1){
+                fprintf(stderr, "Number of threads must be at least 1. Line %d. Exiting...\n", __LINE__);
+                exit(1);
+            }
+            break;
+        case 'c':
+            if(optarg == NULL && optind < argc && argv[optind][0] != '\0'
+                    && strspn(argv[optind], "0123456789") == strlen(argv[optind]))
+                optarg = argv[optind++]; // Allows "--count 5" as well as "--count=5".
+            count_limit = optarg != NULL ? atoi(optarg) : SUDOKU_COUNT_MULTIPLE;
+            if(count_limit < 1){
+                fprintf(stderr, "Solution count limit must be at least 1. Line %d. Exiting...\n", __LINE__);
+                exit(1);
+            }
+            break;
+        case 'g':
+            generate = atol(optarg);
+            if(generate < 1){
+                fprintf(stderr, "Number of puzzles to generate must be at least 1. Line %d. Exiting...\n", __LINE__);
+                exit(1);
+            }
+            break;
+        case 'k':
+            gen_opts.clues = atoi(optarg);
+            if(gen_opts.clues < 17 || gen_opts.clues > SUDOKU_CELLS){
+                fprintf(stderr, "Number of clues must be between 17 and %d. Line %d. Exiting...\n", SUDOKU_CELLS, __LINE__);
+                exit(1);
+            }
+            break;
+        case 'y':
+            symmetry = sudoku_symmetry_from_name(optarg);
+            if(symmetry < 0){
+                fprintf(stderr, "Unknown symmetry %s, use none, central, rotational or mirror. Line %d. Exiting...\n", optarg, __LINE__);
+                exit(1);
+            }
+            gen_opts.symmetry = symmetry;
+            break;
+        case 'r':
+            gen_opts.seed = strtoull(optarg, NULL, 10);
+            break;
+        case 'B':
+            bench_path = optarg;
+            break;
+        case 'w':
+            bench_opts.warmup = atoi(optarg);
+            if(bench_opts.warmup < 0){
+                fprintf(stderr, "Number of warmup passes can't be negative. Line %d. Exiting...\n", __LINE__);
+                exit(1);
+            }
+            break;
+        case 'F':
+            bench_format = sudoku_bench_format_from_name(optarg);
+            if(bench_format < 0){
+                fprintf(stderr, "Unknown format %s, use text, csv or json. Line %d. Exiting...\n", optarg, __LINE__);
+                exit(1);
+            }
+            break;
+        case 'p':
+            packed = 1;
+            break;
+        case 'P':
+            pack_path = optarg;
+            break;
+        case 'U':
+            unpack_path = optarg;
+            break;
+        case 'D':
+            daemon_path = optarg;
+            break;
+        case 'C':
+            cache_size = atoi(optarg);
+            if(cache_size < 1){
+                fprintf(stderr, "Cache size must be at least 1. Line %d. Exiting...\n", __LINE__);
+                exit(1);
+            }
+            break;
+        case 'V':
+            verify_path = optarg;
+            break;
+        case 'Q':
+            pipeline = 1;
+            break;
+        case 'N':
+            max_nodes = atoll(optarg);
+            if(max_nodes < 1){
+                fprintf(stderr, "Node budget must be at least 1. Line %d. Exiting...\n", __LINE__);
+                exit(1);
+            }
+            break;
+        case 'T':
+            max_seconds = atof(optarg) / 1000;
+            if(max_seconds <= 0){
+                fprintf(stderr, "Time limit must be a positive number of milliseconds. Line %d. Exiting...\n", __LINE__);
+                exit(1);
+            }
+            break;
+        case 'R':
+            retry_engine = sudoku_engine_from_name(optarg);
+            if(retry_engine < 0){
+                fprintf(stderr, "Unknown solver engine %s. Line %d. Exiting...\n", optarg, __LINE__);
+                exit(1);
+            }
+            break;
+        case 'O':
+            portfolio = -1; // Set from the threads once every option is read.
+            if(optarg != NULL){
+                portfolio = atoi(optarg);
+                if(portfolio < 1 || portfolio > SUDOKU_PORTFOLIO_MAX){
+                    fprintf(stderr, "Number of racers must be 1 to %d. Line %d. Exiting...\n",
+                                    SUDOKU_PORTFOLIO_MAX, __LINE__);
+                    exit(1);
+                }
+            }
             break;
         case '?':
           /* getopt_long already printed an error message. */
@@ -94,31 +372,330 @@ int main(int argc, char* argv[])
     }
 
 
+    if(count_limit && size != 0){
+        fprintf(stderr, "Solutions can only be counted for %dx%d sudokus. Line %d. Exiting...\n", SUDOKU_SIZE, SUDOKU_SIZE, __LINE__);
+        exit(1);
+    }
+    // Counting always runs the prop search, one thread per puzzle.
+    if(count_limit && (n_bench_engines || (threads != 1 && !batch) || portfolio || retry_engine >= 0 || cache_size)){
+        fprintf(stderr, "Solutions are counted without -e, --portfolio, -R or --cache, and with -t only in batch mode. Line %d. Exiting...\n", __LINE__);
+        exit(1);
+    }
+
+    // The sized kernels have one engine, no budgets and no cache.
+    if(size != 0 && (n_bench_engines || max_nodes || max_seconds > 0 || retry_engine >= 0)){
+        fprintf(stderr, "Engines and search budgets only work on %dx%d sudokus. Line %d. Exiting...\n", SUDOKU_SIZE, SUDOKU_SIZE, __LINE__);
+        exit(1);
+    }
+    if(size != 0 && (cache_size || portfolio)){
+        fprintf(stderr, "The cache and portfolios only work on %dx%d sudokus. Line %d. Exiting...\n", SUDOKU_SIZE, SUDOKU_SIZE, __LINE__);
+        exit(1);
+    }
+
+    if(count_limit && packed){
+        fprintf(stderr, "Solution counts can't be written packed. Line %d. Exiting...\n", __LINE__);
+        exit(1);
+    }
+
+    bench_opts.passes = iterations;
+    bench_opts.threads = threads;
+
+    // Benchmark mode. Only the results go to stdout.
+    if(bench_path != NULL){
+        if(size != 0){
+            fprintf(stderr, "Only %dx%d sudokus can be benchmarked. Line %d. Exiting...\n", SUDOKU_SIZE, SUDOKU_SIZE, __LINE__);
+            exit(1);
+        }
+        if(strcmp(bench_path, "-") == 0){
+            bench_in = stdin;
+        }else if((bench_in = fopen(bench_path, "r")) == NULL){
+            fprintf(stderr, "Could not open %s. Line %d. Exiting...\n", bench_path, __LINE__);
+            exit(1);
+        }
+        if(load_sudoku_bench_corpus(bench_in, &bench_corpus) || bench_corpus.count == 0){
+            fprintf(stderr, "No puzzles read from %s. Line %d. Exiting...\n", bench_path, __LINE__);
+            exit(1);
+        }
+        if(bench_in != stdin)
+            fclose(bench_in);
+        if(n_bench_engines == 0){ // Every engine by default.
+            for(n_bench_engines = 0; n_bench_engines < SUDOKU_ENGINE_COUNT; n_bench_engines++)
+                bench_engines[n_bench_engines] = n_bench_engines;
+        }
+        for(i = 0; i < n_bench_engines; i++){
+            fprintf(stderr, "Benchmarking %s on %ld puzzles, %d warmup and %d timed passes...\n",
+                        sudoku_engine_name(bench_engines[i]), bench_corpus.count, bench_opts.warmup, bench_opts.passes);
+            sudoku_bench_run(&bench_corpus, bench_engines[i], &bench_opts, bench_results + i);
+        }
+        print_sudoku_bench_results(stdout, bench_results, n_bench_engines, bench_format);
+        free_sudoku_bench_corpus(&bench_corpus);
+        exit(0);
+    }
+
+    // Generator mode. Only puzzles go to stdout, the summary goes to stderr.
+    if(generate){
+        if(size != 0){
+            fprintf(stderr, "Only %dx%d sudokus can be generated. Line %d. Exiting...\n", SUDOKU_SIZE, SUDOKU_SIZE, __LINE__);
+            exit(1);
+        }
+        gen_opts.count = generate;
+        gen_opts.threads = threads;
+        fprintf(stderr, "Generating %ld puzzles with at most %d clues, seed %ju.\n",
+                    generate, gen_opts.clues, (uintmax_t) gen_opts.seed);
+        if(sudoku_generate(stdout, &gen_opts, &gen_stats)){
+            print_sudoku_generate_stats(stderr, &gen_stats);
+            fprintf(stderr, "Failure writing puzzles, or no puzzles with %d clues found. Line %d. Exiting...\n", gen_opts.clues, __LINE__);
+            exit(1);
+        }
+        print_sudoku_generate_stats(stderr, &gen_stats);
+        exit(0);
+    }
+
+    // Daemon mode. Runs until stopped with SIGINT or SIGTERM.
+    if(daemon_path != NULL){
+        daemon_opts.path = daemon_path;
+        daemon_opts.engine = engine;
+        daemon_opts.size = size;
+        daemon_opts.threads = threads;
+        daemon_opts.max_nodes = max_nodes;
+        daemon_opts.max_seconds = max_seconds;
+        daemon_opts.retry_engine = retry_engine;
+        fprintf(stderr, "Serving on %s with %d solver threads.\n", daemon_path, threads);
+        if(sudoku_daemon_run(&daemon_opts, &daemon_stats)){
+            fprintf(stderr, "Could not listen on %s. Line %d. Exiting...\n", daemon_path, __LINE__);
+            exit(1);
+        }
+        print_sudoku_daemon_stats(stderr, &daemon_stats);
+        exit(0);
+    }
+
+    // Conversion between text and packed files. The converted file goes to stdout.
+    if(pack_path != NULL || unpack_path != NULL){
+        if(pack_path != NULL && unpack_path != NULL){
+            fprintf(stderr, "Use either --pack or --unpack. Line %d. Exiting...\n", __LINE__);
+            exit(1);
+        }
+        if(strcmp(pack_path != NULL ? pack_path : unpack_path, "-") == 0){
+            pack_in = stdin;
+        }else if((pack_in = fopen(pack_path != NULL ? pack_path : unpack_path, "rb")) == NULL){
+            fprintf(stderr, "Could not open %s. Line %d. Exiting...\n", pack_path != NULL ? pack_path : unpack_path, __LINE__);
+            exit(1);
+        }
+        if(pack_path != NULL){
+            if(sudoku_pack_text(pack_in, stdout, size ? size : SUDOKU_SIZE, &pack_skipped)){
+                fprintf(stderr, "Failure reading or writing puzzles. Line %d. Exiting...\n", __LINE__);
+                exit(1);
+            }
+            if(pack_skipped)
+                fprintf(stderr, "Skipped %ld lines.\n", pack_skipped);
+        }else{
+            pack_ret = sudoku_unpack_text(pack_in, stdout);
+            if(pack_ret != SUDOKU_PACK_OK){
+                fprintf(stderr, "%s. Line %d. Exiting...\n",
+                            pack_ret == SUDOKU_PACK_BAD_HEADER ? "Not a packed puzzle file"
+                            : pack_ret == SUDOKU_PACK_BAD_SUM ? "Packed file does not match its checksum"
+                            : pack_ret == SUDOKU_PACK_BAD_RECORD ? "Packed file has a cell out of range"
+                            : "Failure reading or writing puzzles", __LINE__);
+                exit(1);
+            }
+        }
+        if(pack_in != stdin)
+            fclose(pack_in);
+        exit(0);
+    }
+
+    // Verify mode. Failing lines and the summary go to stderr, the exit
+    // status tells whether every grid passed.
+    if(verify_path != NULL){
+        if(strcmp(verify_path, "-") == 0){
+            batch_in = stdin;
+        }else if((batch_in = fopen(verify_path, "r")) == NULL){
+            fprintf(stderr, "Could not open %s. Line %d. Exiting...\n", verify_path, __LINE__);
+            exit(1);
+        }
+        if(optind < argc && (verify_puzzles = fopen(argv[optind], "r")) == NULL){
+            fprintf(stderr, "Could not open %s. Line %d. Exiting...\n", argv[optind], __LINE__);
+            exit(1);
+        }
+        if(sudoku_batch_verify(batch_in, verify_puzzles, &verify_stats)){
+            fprintf(stderr, "Failure reading solutions or puzzles. Line %d. Exiting...\n", __LINE__);
+            exit(1);
+        }
+        print_sudoku_verify_stats(stderr, &verify_stats);
+        if(verify_puzzles != NULL)
+            fclose(verify_puzzles);
+        if(batch_in != stdin)
+            fclose(batch_in);
+        exit(verify_stats.invalid || verify_stats.mismatched);
+    }
+
+    // Batch mode. Only solutions go to stdout, the summary goes to stderr.
+    if(batch){
+        if(batch_path == NULL && optind < argc)
+            batch_path = argv[optind]; // Allows "--batch file" as well as "--batch=file".
+        if(batch_path == NULL || strcmp(batch_path, "-") == 0){
+            batch_in = stdin;
+        }else if((batch_in = fopen(batch_path, "r")) == NULL){
+            fprintf(stderr, "Could not open %s. Line %d. Exiting...\n", batch_path, __LINE__);
+            exit(1);
+        }
+        batch_opts.engine = engine;
+        batch_opts.threads = threads;
+        batch_opts.size = size;
+        batch_opts.count_limit = count_limit;
+        batch_opts.packed = packed;
+        batch_opts.cache = NULL;
+        batch_opts.pipeline = pipeline;
+        batch_opts.max_nodes = max_nodes;
+        batch_opts.max_seconds = max_seconds;
+        batch_opts.retry_engine = retry_engine;
+        if(cache_size && (batch_opts.cache = init_sudoku_cache(cache_size)) == NULL){
+            fprintf(stderr, "Could not allocate the solution cache. Line %d. Exiting...\n", __LINE__);
+            exit(1);
+        }
+        if(sudoku_batch_solve(batch_in, stdout, &batch_opts, &batch_stats)){
+            fprintf(stderr, "Failure reading or writing puzzles. Line %d. Exiting...\n", __LINE__);
+            exit(1);
+        }
+        print_sudoku_batch_stats(stderr, &batch_stats);
+        if(batch_opts.cache != NULL){
+            print_sudoku_cache_stats(stderr, batch_opts.cache);
+            free_sudoku_cache(batch_opts.cache);
+        }
+        if(batch_in != stdin)
+            fclose(batch_in);
+        exit(0);
+    }
+
+    if(sudoku_str == NULL){
+        fprintf(stderr, "No Sudoku given, use -f or --batch. Line %d. Exiting...\n",__LINE__);
+        exit(1);
+    }
+    if(size != 0){
+        if(solve_sized_main(sudoku_str, size, iterations, threads) == SUDOKU_SIZED_BAD_INPUT)
+            exit(1);
+        exit(0);
+    }
+    // The tree split of -t has no budget, only the portfolio racers have.
+    if((max_nodes || max_seconds > 0) && threads != 1 && !portfolio){
+        fprintf(stderr, "Search budgets of a single sudoku need one thread or --portfolio. Line %d. Exiting...\n", __LINE__);
+        exit(1);
+    }
+    if(max_nodes || max_seconds > 0){
+        init_sudoku_solve_ctl(&solve_ctl);
+        solve_ctl.max_nodes = max_nodes;
+        solve_ctl.max_seconds = max_seconds;
+        budget = &solve_ctl;
+    }
+    printf("Reading Sudoku from input\n");
+    if(strlen(sudoku_str) != (SUDOKU_SIZE * SUDOKU_SIZE)){
+        fprintf(stderr, "Input Sudoku not correct size. Line %d. Exiting...\n",__LINE__);
+        exit(1);
+    }
+    s = alloc_sudoku_field();
+    switch(sudoku_read_line(s, sudoku_str)){
+        case(SUDOKU_LINE_OK):
+            break;
+        case(SUDOKU_LINE_CONFLICT):
+            printf("Input Sudoku has conflicting clues.\nSudoku not solvable.\n");
+            free_sudoku_field(s);
+            exit(0);
+        default:
+            fprintf(stderr, "Could not read sudoku from input, unknown character. Line %d. Exiting...\n", __LINE__);
+            exit(1);
+    }
+    if(count_limit){
+        printf("Counting solutions, up to %d...\n", count_limit);
+        sudoku_timing_start = clock();
+        count = sudoku_count_solutions(s, count_limit, budget);
+        sudoku_timing_end = clock();
+        if(budget != NULL && budget->stopped)
+            printf("Counting ran out of budget.\n");
+        else if(count == 0)
+            printf("Sudoku not solvable.\n");
+        else if(count == count_limit)
+            printf("Sudoku has at least %d solution%s.\n", count, count == 1 ? "" : "s");
+        else if(count == 1)
+            printf("Sudoku has a unique solution.\n");
+        else
+            printf("Sudoku has %d solutions.\n", count);
+        free_sudoku_field(s);
+        printf("Execution time: %.3f In clock_t: %ju\n", (double) (sudoku_timing_end - sudoku_timing_start)/CLOCKS_PER_SEC,  (uintmax_t) (sudoku_timing_end - sudoku_timing_start) );
+        exit(0);
+    }
+    printf("Solver engine set to %s.\n", sudoku_engine_name(engine));
+    if(iterations != 1)
+        printf("Number of iterations set to %d.\n", iterations);
+    if(portfolio){
+        // One racer per thread, or one per default engine.
+        if(portfolio < 0)
+            portfolio = threads > 1 && threads <= SUDOKU_PORTFOLIO_MAX ? threads : 4;
+        for(i = 0; i < n_bench_engines; i++)
+            race_engines[i] = bench_engines[i];
+        sudoku_fill_portfolio(racers, portfolio, n_bench_engines ? race_engines : NULL,
+                                n_bench_engines, gen_opts.seed);
+        printf("Racing %d solvers:", portfolio);
+        for(i = 0; i < portfolio; i++)
+            printf(" %s%s", sudoku_engine_name(racers[i].engine), racers[i].seed ? "*" : "");
+        printf(" (* on a transformed puzzle).\n");
+    }else if(threads != 1){
+        printf("Solving on %d threads.\n", threads);
+    }
+
     // The real program here.
     printf("Sudoku pre solving:\n");
     print_sudoku_from_field(s);
-    if(iterations == 1){
-        printf("Solving started...\n");
-        sudoku_timing_start = clock();
-        s_solved = init_sudoku_solve(s);
-        sudoku_timing_end = clock();
-    }else{
-        printf("Solving started. A total of %d iterations will be made...\n", iterations);
-        sudoku_timing_start = clock();
-        for(i = 0; i < iterations; i++){
-            free_sudoku_field(init_sudoku_solve(s));
+    printf("Solving started...\n");
+    sudoku_timing_start = clock();
+    if(portfolio || budget != NULL){
+        s_solved = copy_sudoku_field(s);
+        if(portfolio)
+            solve_status = sudoku_solve_portfolio(s_solved, racers, portfolio, budget, &race_winner);
+        else
+            solve_status = sudoku_solve_status(s_solved, engine, budget);
+        if(solve_status != SUDOKU_SOLVE_SOLVED){
+            free_sudoku_field(s_solved);
+            s_solved = NULL;
         }
-        s_solved = init_sudoku_solve(s);
-        sudoku_timing_end = clock();
+    }else{
+        s_solved = solve_copy(s, engine, threads);
+    }
+    if(solve_status == SUDOKU_SOLVE_BUDGET && retry_engine >= 0){
+        printf("Search ran out of budget, solving again with %s.\n", sudoku_engine_name(retry_engine));
+        s_solved = init_sudoku_solve_engine(s, retry_engine);
+        solve_status = s_solved != NULL ? SUDOKU_SOLVE_SOLVED : SUDOKU_SOLVE_UNSOLVABLE;
+    }
+    sudoku_timing_end = clock();
+#ifdef SUDOKU_STATS
+    // Only the first solve. Parallel solves count on their worker threads.
+    take_sudoku_search_stats(&search_stats);
+#endif
+    if(iterations != 1){
+        // Timed like a --bench corpus of one puzzle.
+        printf("Benchmarking. A total of %d iterations will be made...\n", iterations);
+        bench_corpus.puzzles = (char*) sudoku_str;
+        bench_corpus.count = 1;
+        sudoku_bench_run(&bench_corpus, engine, &bench_opts, bench_results);
+        print_sudoku_bench_results(stdout, bench_results, 1, bench_format);
     }
 
-    if(s_solved == NULL){
+    if(portfolio && race_winner >= 0)
+        printf("Won by racer %d, %s with seed %ju.\n", race_winner,
+                sudoku_engine_name(racers[race_winner].engine), (uintmax_t) racers[race_winner].seed);
+    if(solve_status == SUDOKU_SOLVE_BUDGET){
+        printf("%s ran out of budget.\n", portfolio ? "Every solver" : "Search");
+    }else if(s_solved == NULL){
         printf("Sudoku not solvable.\n");
     }else{
         printf("Sudoku solved:\n");
         print_sudoku_from_field(s_solved);
         free_sudoku_field(s_solved);
     }
+#ifdef SUDOKU_STATS
+    printf("Search: ");
+    print_sudoku_search_stats_json(stdout, &search_stats);
+    printf("\n");
+#endif
     // Cleanup
     printf("Releasing allocated memory...\n");
     fflush(stdout);
@@ -0,0 +1,1336 @@
+// Sudoku batch solving
+#define _POSIX_C_SOURCE 200809L // getline, nanosleep, mmap
+#include <stdio.h>      // For standard IO
+#include <stdlib.h>     // For standard stuff
+#include <string.h>     // memset
+#include <time.h>       // nanosleep
+#include <pthread.h>    // Solver threads
+#include <sched.h>      // sched_yield
+#include <stdatomic.h>  // Pipeline queues
+#include <stdint.h>     // intptr_t
+#include <errno.h>      // EINTR
+#include <unistd.h>     // lseek, sysconf
+#include <sys/uio.h>    // writev
+#include <sys/mman.h>   // mmap
+#include <sys/stat.h>   // fstat
+
+#include "sudoku_general_tools.h"
+#include "sudoku_batch.h"
+#include "sudoku_kernel.h"
+#include "sudoku_pack.h"
+#include "sudoku_verify.h"
+
+/**
+    Solving of many puzzles in one run, one puzzle per line.
+*/
+
+// Outcome of a single puzzle.
+#define BATCH_SOLVED        (0)
+#define BATCH_UNSOLVABLE    (1)
+#define BATCH_BAD_LENGTH    (2)
+#define BATCH_BAD_CHAR      (3)
+#define BATCH_MULTIPLE      (4) // Counting found more than one solution.
+#define BATCH_BUDGET        (5) // The search budget ran out.
+#define BATCH_RETRIED       (8) // Flag. Solved again with the retry engine.
+
+// Number of lines gathered before they are verified.
+#define BATCH_BLOCK_SIZE    (1 << 15)
+// Puzzles read but not yet written by the thread pool.
+#define BATCH_WINDOW_SIZE   (1 << 15)
+// Number of puzzles solved between writes on a single thread, and handed
+// from stage to stage when pipelined.
+#define BATCH_CHUNK_SIZE    (256)
+
+/**
+    Gets the number of characters in a puzzle line.
+*/
+static int batch_cells(const sudoku_batch_opts* opts){
+    return opts->size ? opts->size * opts->size : SUDOKU_CELLS;
+}
+/**
+    Solves a puzzle line with the sized kernel of the batch.
+*/
+static int batch_solve_sized(const char* line, const sudoku_batch_opts* opts, char* out){
+    switch(sudoku_solve_sized(opts->size, line, out)){
+        case(SUDOKU_SIZED_SOLVED):
+            return BATCH_SOLVED;
+        case(SUDOKU_SIZED_UNSOLVABLE):
+            return BATCH_UNSOLVABLE;
+        default:
+            return BATCH_BAD_CHAR;
+    }
+}
+/**
+    Gets the length of an output line, including the line break.
+*/
+static size_t batch_line_len(const char* out){
+    return (const char*) memchr(out, '\n', SUDOKU_MAX_SIZE * SUDOKU_MAX_SIZE + 1) - out + 1;
+}
+/**
+    Sets up the search control of a solve from the budgets of the batch.
+    @return {sudoku_solve_ctl*} - ctl, or NULL if the batch has no budgets,
+                                  which keeps the checks out of the search.
+*/
+static sudoku_solve_ctl* batch_ctl(const sudoku_batch_opts* opts, sudoku_solve_ctl* ctl){
+    if(opts->max_nodes <= 0 && opts->max_seconds <= 0)
+        return NULL;
+    init_sudoku_solve_ctl(ctl);
+    ctl->max_nodes = opts->max_nodes;
+    ctl->max_seconds = opts->max_seconds;
+    return ctl;
+}
+/**
+    Counts the solutions of a single puzzle line and writes the count line.
+    Lines that can't be read and searches over budget give 0.
+*/
+static int batch_count_line(sudoku_field* f, const char* line, long len,
+                                        const sudoku_batch_opts* opts, char* out){
+    sudoku_solve_ctl ctl_buf;
+    sudoku_solve_ctl* ctl = batch_ctl(opts, &ctl_buf);
+    int ret;
+    int count = 0;
+
+    if(len != SUDOKU_CELLS){
+        ret = BATCH_BAD_LENGTH;
+    }else{
+        switch(sudoku_read_line(f, line)){
+            case(SUDOKU_LINE_OK):
+                count = sudoku_count_solutions(f, opts->count_limit, ctl);
+                ret = count == 0 ? BATCH_UNSOLVABLE : count == 1 ? BATCH_SOLVED : BATCH_MULTIPLE;
+                if(ctl != NULL && ctl->stopped){
+                    count = 0;
+                    ret = BATCH_BUDGET;
+                }
+                break;
+            case(SUDOKU_LINE_CONFLICT):
+                ret = BATCH_UNSOLVABLE;
+                break;
+            default:
+                ret = BATCH_BAD_CHAR;
+        }
+    }
+    sprintf(out, "%d\n", count);
+    return ret;
+}
+/**
+    Solves a line whose search ran over budget again with the retry engine,
+    without budget.
+*/
+static int batch_retry_line(sudoku_field* f, const char* line, const sudoku_batch_opts* opts, char* out){
+    sudoku_read_line(f, line); // Read fine the first time.
+    if(sudoku_solve_engine(f, opts->retry_engine) == NULL)
+        return BATCH_UNSOLVABLE | BATCH_RETRIED;
+    sudoku_write_line(f, out);
+    return BATCH_SOLVED | BATCH_RETRIED;
+}
+/**
+    Solves a single puzzle line and writes the solution line, including the
+    line break. Lines that can't be solved give a line of zeros. When
+    counting, the line holds the number of solutions instead.
+
+    @param {sudoku_field*} f - Scratch field.
+    @param {char*} line - The puzzle line, without line break.
+    @param {long} len - Length of the line.
+    @param {sudoku_batch_opts*} opts - Options of the batch.
+    @param {char*} out - Buffer of at least batch_cells + 1 characters. Not
+                        NUL terminated, see batch_line_len.
+    @return {int} - The BATCH_ outcome of the puzzle, with BATCH_RETRIED set
+                    if it was solved again with the retry engine.
+*/
+static int batch_solve_line(sudoku_field* f, const char* line, long len,
+                                        const sudoku_batch_opts* opts, char* out){
+    sudoku_solve_ctl ctl_buf;
+    sudoku_solve_ctl* ctl;
+    int ret, cached;
+    int cells = batch_cells(opts);
+
+    if(opts->count_limit)
+        return batch_count_line(f, line, len, opts, out);
+    ctl = batch_ctl(opts, &ctl_buf);
+    if(len != cells){
+        ret = BATCH_BAD_LENGTH;
+    }else if(opts->size){
+        ret = batch_solve_sized(line, opts, out);
+    }else if(opts->cache != NULL &&
+                (cached = sudoku_cache_solve(opts->cache, f, opts->engine, ctl, line, out)) != SUDOKU_CACHE_SKIPPED){
+        ret = cached == SUDOKU_CACHE_SOLVED ? BATCH_SOLVED
+                : cached == SUDOKU_CACHE_BUDGET ? BATCH_BUDGET : BATCH_UNSOLVABLE;
+    }else{
+        switch(sudoku_read_line(f, line)){
+            case(SUDOKU_LINE_OK):
+                switch(sudoku_solve_status(f, opts->engine, ctl)){
+                    case(SUDOKU_SOLVE_SOLVED):
+                        ret = BATCH_SOLVED;
+                        break;
+                    case(SUDOKU_SOLVE_UNSOLVABLE):
+                        ret = BATCH_UNSOLVABLE;
+                        break;
+                    default:
+                        ret = BATCH_BUDGET;
+                }
+                break;
+            case(SUDOKU_LINE_CONFLICT):
+                ret = BATCH_UNSOLVABLE;
+                break;
+            default:
+                ret = BATCH_BAD_CHAR;
+        }
+        if(ret != BATCH_SOLVED)
+            clear_sudoku_field(f);
+        sudoku_write_line(f, out);
+    }
+    if(ret == BATCH_BUDGET && opts->retry_engine >= 0)
+        ret = batch_retry_line(f, line, opts, out);
+    if((ret & ~BATCH_RETRIED) != BATCH_SOLVED)
+        memset(out, '0', cells);
+    out[cells] = '\n';
+    return ret;
+}
+/**
+    Adds the outcome of a puzzle to the counters and reports unreadable lines.
+*/
+static void batch_count(sudoku_batch_stats* stats, int outcome, long line_nbr, long len, int cells){
+    stats->puzzles++;
+    if(outcome & BATCH_RETRIED){
+        stats->retried++;
+        outcome &= ~BATCH_RETRIED;
+    }
+    switch(outcome){
+        case(BATCH_MULTIPLE):
+            stats->multiple++;
+            stats->solved++;
+            break;
+        case(BATCH_SOLVED):
+            stats->solved++;
+            break;
+        case(BATCH_UNSOLVABLE):
+            stats->unsolvable++;
+            break;
+        case(BATCH_BUDGET):
+            fprintf(stderr, "Line %ld: search budget exceeded.\n", line_nbr);
+            stats->over_budget++;
+            break;
+        case(BATCH_BAD_LENGTH):
+            fprintf(stderr, "Line %ld: expected %d characters, got %ld.\n", line_nbr, cells, len);
+            stats->invalid++;
+            break;
+        default:
+            fprintf(stderr, "Line %ld: unknown character.\n", line_nbr);
+            stats->invalid++;
+    }
+}
+/**
+    The puzzle lines of a stream. Regular files are memory mapped and read in
+    place, other streams (pipes, terminals) line by line with getline. Packed
+    files (see sudoku_pack.h) are recognized by their magic and give one line
+    per record.
+*/
+typedef struct batch_input batch_input;
+struct batch_input {
+    FILE* in;
+    char* map;          // The mapped file. NULL when reading with getline.
+    size_t map_len;
+    size_t pos;         // Offset of the next line in the map.
+    char* line;         // getline buffer.
+    size_t line_cap;
+    long line_nbr;
+    int packed;         // Non-zero for packed files.
+    sudoku_pack_reader pack;    // Reads packed streams. For packed maps only
+                                // the header, next and checksum are used.
+    char unpacked[SUDOKU_MAX_SIZE * SUDOKU_MAX_SIZE]; // The last record read.
+    int error;          // Packed input that is cut short or of the wrong size.
+};
+
+/**
+    Checks whether the input starts with a packed header and reads it if so.
+*/
+static void open_batch_packed(batch_input* bi, int cells){
+    int ch;
+
+    if(bi->map != NULL){
+        if(bi->map_len - bi->pos < SUDOKU_PACK_HEADER_BYTES
+                || memcmp(bi->map + bi->pos, SUDOKU_PACK_MAGIC, 4) != 0)
+            return;
+        bi->packed = 1;
+        bi->pack.checksum = SUDOKU_PACK_SUM_INIT;
+        bi->pack.in_order = 1;
+        if(decode_sudoku_pack_header(&bi->pack.header, (unsigned char*) bi->map + bi->pos))
+            bi->error = 1;
+        bi->pos += SUDOKU_PACK_HEADER_BYTES;
+    }else{
+        if((ch = getc(bi->in)) == EOF)
+            return;
+        ungetc(ch, bi->in);
+        if(ch != (unsigned char) SUDOKU_PACK_MAGIC[0])
+            return;
+        bi->packed = 1;
+        if(open_sudoku_pack_reader(&bi->pack, bi->in) != SUDOKU_PACK_OK)
+            bi->error = 1;
+    }
+    if(bi->error){
+        fprintf(stderr, "Packed input has an unsupported header.\n");
+    }else if(bi->pack.header.size * bi->pack.header.size != cells){
+        fprintf(stderr, "Packed input holds %dx%d sudokus, expected %d cells.\n",
+                    bi->pack.header.size, bi->pack.header.size, cells);
+        bi->error = 1;
+    }
+}
+/**
+    Sets up reading of a stream, mapping it if it is a regular file. Reading
+    starts at the current position of the stream.
+*/
+static void open_batch_input(batch_input* bi, FILE* in, int cells){
+    struct stat st;
+    off_t offset;
+    int fd = fileno(in);
+
+    memset(bi, 0, sizeof(*bi));
+    bi->in = in;
+    if(fstat(fd, &st) || !S_ISREG(st.st_mode) || st.st_size == 0
+                        || (offset = lseek(fd, 0, SEEK_CUR)) == -1 || offset >= st.st_size){
+        open_batch_packed(bi, cells);
+        return;
+    }
+    bi->map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if(bi->map == MAP_FAILED){
+        bi->map = NULL; // Falls back to getline.
+        open_batch_packed(bi, cells);
+        return;
+    }
+    posix_madvise(bi->map, st.st_size, POSIX_MADV_SEQUENTIAL);
+    bi->map_len = st.st_size;
+    bi->pos = offset;
+    open_batch_packed(bi, cells);
+}
+/**
+    Reads the next record of a packed input and unpacks it.
+    @return {long} - Length of the line. -1 at the end of the input.
+*/
+static long batch_read_record(batch_input* bi, const char** line){
+    sudoku_pack_reader* r = &bi->pack;
+    size_t rb = r->header.record_bytes;
+    const unsigned char* record;
+
+    if(bi->error)
+        return -1;
+    if(bi->map != NULL){
+        if(r->header.count != SUDOKU_PACK_UNKNOWN_COUNT && r->next >= r->header.count)
+            return -1;
+        if(bi->map_len - bi->pos < rb){
+            if(bi->pos != bi->map_len || r->header.count != SUDOKU_PACK_UNKNOWN_COUNT){
+                fprintf(stderr, "Packed input is cut short after %ld records.\n", bi->line_nbr);
+                bi->error = 1;
+            }
+            return -1;
+        }
+        record = (unsigned char*) bi->map + bi->pos;
+        bi->pos += rb;
+        r->checksum = sudoku_pack_checksum(r->checksum, record, rb);
+        r->next++;
+        sudoku_unpack_record(&r->header, record, bi->unpacked);
+    }else{
+        switch(sudoku_pack_read(r, bi->unpacked)){
+            case(SUDOKU_PACK_OK):
+            case(SUDOKU_PACK_BAD_RECORD): // Unpacked with '?', reported as unknown characters.
+                break;
+            case(SUDOKU_PACK_END):
+                return -1;
+            default:
+                fprintf(stderr, "Packed input could not be read after %ld records.\n", bi->line_nbr);
+                bi->error = 1;
+                return -1;
+        }
+    }
+    bi->line_nbr++;
+    *line = bi->unpacked;
+    return r->header.size * r->header.size;
+}
+/**
+    Reads the next puzzle line, skipping empty lines. The line break is not
+    part of the line.
+
+    @param {batch_input*} bi - The input.
+    @param {char**} line - Set to the start of the line. Valid until the next call.
+    @return {long} - Length of the line. -1 at the end of the stream.
+*/
+static long batch_read_line(batch_input* bi, const char** line){
+    const char* start;
+    const char* end;
+    ssize_t len;
+
+    if(bi->packed)
+        return batch_read_record(bi, line);
+    while(1){
+        if(bi->map != NULL){
+            if(bi->pos >= bi->map_len)
+                return -1;
+            start = bi->map + bi->pos;
+            end = memchr(start, '\n', bi->map_len - bi->pos);
+            len = end != NULL ? end - start : (ssize_t) (bi->map_len - bi->pos);
+            bi->pos += len + 1;
+        }else{
+            if((len = getline(&bi->line, &bi->line_cap, bi->in)) == -1)
+                return -1;
+            start = bi->line;
+        }
+        bi->line_nbr++;
+        while(len > 0 && (start[len - 1] == '\n' || start[len - 1] == '\r'))
+            len--;
+        if(len > 0){
+            *line = start;
+            return len;
+        }
+    }
+}
+/**
+    Unmaps or frees what open_batch_input and batch_read_line set up.
+    @return {int} - Non-zero if the stream had a read error, or packed input
+                    was cut short or had the wrong checksum.
+*/
+static int close_batch_input(batch_input* bi){
+    if(bi->map != NULL)
+        munmap(bi->map, bi->map_len);
+    free(bi->line);
+    if(bi->packed && !bi->error && sudoku_pack_check(&bi->pack) != SUDOKU_PACK_OK){
+        fprintf(stderr, "Packed input does not match its checksum.\n");
+        bi->error = 1;
+    }
+    return ferror(bi->in) || bi->error;
+}
+
+/**
+    Where the solution lines go, as text or as the records of a packed file.
+    Text goes straight to the file descriptor of the stream, a block of lines
+    per writev, when it has one.
+*/
+typedef struct batch_output batch_output;
+struct batch_output {
+    FILE* out;
+    int packed;
+    sudoku_pack_writer pack;
+    int fd;             // -1 writes through the stream.
+    int iov_max;        // Most buffers writev takes at once.
+    int error;          // A write failed.
+};
+
+/**
+    Sets up writing of solution lines, writing the header of a packed file.
+    @return {int} - Non-zero on write errors.
+*/
+static int open_batch_output(batch_output* bo, FILE* out, const sudoku_batch_opts* opts){
+    bo->out = out;
+    bo->packed = opts->packed;
+    bo->fd = fileno(out);
+    bo->iov_max = sysconf(_SC_IOV_MAX) > 0 ? (int) sysconf(_SC_IOV_MAX) : 16;
+    bo->error = 0;
+    if(bo->packed)
+        return open_sudoku_pack_writer(&bo->pack, out, opts->size ? opts->size : SUDOKU_SIZE);
+    return 0;
+}
+/**
+    Writes every buffer of iov, resuming after partial writes.
+    @return {int} - Non-zero on write errors.
+*/
+static int batch_writev(int fd, struct iovec* iov, int n){
+    ssize_t written;
+
+    while(n > 0){
+        if((written = writev(fd, iov, n)) < 0){
+            if(errno == EINTR)
+                continue;
+            return 1;
+        }
+        for(; n > 0 && (size_t) written >= iov->iov_len; iov++, n--)
+            written -= iov->iov_len;
+        if(n > 0){
+            iov->iov_base = (char*) iov->iov_base + written;
+            iov->iov_len -= written;
+        }
+    }
+    return 0;
+}
+/**
+    Writes n solution lines as made by batch_solve_line, stride characters
+    apart. Adjacent lines are joined into one buffer, so full solution lines
+    go out in a single write.
+*/
+static void batch_write_lines(batch_output* bo, const char* lines, long n, int stride){
+    struct iovec iov[64];
+    int n_iov = 0;
+    int max_iov = bo->iov_max < 64 ? bo->iov_max : 64;
+    const char* line;
+    size_t len;
+    long i;
+
+    if(bo->packed || bo->fd == -1){
+        for(i = 0; i < n; i++){
+            line = lines + i * stride;
+            if(bo->packed)
+                sudoku_pack_write(&bo->pack, line);
+            else
+                fwrite(line, 1, batch_line_len(line), bo->out);
+        }
+        return;
+    }
+    // Anything the caller left in the stream goes first.
+    bo->error |= fflush(bo->out) != 0;
+    for(i = 0; i < n && !bo->error; i++){
+        line = lines + i * stride;
+        len = batch_line_len(line);
+        if(n_iov > 0 && (char*) iov[n_iov - 1].iov_base + iov[n_iov - 1].iov_len == line){
+            iov[n_iov - 1].iov_len += len;
+            continue;
+        }
+        if(n_iov == max_iov){
+            bo->error |= batch_writev(bo->fd, iov, n_iov);
+            n_iov = 0;
+        }
+        iov[n_iov].iov_base = (char*) line;
+        iov[n_iov++].iov_len = len;
+    }
+    if(!bo->error)
+        bo->error |= batch_writev(bo->fd, iov, n_iov);
+}
+/**
+    Flushes the output and finishes the header of a packed file.
+    @return {int} - Non-zero on write errors.
+*/
+static int close_batch_output(batch_output* bo){
+    if(bo->packed)
+        return close_sudoku_pack_writer(&bo->pack);
+    return fflush(bo->out) || ferror(bo->out) || bo->error;
+}
+
+static int batch_solve_threads(FILE* in, FILE* out, const sudoku_batch_opts* opts,
+                                                        sudoku_batch_stats* stats);
+static int batch_solve_pipeline(FILE* in, FILE* out, const sudoku_batch_opts* opts,
+                                                        sudoku_batch_stats* stats);
+/**
+    Solves every puzzle of a stream and writes the solutions to another.
+
+    @param {FILE*} in - Stream to read puzzles from.
+    @param {FILE*} out - Stream to write solutions to.
+    @param {sudoku_batch_opts*} opts - Options of the batch.
+    @param {sudoku_batch_stats*} stats - Filled in with the counters of the run.
+    @return {int} - 0 if successful. Non-zero on read or write errors.
+*/
+int sudoku_batch_solve(FILE* in, FILE* out, const sudoku_batch_opts* opts, sudoku_batch_stats* stats){
+    batch_input bi;
+    batch_output bo;
+    const char* line;
+    long len;
+    char* solutions;
+    int n = 0;
+    int cells = batch_cells(opts);
+    sudoku_field f; // Reused for every puzzle.
+    double start;
+    int ret;
+
+    if(opts->pipeline)
+        return batch_solve_pipeline(in, out, opts, stats);
+    if(opts->threads > 1)
+        return batch_solve_threads(in, out, opts, stats);
+
+    start = sudoku_clock_seconds();
+    memset(stats, 0, sizeof(*stats));
+    open_batch_input(&bi, in, cells);
+    if(open_batch_output(&bo, out, opts)){
+        close_batch_input(&bi);
+        return 1;
+    }
+    if((solutions = malloc((size_t) BATCH_CHUNK_SIZE * (cells + 1))) == NULL){
+        fprintf(stderr, "Could not allocate memory for the batch, %d", __LINE__);
+        exit(1);
+    }
+    take_sudoku_search_stats(NULL);
+    while((len = batch_read_line(&bi, &line)) != -1){
+        batch_count(stats, batch_solve_line(&f, line, len, opts, solutions + n * (cells + 1)),
+                                                                        bi.line_nbr, len, cells);
+        if(++n == BATCH_CHUNK_SIZE){
+            batch_write_lines(&bo, solutions, n, cells + 1);
+            n = 0;
+        }
+    }
+    batch_write_lines(&bo, solutions, n, cells + 1);
+    take_sudoku_search_stats(&stats->search);
+    free(solutions);
+    ret = close_batch_output(&bo);
+    stats->seconds = sudoku_clock_seconds() - start;
+
+    return close_batch_input(&bi) || ret;
+}
+
+// Thread pool
+
+// Outcome of a puzzle in the window that isn't solved yet.
+#define BATCH_PENDING       (-1)
+
+/**
+    A solver thread. Owns the range [lo, hi) of puzzle numbers until other
+    workers steal from the top of it.
+*/
+typedef struct batch_worker batch_worker;
+typedef struct batch_pool batch_pool;
+struct batch_worker {
+    pthread_t thread;
+    pthread_mutex_t lock;   // Protects lo and hi.
+    long lo;
+    long hi;
+    sudoku_field* scratch;  // Reused for every puzzle the worker solves. From
+                            // the scratch pool, on a cache line of its own.
+    sudoku_search_stats search; // Counters of the puzzles the worker solved.
+    batch_pool* pool;
+    int id;
+};
+/**
+    The window of puzzles being solved and the workers solving it. Puzzle i
+    of the run is kept in slot i % BATCH_WINDOW_SIZE: cells characters at
+    in + slot*cells, with its solution line going to out + slot*(cells + 1).
+    The calling thread writes the solved puzzles at the front of the window
+    in order and reads new ones into the slots that frees, while the workers
+    keep solving, so nobody waits for a whole block to drain.
+*/
+struct batch_pool {
+    batch_worker* workers;
+    int n_workers;
+    sudoku_field_pool* scratch;
+    const sudoku_batch_opts* opts;
+    int cells;
+
+    char* in;
+    long* len;
+    atomic_int* outcome;    // BATCH_PENDING until the puzzle is solved.
+    char* out;
+
+    pthread_mutex_t lock;   // Protects next, read, idle and quit.
+    pthread_cond_t start;   // Puzzles were read or handed out, or quit is set.
+    pthread_cond_t done;    // The puzzle the writer waits for is solved.
+    long next;              // First puzzle not handed to a worker yet.
+    long read;              // Puzzles read so far.
+    int idle;               // Workers waiting on start.
+    int quit;
+    atomic_long awaited;    // Puzzle the writer waits for, -1 if none.
+};
+
+/**
+    Takes the next puzzle of a worker's own range.
+    @return {long} - Number of the puzzle. -1 if the range is empty.
+*/
+static long batch_take(batch_worker* w){
+    long i = -1;
+    pthread_mutex_lock(&w->lock);
+    if(w->lo < w->hi)
+        i = w->lo++;
+    pthread_mutex_unlock(&w->lock);
+    return i;
+}
+/**
+    Moves the upper half of another worker's range to a worker with an
+    empty range. Victims are tried in order, starting after the thief.
+    @return {int} - 1 if anything was stolen. 0 if every range is empty.
+*/
+static int batch_steal(batch_worker* thief){
+    batch_pool* pool = thief->pool;
+    batch_worker* victim;
+    long n, hi;
+    int i;
+
+    for(i = 1; i < pool->n_workers; i++){
+        victim = pool->workers + (thief->id + i) % pool->n_workers;
+        pthread_mutex_lock(&victim->lock);
+        n = victim->hi - victim->lo;
+        if(n > 0){
+            hi = victim->hi;
+            victim->hi -= (n + 1) / 2;
+            pthread_mutex_unlock(&victim->lock);
+
+            pthread_mutex_lock(&thief->lock);
+            thief->lo = hi - (n + 1) / 2;
+            thief->hi = hi;
+            pthread_mutex_unlock(&thief->lock);
+            return 1;
+        }
+        pthread_mutex_unlock(&victim->lock);
+    }
+    return 0;
+}
+/**
+    Gives a worker with an empty range its share of the puzzles read but not
+    handed out yet, at most BATCH_CHUNK_SIZE. If there are none it waits
+    until more are read or another worker takes a range it could steal from.
+    @return {int} - 0 once the pool quits. 1 otherwise, with or without a range.
+*/
+static int batch_claim(batch_worker* w){
+    batch_pool* pool = w->pool;
+    long n;
+
+    pthread_mutex_lock(&pool->lock);
+    if(pool->next == pool->read){
+        if(pool->quit){
+            pthread_mutex_unlock(&pool->lock);
+            return 0;
+        }
+        pool->idle++;
+        pthread_cond_wait(&pool->start, &pool->lock);
+        pool->idle--;
+        pthread_mutex_unlock(&pool->lock);
+        return 1;
+    }
+    n = (pool->read - pool->next + pool->n_workers - 1) / pool->n_workers;
+    if(n > BATCH_CHUNK_SIZE)
+        n = BATCH_CHUNK_SIZE;
+    pthread_mutex_lock(&w->lock);
+    w->lo = pool->next;
+    w->hi = pool->next + n;
+    pthread_mutex_unlock(&w->lock);
+    pool->next += n;
+    if(pool->idle)
+        pthread_cond_broadcast(&pool->start); // They may steal from it.
+    pthread_mutex_unlock(&pool->lock);
+    return 1;
+}
+/**
+    Worker thread. Solves its own range, then steals from the others, and
+    only takes newly read puzzles once every range is empty, so the oldest
+    puzzles, which the writer waits for, are solved first.
+*/
+static void* batch_worker_main(void* arg){
+    batch_worker* w = arg;
+    batch_pool* pool = w->pool;
+    long i, slot;
+
+    take_sudoku_search_stats(NULL);
+    do{
+        while((i = batch_take(w)) != -1){
+            slot = i % BATCH_WINDOW_SIZE;
+            atomic_store(&pool->outcome[slot], batch_solve_line(w->scratch, pool->in + slot * pool->cells,
+                                    pool->len[slot], pool->opts, pool->out + slot * (pool->cells + 1)));
+            if(atomic_load(&pool->awaited) == i){
+                pthread_mutex_lock(&pool->lock);
+                pthread_cond_signal(&pool->done);
+                pthread_mutex_unlock(&pool->lock);
+            }
+        }
+    }while(batch_steal(w) || batch_claim(w));
+    take_sudoku_search_stats(&w->search);
+    return NULL;
+}
+/**
+    Writes the solution lines of puzzles [from, to) of the window, which
+    wrap around its end at most once.
+*/
+static void batch_pool_write(batch_pool* pool, batch_output* bo, long from, long to){
+    long lo = from % BATCH_WINDOW_SIZE;
+    long n = to - from;
+    int stride = pool->cells + 1;
+
+    if(lo + n > BATCH_WINDOW_SIZE){
+        batch_write_lines(bo, pool->out + lo * stride, BATCH_WINDOW_SIZE - lo, stride);
+        n -= BATCH_WINDOW_SIZE - lo;
+        lo = 0;
+    }
+    batch_write_lines(bo, pool->out + lo * stride, n, stride);
+}
+
+/**
+    Solves every puzzle of a stream on a pool of opts->threads threads and
+    writes the solutions to another, in input order. The calling thread
+    reads and writes while the pool solves, over a window of puzzles that is
+    refilled as it drains, and idle threads steal from busy ones, so one
+    slow puzzle does not keep the other threads waiting.
+*/
+static int batch_solve_threads(FILE* in, FILE* out, const sudoku_batch_opts* opts,
+                                                        sudoku_batch_stats* stats){
+    batch_pool pool;
+    batch_input bi;
+    batch_output bo;
+    const char* line;
+    long len;
+    long* line_nbrs;
+    long written = 0; // Puzzles written so far.
+    long n, slot;
+    int t, outcome;
+    int n_threads = opts->threads;
+    int cells = batch_cells(opts);
+    int eof = 0;
+    int ret;
+    double start = sudoku_clock_seconds();
+
+    memset(stats, 0, sizeof(*stats));
+    memset(&pool, 0, sizeof(pool));
+    pool.n_workers = n_threads;
+    pool.opts = opts;
+    pool.cells = cells;
+    pool.in = malloc((size_t) BATCH_WINDOW_SIZE * cells);
+    pool.len = malloc(BATCH_WINDOW_SIZE * sizeof(long));
+    pool.outcome = malloc(BATCH_WINDOW_SIZE * sizeof(atomic_int));
+    pool.out = malloc((size_t) BATCH_WINDOW_SIZE * (cells + 1));
+    pool.workers = malloc(n_threads * sizeof(batch_worker));
+    line_nbrs = malloc(BATCH_WINDOW_SIZE * sizeof(long));
+    if(!pool.in || !pool.len || !pool.outcome || !pool.out || !pool.workers || !line_nbrs){
+        fprintf(stderr, "Could not allocate memory for the batch, %d", __LINE__);
+        exit(1);
+    }
+    atomic_init(&pool.awaited, -1);
+    pool.scratch = alloc_sudoku_field_pool(n_threads);
+    pthread_mutex_init(&pool.lock, NULL);
+    pthread_cond_init(&pool.start, NULL);
+    pthread_cond_init(&pool.done, NULL);
+    for(t = 0; t < n_threads; t++){
+        pool.workers[t].pool = &pool;
+        pool.workers[t].id = t;
+        pool.workers[t].lo = pool.workers[t].hi = 0;
+        memset(&pool.workers[t].search, 0, sizeof(sudoku_search_stats));
+        pool.workers[t].scratch = take_sudoku_field(pool.scratch);
+        pthread_mutex_init(&pool.workers[t].lock, NULL);
+    }
+    // Workers steal from each other as soon as they start.
+    for(t = 0; t < n_threads; t++){
+        if(pthread_create(&pool.workers[t].thread, NULL, batch_worker_main, pool.workers + t)){
+            fprintf(stderr, "Could not start solver thread, %d", __LINE__);
+            exit(1);
+        }
+    }
+
+    open_batch_input(&bi, in, cells);
+    ret = open_batch_output(&bo, out, opts);
+    while(!ret){
+        // Write the solved puzzles at the front of the window.
+        for(n = written; n < pool.read; n++){
+            slot = n % BATCH_WINDOW_SIZE;
+            if((outcome = atomic_load(&pool.outcome[slot])) == BATCH_PENDING)
+                break;
+            batch_count(stats, outcome, line_nbrs[slot], pool.len[slot], cells);
+        }
+        if(n > written){
+            batch_pool_write(&pool, &bo, written, n);
+            written = n;
+        }
+        // Refill the slots that frees, a chunk at a time.
+        if(!eof && pool.read - written < BATCH_WINDOW_SIZE){
+            for(n = pool.read; n - written < BATCH_WINDOW_SIZE && n - pool.read < BATCH_CHUNK_SIZE; n++){
+                if((len = batch_read_line(&bi, &line)) == -1){
+                    eof = 1;
+                    break;
+                }
+                slot = n % BATCH_WINDOW_SIZE;
+                pool.len[slot] = len;
+                line_nbrs[slot] = bi.line_nbr;
+                if(len == cells)
+                    memcpy(pool.in + slot * cells, line, cells);
+                atomic_store(&pool.outcome[slot], BATCH_PENDING);
+            }
+            pthread_mutex_lock(&pool.lock);
+            pool.read = n;
+            if(pool.idle)
+                pthread_cond_broadcast(&pool.start);
+            pthread_mutex_unlock(&pool.lock);
+            continue;
+        }
+        if(written == pool.read)
+            break;
+        // Window full or input done. Wait for the oldest puzzle.
+        atomic_store(&pool.awaited, written);
+        pthread_mutex_lock(&pool.lock);
+        while(atomic_load(&pool.outcome[written % BATCH_WINDOW_SIZE]) == BATCH_PENDING)
+            pthread_cond_wait(&pool.done, &pool.lock);
+        pthread_mutex_unlock(&pool.lock);
+        atomic_store(&pool.awaited, -1);
+    }
+    if(!ret)
+        ret = close_batch_output(&bo);
+    stats->seconds = sudoku_clock_seconds() - start;
+
+    pthread_mutex_lock(&pool.lock);
+    pool.quit = 1;
+    pthread_cond_broadcast(&pool.start);
+    pthread_mutex_unlock(&pool.lock);
+    for(t = 0; t < n_threads; t++){
+        pthread_join(pool.workers[t].thread, NULL);
+        add_sudoku_search_stats(&stats->search, &pool.workers[t].search);
+    }
+    for(t = 0; t < n_threads; t++)
+        pthread_mutex_destroy(&pool.workers[t].lock);
+    pthread_cond_destroy(&pool.done);
+    pthread_cond_destroy(&pool.start);
+    pthread_mutex_destroy(&pool.lock);
+    free_sudoku_field_pool(pool.scratch);
+    free(pool.workers);
+    free(pool.in);
+    free(pool.len);
+    free(pool.outcome);
+    free(pool.out);
+    free(line_nbrs);
+    return close_batch_input(&bi) || ret;
+}
+// Pipeline
+
+// Chunks in flight per solver thread. Bounds the memory of the pipeline and
+// how far the reader can run ahead of the writer.
+#define BATCH_CHUNKS_PER_THREAD (4)
+
+/**
+    A bounded lock-free queue of pointers for any number of producers and
+    consumers (Vyukov's ring). Every slot holds the position it can be
+    pushed at, or that position + 1 once it holds an item, so producers and
+    consumers only contend on their own index.
+*/
+typedef struct batch_queue batch_queue;
+typedef struct batch_slot batch_slot;
+struct batch_slot {
+    atomic_size_t seq;
+    void* item;
+};
+struct batch_queue {
+    batch_slot* slots;
+    size_t mask;        // Capacity - 1. The capacity is a power of two.
+    _Alignas(SUDOKU_CACHE_LINE) atomic_size_t head; // Next position to push at.
+    _Alignas(SUDOKU_CACHE_LINE) atomic_size_t tail; // Next position to pop from.
+};
+
+/**
+    Sets up an empty queue of at least capacity items.
+*/
+static void init_batch_queue(batch_queue* q, size_t capacity){
+    size_t size = 1, i;
+
+    while(size < capacity)
+        size <<= 1;
+    if((q->slots = malloc(size * sizeof(batch_slot))) == NULL){
+        fprintf(stderr, "Could not allocate memory for the pipeline, %d", __LINE__);
+        exit(1);
+    }
+    for(i = 0; i < size; i++)
+        atomic_init(&q->slots[i].seq, i);
+    q->mask = size - 1;
+    atomic_init(&q->head, 0);
+    atomic_init(&q->tail, 0);
+}
+/**
+    Pushes an item if the queue has room.
+    @return {int} - 1 if pushed. 0 if the queue is full.
+*/
+static int batch_try_push(batch_queue* q, void* item){
+    size_t pos = atomic_load_explicit(&q->head, memory_order_relaxed);
+    batch_slot* slot;
+    intptr_t diff;
+
+    while(1){
+        slot = q->slots + (pos & q->mask);
+        diff = (intptr_t) atomic_load_explicit(&slot->seq, memory_order_acquire) - (intptr_t) pos;
+        if(diff == 0){
+            if(atomic_compare_exchange_weak_explicit(&q->head, &pos, pos + 1,
+                                                memory_order_relaxed, memory_order_relaxed))
+                break;
+        }else if(diff < 0){
+            return 0;
+        }else{
+            pos = atomic_load_explicit(&q->head, memory_order_relaxed);
+        }
+    }
+    slot->item = item;
+    atomic_store_explicit(&slot->seq, pos + 1, memory_order_release);
+    return 1;
+}
+/**
+    Pops an item if the queue has one.
+    @return {int} - 1 if popped. 0 if the queue is empty.
+*/
+static int batch_try_pop(batch_queue* q, void** item){
+    size_t pos = atomic_load_explicit(&q->tail, memory_order_relaxed);
+    batch_slot* slot;
+    intptr_t diff;
+
+    while(1){
+        slot = q->slots + (pos & q->mask);
+        diff = (intptr_t) atomic_load_explicit(&slot->seq, memory_order_acquire) - (intptr_t) (pos + 1);
+        if(diff == 0){
+            if(atomic_compare_exchange_weak_explicit(&q->tail, &pos, pos + 1,
+                                                memory_order_relaxed, memory_order_relaxed))
+                break;
+        }else if(diff < 0){
+            return 0;
+        }else{
+            pos = atomic_load_explicit(&q->tail, memory_order_relaxed);
+        }
+    }
+    *item = slot->item;
+    atomic_store_explicit(&slot->seq, pos + q->mask + 1, memory_order_release);
+    return 1;
+}
+/**
+    Waits for a full or empty queue to change. Yields first, then sleeps up
+    to about a millisecond, so a stage waiting on slow input or output
+    doesn't take CPU from the solvers.
+    @param {int*} waits - Times waited so far for the same item, 0 at first.
+*/
+static void batch_backoff(int* waits){
+    struct timespec ts;
+
+    if(++*waits < 64){
+        sched_yield();
+    }else{
+        ts.tv_sec = 0;
+        ts.tv_nsec = 1000L << (*waits - 64 < 10 ? *waits - 64 : 10);
+        nanosleep(&ts, NULL);
+    }
+}
+/**
+    Pushes an item, waiting while the queue is full.
+*/
+static void batch_push(batch_queue* q, void* item){
+    int waits = 0;
+    while(!batch_try_push(q, item))
+        batch_backoff(&waits);
+}
+/**
+    Pops an item, waiting while the queue is empty.
+*/
+static void* batch_pop(batch_queue* q){
+    void* item;
+    int waits = 0;
+    while(!batch_try_pop(q, &item))
+        batch_backoff(&waits);
+    return item;
+}
+
+/**
+    Up to BATCH_CHUNK_SIZE consecutive puzzles and their solution lines, laid
+    out as in batch_pool.
+*/
+typedef struct batch_chunk batch_chunk;
+struct batch_chunk {
+    unsigned long seq;  // Position of the chunk in the input.
+    int n;
+    char* in;
+    long len[BATCH_CHUNK_SIZE];
+    long line_nbr[BATCH_CHUNK_SIZE];
+    int outcome[BATCH_CHUNK_SIZE];
+    char* out;
+};
+/**
+    The stages of a pipelined run and the queues between them. Chunks go
+    from free to the reader, through work to a solver and through done to
+    the writer, which puts them back in order and returns them to free.
+    A NULL chunk tells the next stage that its producer has finished.
+*/
+typedef struct batch_pipeline batch_pipeline;
+struct batch_pipeline {
+    batch_queue free;
+    batch_queue work;
+    batch_queue done;
+    batch_input input;
+    const sudoku_batch_opts* opts;
+    int cells;
+    int n_solvers;
+};
+/**
+    A solver thread of the pipeline.
+*/
+typedef struct batch_solver batch_solver;
+struct batch_solver {
+    pthread_t thread;
+    batch_pipeline* pipe;
+    sudoku_field* scratch;
+    sudoku_search_stats search;
+};
+
+/**
+    Reader thread. Fills free chunks with puzzle lines until the input ends.
+*/
+static void* batch_reader_main(void* arg){
+    batch_pipeline* pipe = arg;
+    batch_chunk* chunk;
+    const char* line;
+    long len = 0;
+    unsigned long seq = 0;
+    int i;
+
+    while(len != -1){
+        chunk = batch_pop(&pipe->free);
+        for(chunk->n = 0; chunk->n < BATCH_CHUNK_SIZE; chunk->n++){
+            if((len = batch_read_line(&pipe->input, &line)) == -1)
+                break;
+            chunk->len[chunk->n] = len;
+            chunk->line_nbr[chunk->n] = pipe->input.line_nbr;
+            if(len == pipe->cells)
+                memcpy(chunk->in + chunk->n * pipe->cells, line, pipe->cells);
+        }
+        if(chunk->n == 0){
+            batch_push(&pipe->free, chunk);
+            break;
+        }
+        chunk->seq = seq++;
+        batch_push(&pipe->work, chunk);
+    }
+    for(i = 0; i < pipe->n_solvers; i++)
+        batch_push(&pipe->work, NULL);
+    return NULL;
+}
+/**
+    Solver thread. Solves chunks until the reader has finished.
+*/
+static void* batch_solver_main(void* arg){
+    batch_solver* w = arg;
+    batch_pipeline* pipe = w->pipe;
+    batch_chunk* chunk;
+    int i;
+
+    take_sudoku_search_stats(NULL);
+    while((chunk = batch_pop(&pipe->work)) != NULL){
+        for(i = 0; i < chunk->n; i++)
+            chunk->outcome[i] = batch_solve_line(w->scratch, chunk->in + i * pipe->cells, chunk->len[i],
+                                                pipe->opts, chunk->out + i * (pipe->cells + 1));
+        batch_push(&pipe->done, chunk);
+    }
+    take_sudoku_search_stats(&w->search);
+    batch_push(&pipe->done, NULL);
+    return NULL;
+}
+
+/**
+    Solves every puzzle of a stream with reading, solving and writing running
+    at the same time: a reader thread, opts->threads solver threads and the
+    calling thread as the writer, handing chunks of puzzles over bounded
+    lock-free queues. A slow input doesn't stall the writer and a slow output
+    holds the reader back once every chunk is in flight.
+*/
+static int batch_solve_pipeline(FILE* in, FILE* out, const sudoku_batch_opts* opts,
+                                                        sudoku_batch_stats* stats){
+    batch_pipeline pipe;
+    batch_output bo;
+    batch_chunk* chunks;
+    batch_chunk** pending;  // Solved chunks waiting for the ones before them.
+    batch_chunk* chunk;
+    batch_solver* solvers;
+    pthread_t reader;
+    sudoku_field_pool* scratch;
+    unsigned long next = 0; // Sequence number of the next chunk to write.
+    int n_threads = opts->threads;
+    int n_chunks = n_threads * BATCH_CHUNKS_PER_THREAD + 2;
+    int cells = batch_cells(opts);
+    int finished = 0;
+    int i, t, ret;
+    char* lines;
+    double start = sudoku_clock_seconds();
+
+    memset(stats, 0, sizeof(*stats));
+    open_batch_input(&pipe.input, in, cells);
+    if(open_batch_output(&bo, out, opts)){
+        close_batch_input(&pipe.input);
+        return 1;
+    }
+    pipe.opts = opts;
+    pipe.cells = cells;
+    pipe.n_solvers = n_threads;
+    chunks = malloc(n_chunks * sizeof(batch_chunk));
+    pending = calloc(n_chunks, sizeof(batch_chunk*));
+    solvers = malloc(n_threads * sizeof(batch_solver));
+    lines = malloc((size_t) n_chunks * BATCH_CHUNK_SIZE * (2 * cells + 1));
+    if(!chunks || !pending || !solvers || !lines){
+        fprintf(stderr, "Could not allocate memory for the pipeline, %d", __LINE__);
+        exit(1);
+    }
+    // Every queue can hold every chunk and the end markers, so the end
+    // markers never wait.
+    init_batch_queue(&pipe.free, n_chunks);
+    init_batch_queue(&pipe.work, n_chunks + n_threads);
+    init_batch_queue(&pipe.done, n_chunks + n_threads);
+    for(i = 0; i < n_chunks; i++){
+        chunks[i].in = lines + (size_t) i * BATCH_CHUNK_SIZE * (2 * cells + 1);
+        chunks[i].out = chunks[i].in + (size_t) BATCH_CHUNK_SIZE * cells;
+        batch_push(&pipe.free, chunks + i);
+    }
+
+    scratch = alloc_sudoku_field_pool(n_threads);
+    for(t = 0; t < n_threads; t++){
+        solvers[t].pipe = &pipe;
+        solvers[t].scratch = take_sudoku_field(scratch);
+        memset(&solvers[t].search, 0, sizeof(sudoku_search_stats));
+        if(pthread_create(&solvers[t].thread, NULL, batch_solver_main, solvers + t)){
+            fprintf(stderr, "Could not start solver thread, %d", __LINE__);
+            exit(1);
+        }
+    }
+    if(pthread_create(&reader, NULL, batch_reader_main, &pipe)){
+        fprintf(stderr, "Could not start reader thread, %d", __LINE__);
+        exit(1);
+    }
+
+    // Chunks in flight are at most n_chunks apart, so seq % n_chunks is a
+    // free place for every solved chunk until it is written.
+    while(finished < n_threads){
+        if((chunk = batch_pop(&pipe.done)) == NULL){
+            finished++;
+            continue;
+        }
+        pending[chunk->seq % n_chunks] = chunk;
+        while((chunk = pending[next % n_chunks]) != NULL && chunk->seq == next){
+            pending[next % n_chunks] = NULL;
+            for(i = 0; i < chunk->n; i++)
+                batch_count(stats, chunk->outcome[i], chunk->line_nbr[i], chunk->len[i], cells);
+            batch_write_lines(&bo, chunk->out, chunk->n, cells + 1);
+            batch_push(&pipe.free, chunk);
+            next++;
+        }
+    }
+
+    pthread_join(reader, NULL);
+    for(t = 0; t < n_threads; t++){
+        pthread_join(solvers[t].thread, NULL);
+        add_sudoku_search_stats(&stats->search, &solvers[t].search);
+    }
+    free_sudoku_field_pool(scratch);
+    ret = close_batch_output(&bo);
+    ret = close_batch_input(&pipe.input) || ret;
+    stats->seconds = sudoku_clock_seconds() - start;
+
+    free(pipe.free.slots);
+    free(pipe.work.slots);
+    free(pipe.done.slots);
+    free(chunks);
+    free(pending);
+    free(solvers);
+    free(lines);
+    return ret;
+}
+/**
+    Prints the throughput summary of a batch run.
+
+    @param {FILE*} out - Stream to print to.
+    @param {sudoku_batch_stats*} stats - The counters of the run.
+*/
+void print_sudoku_batch_stats(FILE* out, const sudoku_batch_stats* stats){
+    fprintf(out, "Puzzles: %ld Solved: %ld Unsolvable: %ld Invalid: %ld\n",
+                stats->puzzles, stats->solved, stats->unsolvable, stats->invalid);
+    if(stats->multiple)
+        fprintf(out, "Multiple solutions: %ld\n", stats->multiple);
+    if(stats->over_budget || stats->retried)
+        fprintf(out, "Over budget: %ld Retried: %ld\n", stats->over_budget, stats->retried);
+    fprintf(out, "Time: %.3f s Throughput: %.0f puzzles/s\n", stats->seconds,
+                stats->seconds > 0 ? stats->puzzles / stats->seconds : 0.0);
+#ifdef SUDOKU_STATS
+    fprintf(out, "Search: ");
+    print_sudoku_search_stats_json(out, &stats->search);
+    fprintf(out, "\n");
+#endif
+}
+
+// Verification
+
+/**
+    Checks whether a line is all '0', as written for unsolvable puzzles.
+*/
+static int batch_zero_line(const char* line, long len){
+    while(len > 0 && line[len - 1] == '0')
+        len--;
+    return len == 0;
+}
+/**
+    Verifies every solution line of a stream, see sudoku_verify.h, and
+    reports the lines that fail to stderr. Lines are read as in
+    sudoku_batch_solve, so batch output can be checked against its input.
+
+    @param {FILE*} in - Stream to read solutions from.
+    @param {FILE*} puzzles - Stream to read the puzzle of every solution from.
+                             NULL to only check the grids.
+    @param {sudoku_verify_stats*} stats - Filled in with the counters of the run.
+    @return {int} - 0 if successful. Non-zero on read errors or if the
+                    puzzles end before the solutions.
+*/
+int sudoku_batch_verify(FILE* in, FILE* puzzles, sudoku_verify_stats* stats){
+    batch_input bi, bp;
+    const char* line;
+    const char* puzzle = NULL;
+    long len, puzzle_len = SUDOKU_CELLS;
+    long n, i;
+    int more = 1;
+    int ret = 0;
+    char* grids = malloc((size_t) BATCH_BLOCK_SIZE * SUDOKU_CELLS);
+    char* clues = malloc((size_t) BATCH_BLOCK_SIZE * SUDOKU_CELLS);
+    long* line_nbrs = malloc(BATCH_BLOCK_SIZE * sizeof(long));
+    long* lens = malloc(BATCH_BLOCK_SIZE * sizeof(long));
+    unsigned char* outcome = malloc(BATCH_BLOCK_SIZE);
+    double start = sudoku_clock_seconds();
+
+    if(!grids || !clues || !line_nbrs || !lens || !outcome){
+        fprintf(stderr, "Could not allocate memory for the batch, %d", __LINE__);
+        exit(1);
+    }
+    memset(stats, 0, sizeof(*stats));
+    open_batch_input(&bi, in, SUDOKU_CELLS);
+    if(puzzles != NULL)
+        open_batch_input(&bp, puzzles, SUDOKU_CELLS);
+    while(more){
+        // Lines are gathered into a block. Lines of the wrong length are
+        // blanked, so they fail as grids and are reported in line order.
+        for(n = 0; n < BATCH_BLOCK_SIZE; ){
+            if((len = batch_read_line(&bi, &line)) == -1){
+                more = 0;
+                break;
+            }
+            if(puzzles != NULL && (puzzle_len = batch_read_line(&bp, &puzzle)) == -1){
+                fprintf(stderr, "Puzzles end before line %ld of the solutions.\n", bi.line_nbr);
+                more = 0;
+                ret = 1;
+                break;
+            }
+            stats->grids++;
+            if(len == SUDOKU_CELLS && batch_zero_line(line, len)){
+                stats->unsolved++;
+                continue;
+            }
+            if(len != SUDOKU_CELLS || puzzle_len != SUDOKU_CELLS){
+                memset(grids + n * SUDOKU_CELLS, '0', SUDOKU_CELLS);
+                lens[n] = len != SUDOKU_CELLS ? len : puzzle_len;
+            }else{
+                memcpy(grids + n * SUDOKU_CELLS, line, SUDOKU_CELLS);
+                lens[n] = SUDOKU_CELLS;
+            }
+            if(puzzles != NULL)
+                memcpy(clues + n * SUDOKU_CELLS, lens[n] == SUDOKU_CELLS ? puzzle : grids + n * SUDOKU_CELLS,
+                            SUDOKU_CELLS);
+            line_nbrs[n++] = bi.line_nbr;
+        }
+        stats->valid += sudoku_verify_grids(grids, SUDOKU_CELLS, puzzles != NULL ? clues : NULL,
+                                                            SUDOKU_CELLS, n, outcome);
+        for(i = 0; i < n; i++){
+            switch(outcome[i]){
+                case(SUDOKU_VERIFY_INVALID):
+                    if(lens[i] != SUDOKU_CELLS)
+                        fprintf(stderr, "Line %ld: expected %d characters, got %ld.\n",
+                                    line_nbrs[i], SUDOKU_CELLS, lens[i]);
+                    else
+                        fprintf(stderr, "Line %ld: not a valid grid.\n", line_nbrs[i]);
+                    stats->invalid++;
+                    break;
+                case(SUDOKU_VERIFY_MISMATCH):
+                    fprintf(stderr, "Line %ld: does not keep the clues of its puzzle.\n", line_nbrs[i]);
+                    stats->mismatched++;
+                    break;
+            }
+        }
+    }
+    stats->seconds = sudoku_clock_seconds() - start;
+
+    free(grids);
+    free(clues);
+    free(line_nbrs);
+    free(lens);
+    free(outcome);
+    if(puzzles != NULL)
+        ret |= close_batch_input(&bp);
+    return close_batch_input(&bi) || ret;
+}
+/**
+    Prints the summary of a verify run.
+
+    @param {FILE*} out - Stream to print to.
+    @param {sudoku_verify_stats*} stats - The counters of the run.
+*/
+void print_sudoku_verify_stats(FILE* out, const sudoku_verify_stats* stats){
+    fprintf(out, "Grids: %ld Valid: %ld Invalid: %ld Mismatched: %ld Unsolved: %ld\n",
+                stats->grids, stats->valid, stats->invalid, stats->mismatched, stats->unsolved);
+    fprintf(out, "Time: %.3f s Throughput: %.0f grids/s\n", stats->seconds,
+                stats->seconds > 0 ? stats->grids / stats->seconds : 0.0);
+}
@@ -0,0 +1,132 @@
+#ifndef SUDOKU_BATCH_H_INCLUDED
+#define SUDOKU_BATCH_H_INCLUDED
+
+#include <stdio.h>      // FILE
+
+#include "sudoku_general_tools.h"
+#include "sudoku_cache.h"
+
+/**
+    Batch solving. Puzzles are read one per line, SUDOKU_CELLS characters in
+    the format of sudoku_read_line (or size*size characters for the sized
+    kernels), and one solution line is written per
+    puzzle, in input order. Puzzles without a solution and lines that can't be
+    read give a line of zeros so that output line N always belongs to input
+    line N. Empty lines are skipped.
+
+    When counting, the line written per puzzle is its number of solutions up
+    to the limit instead, see sudoku_count_solutions. Lines that can't be read
+    give 0.
+
+    Input that starts with a packed header (see sudoku_pack.h) is read as a
+    packed file, one puzzle per record. Solutions can be written as a packed
+    file too, with the same one record per puzzle.
+*/
+
+/**
+    Counters for a batch run.
+*/
+typedef struct sudoku_batch_stats sudoku_batch_stats;
+struct sudoku_batch_stats {
+    long puzzles;       // Lines read, excluding empty lines.
+    long solved;
+    long multiple;      // Puzzles with more than one solution, when counting.
+    long unsolvable;    // Including puzzles with conflicting clues.
+    long invalid;       // Lines of the wrong length or with unknown characters.
+    long over_budget;   // Searches stopped by the node or time budget, and
+                        // not retried. Written as a line of zeros.
+    long retried;       // Searches over budget solved again with the retry
+                        // engine. Counted as solved or unsolvable as well.
+    double seconds;     // Wall-clock time of the whole run.
+    sudoku_search_stats search; // Counters of every solve, summed over the
+                                // threads. 0 without SUDOKU_STATS.
+};
+
+/**
+    Options of a batch run.
+*/
+typedef struct sudoku_batch_opts sudoku_batch_opts;
+struct sudoku_batch_opts {
+    su_engine_t engine; // Engine for SUDOKU_SIZE puzzles.
+    int threads;        // Solver threads. 1 solves on the calling thread.
+    int size;           // 0 solves sudoku_field puzzles with the engine. Any
+                        // other size uses the sized kernel, see sudoku_kernel.h.
+    int count_limit;    // 0 solves. Otherwise counts solutions up to this
+                        // limit. SUDOKU_SIZE puzzles only.
+    int packed;         // Non-zero writes the solutions as a packed file.
+                        // Not when counting.
+    sudoku_cache* cache;// NULL, or a cache to solve SUDOKU_SIZE puzzles through.
+                        // Shared by the solver threads.
+    int pipeline;       // Non-zero reads, solves and writes at the same time
+                        // on separate threads, see sudoku_batch_solve.
+    long long max_nodes;// Search nodes allowed per puzzle. 0 for no limit.
+    double max_seconds; // Seconds allowed per puzzle. 0 for no limit. Budgets
+                        // only hold for SUDOKU_SIZE puzzles.
+    int retry_engine;   // Engine that solves puzzles over budget again,
+                        // without budget. -1 reports them instead.
+};
+
+/**
+    Solves every puzzle of a stream and writes the solutions to another.
+    With more than one thread the calling thread reads and writes while a
+    pool of solver threads solves, over a window of puzzles that is refilled
+    as it drains. Idle threads steal from busy ones, so one slow puzzle does
+    not keep the other threads waiting. Every thread reuses its own scratch
+    field.
+
+    Pipelined, a reader thread, opts->threads solver threads and the calling
+    thread as writer run at the same time and hand chunks of puzzles to each
+    other over bounded lock-free queues. Slow input or output then overlaps
+    with solving instead of stopping it, and a slow output holds the reader
+    back once every chunk is in flight, so memory stays bounded.
+
+    @param {FILE*} in - Stream to read puzzles from.
+    @param {FILE*} out - Stream to write solutions to.
+    @param {sudoku_batch_opts*} opts - Options of the batch.
+    @param {sudoku_batch_stats*} stats - Filled in with the counters of the run.
+    @return {int} - 0 if successful. Non-zero on read or write errors.
+*/
+int sudoku_batch_solve(FILE* in, FILE* out, const sudoku_batch_opts* opts, sudoku_batch_stats* stats);
+/**
+    Prints the throughput summary of a batch run.
+
+    @param {FILE*} out - Stream to print to.
+    @param {sudoku_batch_stats*} stats - The counters of the run.
+*/
+void print_sudoku_batch_stats(FILE* out, const sudoku_batch_stats* stats);
+
+/**
+    Counters of a verify run.
+*/
+typedef struct sudoku_verify_stats sudoku_verify_stats;
+struct sudoku_verify_stats {
+    long grids;         // Lines read, excluding empty lines.
+    long valid;
+    long unsolved;      // Lines of zeros, as written for puzzles without a solution.
+    long invalid;       // Lines that are not a valid grid, including wrong lengths.
+    long mismatched;    // Valid grids that change a clue of their puzzle.
+    double seconds;     // Wall-clock time of the whole run.
+};
+
+/**
+    Verifies every solution line of a stream, see sudoku_verify.h, and
+    reports the lines that fail to stderr. Lines are read as in
+    sudoku_batch_solve, so batch output can be checked against its input.
+
+    @param {FILE*} in - Stream to read solutions from.
+    @param {FILE*} puzzles - Stream to read the puzzle of every solution from.
+                             NULL to only check the grids.
+    @param {sudoku_verify_stats*} stats - Filled in with the counters of the run.
+    @return {int} - 0 if successful. Non-zero on read errors or if the
+                    puzzles end before the solutions.
+*/
+int sudoku_batch_verify(FILE* in, FILE* puzzles, sudoku_verify_stats* stats);
+/**
+    Prints the summary of a verify run.
+
+    @param {FILE*} out - Stream to print to.
+    @param {sudoku_verify_stats*} stats - The counters of the run.
+*/
+void print_sudoku_verify_stats(FILE* out, const sudoku_verify_stats* stats);
+
+#endif // SUDOKU_BATCH_H_INCLUDED
@@ -0,0 +1,207 @@
+// Sudoku solver benchmarking
+#define _POSIX_C_SOURCE 200809L // getline
+#include <stdio.h>      // For standard IO
+#include <stdlib.h>     // For standard stuff
+#include <string.h>     // strcmp, memcpy, memset
+
+#include "sudoku_general_tools.h"
+#include "sudoku_bench.h"
+#include "sudoku_parallel.h"
+
+/**
+    Benchmarking of the solver engines over a corpus of puzzles.
+*/
+
+// Format names, indexed by the SUDOKU_BENCH_ formats.
+static const char* format_names[] = {
+    "text",
+    "csv",
+    "json"
+};
+
+static int compare_doubles(const void* a, const void* b){
+    double x = *(const double*) a;
+    double y = *(const double*) b;
+    return (x > y) - (x < y);
+}
+/**
+    Solves a puzzle in place with the engine of the benchmark.
+*/
+static sudoku_field* bench_solve(sudoku_field* f, su_engine_t engine, const sudoku_bench_opts* opts){
+    if(opts->threads > 1)
+        return sudoku_solve_parallel(f, engine, opts->threads);
+    return sudoku_solve_engine(f, engine);
+}
+
+/**
+    Reads a corpus, one puzzle per line. Empty lines are skipped and lines
+    that can't be read are reported on stderr and skipped.
+
+    @param {FILE*} in - Stream to read puzzles from.
+    @param {sudoku_bench_corpus*} corpus - Filled in with the puzzles.
+    @return {int} - 0 if successful. Non-zero on read errors.
+*/
+int load_sudoku_bench_corpus(FILE* in, sudoku_bench_corpus* corpus){
+    char* line = NULL;
+    size_t line_cap = 0;
+    ssize_t len;
+    long line_nbr = 0;
+    long cap = 1024;
+    sudoku_field f;
+
+    corpus->count = 0;
+    corpus->puzzles = malloc(cap * SUDOKU_CELLS);
+    if(corpus->puzzles == NULL){
+        fprintf(stderr, "Could not allocate memory for the corpus, %d", __LINE__);
+        exit(1);
+    }
+    while((len = getline(&line, &line_cap, in)) != -1){
+        line_nbr++;
+        while(len > 0 && (line[len - 1] == '\n' || line[len - 1] == '\r'))
+            len--;
+        if(len == 0)
+            continue;
+        if(len != SUDOKU_CELLS || sudoku_read_line(&f, line) != SUDOKU_LINE_OK){
+            fprintf(stderr, "Line %ld: not a valid puzzle, skipped.\n", line_nbr);
+            continue;
+        }
+        if(corpus->count == cap){
+            cap *= 2;
+            corpus->puzzles = realloc(corpus->puzzles, cap * SUDOKU_CELLS);
+            if(corpus->puzzles == NULL){
+                fprintf(stderr, "Could not allocate memory for the corpus, %d", __LINE__);
+                exit(1);
+            }
+        }
+        memcpy(corpus->puzzles + corpus->count++ * SUDOKU_CELLS, line, SUDOKU_CELLS);
+    }
+    free(line);
+    return ferror(in);
+}
+/**
+    Frees the puzzles of a corpus.
+    @param {sudoku_bench_corpus*} corpus - The corpus.
+*/
+void free_sudoku_bench_corpus(sudoku_bench_corpus* corpus){
+    free(corpus->puzzles);
+    corpus->puzzles = NULL;
+    corpus->count = 0;
+}
+/**
+    Benchmarks one engine on a corpus.
+
+    @param {sudoku_bench_corpus*} corpus - The puzzles, at least one.
+    @param {su_engine_t} engine - The engine to time.
+    @param {sudoku_bench_opts*} opts - Options of the benchmark.
+    @param {sudoku_bench_result*} result - Filled in with the results.
+*/
+void sudoku_bench_run(const sudoku_bench_corpus* corpus, su_engine_t engine,
+                            const sudoku_bench_opts* opts, sudoku_bench_result* result){
+    sudoku_field f; // Reused for every solve.
+    long n = (long) opts->passes * corpus->count;
+    double* latency;
+    double start, total = 0;
+    long i, k = 0;
+    int pass;
+
+    memset(result, 0, sizeof(*result));
+    result->engine = engine;
+    if(n <= 0) // Nothing to time.
+        return;
+    latency = malloc(n * sizeof(double));
+    if(latency == NULL){
+        fprintf(stderr, "Could not allocate memory for the latencies, %d", __LINE__);
+        exit(1);
+    }
+    result->solves = n;
+    for(pass = 0; pass < opts->warmup; pass++){
+        for(i = 0; i < corpus->count; i++){
+            sudoku_read_line(&f, corpus->puzzles + i * SUDOKU_CELLS);
+            bench_solve(&f, engine, opts);
+        }
+    }
+    take_sudoku_search_stats(NULL);
+    for(pass = 0; pass < opts->passes; pass++){
+        for(i = 0; i < corpus->count; i++){
+            sudoku_read_line(&f, corpus->puzzles + i * SUDOKU_CELLS);
+            start = sudoku_clock_seconds();
+            if(bench_solve(&f, engine, opts) == NULL)
+                result->unsolvable++;
+            latency[k] = sudoku_clock_seconds() - start;
+            total += latency[k++];
+        }
+    }
+    take_sudoku_search_stats(&result->search);
+    qsort(latency, n, sizeof(double), compare_doubles);
+    result->min = latency[0];
+    result->median = n % 2 ? latency[n / 2] : (latency[n / 2 - 1] + latency[n / 2]) / 2;
+    result->p99 = latency[(n * 99 + 99) / 100 - 1]; // Nearest rank.
+    result->max = latency[n - 1];
+    result->mean = total / n;
+    result->puzzles_per_second = total > 0 ? n / total : 0.0;
+
+    free(latency);
+}
+/**
+    Prints benchmark results, one row per engine.
+
+    @param {FILE*} out - Stream to print to.
+    @param {sudoku_bench_result*} results - The results.
+    @param {int} n - Number of results.
+    @param {int} format - One of the SUDOKU_BENCH_ formats.
+*/
+void print_sudoku_bench_results(FILE* out, const sudoku_bench_result* results, int n, int format){
+    const sudoku_bench_result* r;
+    int i;
+
+    switch(format){
+        case(SUDOKU_BENCH_CSV):
+            fprintf(out, "engine,solves,unsolvable,min_us,median_us,p99_us,max_us,mean_us,puzzles_per_s\n");
+            for(i = 0; i < n; i++){
+                r = results + i;
+                fprintf(out, "%s,%ld,%ld,%.3f,%.3f,%.3f,%.3f,%.3f,%.1f\n", sudoku_engine_name(r->engine),
+                        r->solves, r->unsolvable, r->min * 1e6, r->median * 1e6, r->p99 * 1e6,
+                        r->max * 1e6, r->mean * 1e6, r->puzzles_per_second);
+            }
+            break;
+        case(SUDOKU_BENCH_JSON):
+            fprintf(out, "[\n");
+            for(i = 0; i < n; i++){
+                r = results + i;
+                fprintf(out, "  {\"engine\": \"%s\", \"solves\": %ld, \"unsolvable\": %ld, "
+                        "\"min_us\": %.3f, \"median_us\": %.3f, \"p99_us\": %.3f, \"max_us\": %.3f, "
+                        "\"mean_us\": %.3f, \"puzzles_per_s\": %.1f", sudoku_engine_name(r->engine),
+                        r->solves, r->unsolvable, r->min * 1e6, r->median * 1e6, r->p99 * 1e6,
+                        r->max * 1e6, r->mean * 1e6, r->puzzles_per_second);
+#ifdef SUDOKU_STATS
+                fprintf(out, ", \"search\": ");
+                print_sudoku_search_stats_json(out, &r->search);
+#endif
+                fprintf(out, "}%s\n", i + 1 < n ? "," : "");
+            }
+            fprintf(out, "]\n");
+            break;
+        default:
+            fprintf(out, "%-10s %10s %10s %10s %10s %10s %12s\n",
+                        "engine", "min us", "median us", "p99 us", "max us", "mean us", "puzzles/s");
+            for(i = 0; i < n; i++){
+                r = results + i;
+                fprintf(out, "%-10s %10.2f %10.2f %10.2f %10.2f %10.2f %12.0f\n", sudoku_engine_name(r->engine),
+                        r->min * 1e6, r->median * 1e6, r->p99 * 1e6, r->max * 1e6, r->mean * 1e6,
+                        r->puzzles_per_second);
+            }
+    }
+}
+/**
+    Gets the output format with a given name, "text", "csv" or "json".
+    @param {char*} name - The format name.
+    @return {int} - The SUDOKU_BENCH_ format. -1 if there is no such format.
+*/
+int sudoku_bench_format_from_name(const char* name){
+    int i;
+    for(i = 0; i < (int) (sizeof(format_names) / sizeof(format_names[0])); i++){
+        if(strcmp(name, format_names[i]) == 0)
+            return i;
+    }
+    return -1;
+}
@@ -0,0 +1,98 @@
+#ifndef SUDOKU_BENCH_H_INCLUDED
+#define SUDOKU_BENCH_H_INCLUDED
+
+#include <stdio.h>      // FILE
+
+#include "sudoku_general_tools.h"
+
+/**
+    Benchmarking of the solver engines over a corpus of puzzles. Every solve
+    is timed on its own with the wall clock. Reading the puzzle into the
+    scratch field is not part of the time, and nothing is allocated while
+    timing.
+*/
+
+// Output formats of print_sudoku_bench_results.
+#define SUDOKU_BENCH_TEXT   (0)
+#define SUDOKU_BENCH_CSV    (1)
+#define SUDOKU_BENCH_JSON   (2)
+
+/**
+    Puzzles to benchmark on, SUDOKU_CELLS characters each in the format of
+    sudoku_read_line, without line breaks.
+*/
+typedef struct sudoku_bench_corpus sudoku_bench_corpus;
+struct sudoku_bench_corpus {
+    char* puzzles;
+    long count;
+};
+
+/**
+    Options of a benchmark.
+*/
+typedef struct sudoku_bench_opts sudoku_bench_opts;
+struct sudoku_bench_opts {
+    int warmup;     // Untimed passes over the corpus before timing.
+    int passes;     // Timed passes over the corpus.
+    int threads;    // Threads per solve, see sudoku_solve_parallel.
+};
+
+/**
+    Results of one engine. Latencies are in seconds.
+*/
+typedef struct sudoku_bench_result sudoku_bench_result;
+struct sudoku_bench_result {
+    su_engine_t engine;
+    long solves;            // Timed solves, passes * puzzles.
+    long unsolvable;        // Timed solves that found no solution.
+    double min;
+    double median;
+    double p99;
+    double max;
+    double mean;
+    double puzzles_per_second;  // Solves per second of solving time.
+    sudoku_search_stats search; // Counters of the timed solves on the calling
+                                // thread. 0 without SUDOKU_STATS.
+};
+
+/**
+    Reads a corpus, one puzzle per line. Empty lines are skipped and lines
+    that can't be read are reported on stderr and skipped.
+
+    @param {FILE*} in - Stream to read puzzles from.
+    @param {sudoku_bench_corpus*} corpus - Filled in with the puzzles.
+    @return {int} - 0 if successful. Non-zero on read errors.
+*/
+int load_sudoku_bench_corpus(FILE* in, sudoku_bench_corpus* corpus);
+/**
+    Frees the puzzles of a corpus.
+    @param {sudoku_bench_corpus*} corpus - The corpus.
+*/
+void free_sudoku_bench_corpus(sudoku_bench_corpus* corpus);
+/**
+    Benchmarks one engine on a corpus.
+
+    @param {sudoku_bench_corpus*} corpus - The puzzles, at least one.
+    @param {su_engine_t} engine - The engine to time.
+    @param {sudoku_bench_opts*} opts - Options of the benchmark.
+    @param {sudoku_bench_result*} result - Filled in with the results.
+*/
+void sudoku_bench_run(const sudoku_bench_corpus* corpus, su_engine_t engine,
+                            const sudoku_bench_opts* opts, sudoku_bench_result* result);
+/**
+    Prints benchmark results, one row per engine.
+
+    @param {FILE*} out - Stream to print to.
+    @param {sudoku_bench_result*} results - The results.
+    @param {int} n - Number of results.
+    @param {int} format - One of the SUDOKU_BENCH_ formats.
+*/
+void print_sudoku_bench_results(FILE* out, const sudoku_bench_result* results, int n, int format);
+/**
+    Gets the output format with a given name, "text", "csv" or "json".
+    @param {char*} name - The format name.
+    @return {int} - The SUDOKU_BENCH_ format. -1 if there is no such format.
+*/
+int sudoku_bench_format_from_name(const char* name);
+
+#endif // SUDOKU_BENCH_H_INCLUDED
@@ -0,0 +1,244 @@
+// Sudoku solver with a vectorized candidate scan
+#include <stdio.h>      // For standard IO
+#include <stdlib.h>     // For standard stuff
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>  // AVX2 and SSE4.1 intrinsics
+#define BITBOARD_X86 (1)
+#endif
+
+#include "sudoku_general_tools.h"
+
+/**
+    The bitboard engine. Every step starts with a scan that computes the
+    candidates of all cells from the row, column and box masks, finds the
+    cell with the fewest candidates and marks every naked single.
+
+    The vectorized scan keeps one row per 256-bit register, 16 lanes of 16
+    bits of which SUDOKU_SIZE are used, and packs the candidate count and
+    the rc index of every empty cell into one 16-bit key
+    (count << BITBOARD_RC_BITS | rc) so that the minimum key over the whole
+    field, and with it the most constrained cell, falls out of a few
+    unsigned 16-bit min instructions. Filled cells get the key 0xFFFF.
+*/
+
+#define BITBOARD_LANES   (16)
+#define BITBOARD_RC_BITS (7)
+#define BITBOARD_NO_KEY  (0xFFFF)
+
+// The vectorized scan packs rc into BITBOARD_RC_BITS and a row into one register.
+#if defined(BITBOARD_X86) && SUDOKU_CELLS <= (1 << BITBOARD_RC_BITS) && SUDOKU_SIZE <= BITBOARD_LANES
+#define BITBOARD_AVX2 (1)
+#endif
+
+/**
+    Result of a scan of the whole field.
+*/
+typedef struct bitboard_scan bitboard_scan;
+struct bitboard_scan {
+    su_cell_t cand[SUDOKU_SIZE][BITBOARD_LANES];    // Candidates. ZERO for filled cells.
+    unsigned singles[SUDOKU_SIZE];  // Two bits per column for the naked singles of each row.
+    int best_rc;        // Cell with the fewest candidates or SUDOKU_NO_EMPTY_CELL/SUDOKU_DEAD_CELL.
+    int best_count;
+};
+/**
+    Cells placed by the engine, so that they can be unset on backtrack.
+*/
+typedef struct bitboard_trail bitboard_trail;
+struct bitboard_trail {
+    int rc[SUDOKU_CELLS];
+    int len;
+};
+typedef void (*bitboard_scan_fn)(const sudoku_field*, bitboard_scan*);
+
+/**
+    Scalar scan. Same result as the vectorized scan.
+*/
+static void bitboard_scan_scalar(const sudoku_field* f, bitboard_scan* s){
+    int r, c, rc, count;
+    unsigned best_key = BITBOARD_NO_KEY;
+    unsigned key;
+    su_cell_t cand;
+
+    for(r = 0; r < SUDOKU_SIZE; r++){
+        s->singles[r] = 0;
+        for(c = 0; c < SUDOKU_SIZE; c++){
+            rc = r_and_c_to_rc(r, c);
+            if(get_cell_lin(f, rc)){
+                s->cand[r][c] = ZERO;
+                continue;
+            }
+            cand = get_candidates_lin(f, rc);
+            s->cand[r][c] = cand;
+            count = count_candidates(cand);
+            if(count == 1)
+                s->singles[r] |= 3u << (2 * c);
+            key = ((unsigned) count << BITBOARD_RC_BITS) | rc;
+            if(key < best_key)
+                best_key = key;
+        }
+    }
+    if(best_key == BITBOARD_NO_KEY){
+        s->best_rc = SUDOKU_NO_EMPTY_CELL;
+        return;
+    }
+    s->best_count = best_key >> BITBOARD_RC_BITS;
+    s->best_rc = s->best_count ? (int) (best_key & ((1 << BITBOARD_RC_BITS) - 1)) : SUDOKU_DEAD_CELL;
+}
+
+#ifdef BITBOARD_AVX2
+/**
+    Vectorized scan, one row per register. See the top of the file.
+*/
+__attribute__((target("avx2")))
+static void bitboard_scan_avx2(const sudoku_field* f, bitboard_scan* s){
+    const __m256i all  = _mm256_set1_epi16(SUDOKU_ALL_VALUES);
+    const __m256i ones = _mm256_set1_epi16(1);
+    const __m256i nib  = _mm256_set1_epi8(0x0F);
+    const __m256i pop4 = _mm256_setr_epi8(0,1,1,2,1,2,2,3,1,2,2,3,2,3,3,4,
+                                          0,1,1,2,1,2,2,3,1,2,2,3,2,3,3,4);
+    const __m256i lane = _mm256_setr_epi16(0,1,2,3,4,5,6,7,8,9,10,11,12,13,14,15);
+    // Lanes past SUDOKU_SIZE are treated as filled cells.
+    const __m256i pad  = _mm256_cmpgt_epi16(lane, _mm256_set1_epi16(SUDOKU_SIZE - 1));
+    // The column masks are followed by the box masks and the cells in the field.
+    const __m256i colv = _mm256_loadu_si256((const __m256i*) f->col_contains);
+    __m256i best = _mm256_set1_epi16((short) BITBOARD_NO_KEY);
+    __m256i boxv = _mm256_setzero_si256();
+    __m256i rowv, cells, empty, cand, count, key;
+    su_cell_t box_lanes[BITBOARD_LANES];
+    __m128i m;
+    unsigned best_key;
+    int r, c;
+
+    for(r = 0; r < SUDOKU_SIZE; r++){
+        if(r % SUDOKU_BOX_WIDTH == 0){
+            for(c = 0; c < BITBOARD_LANES; c++)
+                box_lanes[c] = c < SUDOKU_SIZE ? *(f->box_contains + r_and_c_to_b(r, c)) : ZERO;
+            boxv = _mm256_loadu_si256((const __m256i*) box_lanes);
+        }
+        rowv = _mm256_set1_epi16(*(f->row_contains + r));
+        // Cells of the row. Only SUDOKU_SIZE lanes are read, the rest are zero.
+        cells = _mm256_set_m128i(
+                    _mm_cvtsi32_si128(SUDOKU_SIZE > 8 ? get_cell_lin(f, r * SUDOKU_SIZE + 8) : 0),
+                    _mm_loadu_si128((const __m128i*) (f->field + r * SUDOKU_SIZE)));
+        empty = _mm256_andnot_si256(pad, _mm256_cmpeq_epi16(cells, _mm256_setzero_si256()));
+        cand  = _mm256_and_si256(_mm256_andnot_si256(
+                    _mm256_or_si256(rowv, _mm256_or_si256(colv, boxv)), all), empty);
+        _mm256_storeu_si256((__m256i*) s->cand[r], cand);
+
+        // Popcount per 16-bit lane: nibble lookup, then add the two bytes.
+        count = _mm256_add_epi8(
+                    _mm256_shuffle_epi8(pop4, _mm256_and_si256(cand, nib)),
+                    _mm256_shuffle_epi8(pop4, _mm256_and_si256(_mm256_srli_epi16(cand, 4), nib)));
+        count = _mm256_maddubs_epi16(count, _mm256_set1_epi8(1));
+        s->singles[r] = (unsigned) _mm256_movemask_epi8(_mm256_cmpeq_epi16(count, ones));
+
+        key = _mm256_or_si256(_mm256_slli_epi16(count, BITBOARD_RC_BITS),
+                              _mm256_add_epi16(lane, _mm256_set1_epi16(r * SUDOKU_SIZE)));
+        key = _mm256_or_si256(key, _mm256_xor_si256(empty, _mm256_set1_epi16(-1)));
+        best = _mm256_min_epu16(best, key);
+    }
+    m = _mm_min_epu16(_mm256_castsi256_si128(best), _mm256_extracti128_si256(best, 1));
+    best_key = (unsigned) _mm_extract_epi16(_mm_minpos_epu16(m), 0);
+    if(best_key == BITBOARD_NO_KEY){
+        s->best_rc = SUDOKU_NO_EMPTY_CELL;
+        return;
+    }
+    s->best_count = best_key >> BITBOARD_RC_BITS;
+    s->best_rc = s->best_count ? (int) (best_key & ((1 << BITBOARD_RC_BITS) - 1)) : SUDOKU_DEAD_CELL;
+}
+#endif
+
+static void bitboard_undo(sudoku_field* f, bitboard_trail* t, int mark){
+    int rc;
+    while(t->len > mark){
+        rc = t->rc[--t->len];
+        unset_cell_lin(f, rc, get_cell_lin(f, rc));
+    }
+}
+/**
+    Places every naked single of a scan.
+    @return {int} - 0 if successful. Non-zero if two singles collide.
+*/
+static int bitboard_place_singles(sudoku_field* f, const bitboard_scan* s, bitboard_trail* t){
+    int r, c, rc;
+    unsigned m;
+    for(r = 0; r < SUDOKU_SIZE; r++){
+        m = s->singles[r];
+        while(m){
+            c = __builtin_ctz(m) / 2;
+            m &= ~(3u << (2 * c));
+            rc = r_and_c_to_rc(r, c);
+            if(set_cell_lin(f, rc, s->cand[r][c]))
+                return 1;
+            SUDOKU_STAT_ADD(propagations, 1);
+            t->rc[t->len++] = rc;
+        }
+    }
+    return 0;
+}
+static sudoku_field* solve_rec_bitboard(sudoku_field* f, bitboard_scan_fn scan,
+                                        bitboard_trail* t, sudoku_solve_ctl* ctl){
+    bitboard_scan s;
+    int mark = t->len;
+    int guess_mark, rc;
+    su_cell_t candidates, cell_test_value;
+
+    if(sudoku_solve_stopped(ctl))
+        return NULL;
+    while(1){
+        scan(f, &s);
+        if(s.best_rc == SUDOKU_NO_EMPTY_CELL)
+            return f;
+        if(s.best_rc == SUDOKU_DEAD_CELL)
+            break;
+        if(s.best_count > 1){
+            rc = s.best_rc;
+            guess_mark = t->len;
+            candidates = s.cand[rc_to_r(rc)][rc_to_c(rc)];
+            while(candidates){
+                cell_test_value = candidates & (~candidates + 1); // Lowest candidate.
+                candidates ^= cell_test_value;
+                set_cell_lin(f, rc, cell_test_value); // Can't fail, it's a candidate.
+                t->rc[t->len++] = rc;
+                SUDOKU_STAT_DOWN();
+                if(solve_rec_bitboard(f, scan, t, ctl) != NULL){
+                    SUDOKU_STAT_UP();
+                    return f;
+                }
+                SUDOKU_STAT_UP();
+                SUDOKU_STAT_ADD(backtracks, 1);
+                bitboard_undo(f, t, guess_mark);
+            }
+            break;
+        }
+        if(bitboard_place_singles(f, &s, t))
+            break;
+    }
+    bitboard_undo(f, t, mark);
+    return NULL;
+}
+
+/**
+    Tries to solve the input sudoku by scanning the candidates of every cell
+    at once before each step. All naked singles found by a scan are placed
+    together, otherwise the search branches on the cell with the fewest
+    candidates. The scan is vectorized (AVX2) when asked for and supported by
+    the CPU, and scalar otherwise, so both can be compared on equal terms.
+
+    @param {sudoku_field*} f - Input sudoku to solve.
+    @param {int} vectorized - Non-zero to use the vectorized scan.
+    @param {sudoku_solve_ctl*} ctl - Search control. May be NULL.
+    @return {sudoku_field*} - The input field (solved) if successful. NULL otherwise.
+*/
+sudoku_field*   sudoku_solve_bitboard(sudoku_field* f, int vectorized, sudoku_solve_ctl* ctl){
+    bitboard_trail t;
+    bitboard_scan_fn scan = bitboard_scan_scalar;
+
+#ifdef BITBOARD_AVX2
+    if(vectorized && __builtin_cpu_supports("avx2"))
+        scan = bitboard_scan_avx2;
+#endif
+    t.len = 0;
+    return solve_rec_bitboard(f, scan, &t, ctl);
+}
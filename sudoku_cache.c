@@ -0,0 +1,715 @@
+// Sudoku canonical forms and solution cache
+#include <stdlib.h>     // malloc, free
+#include <string.h>     // memcpy, memcmp, memset
+#include <stdint.h>     // uint32_t, uint64_t
+#include <pthread.h>    // Cache lock
+
+#include "sudoku_general_tools.h"
+#include "sudoku_cache.h"
+
+/**
+    Canonical forms, see sudoku_cache.h.
+
+    The form is built one row at a time. Every partial transform that gives
+    the smallest rows so far is kept and extended by each row it may take
+    next, and only the extensions giving the smallest next row are kept. The
+    first row fixes the order of the stacks, the stacks with the most clues
+    going first, and puts the clues of each stack before its empty cells.
+    Columns of a stack that are empty in every row taken so far can still be
+    swapped without changing anything, so rather than one state per order
+    they are kept in one order and marked as tied. The next row orders every
+    run of tied columns: digits seen before first, then new digits, then
+    empty cells. Only the orders of the new digits make different states, as
+    they label the digits differently.
+*/
+
+#define BAND (SUDOKU_BOX_WIDTH) // Rows of a band, columns of a stack.
+
+// The orders of three things.
+static const unsigned char perm3[6][3] = {
+    {0, 1, 2}, {0, 2, 1}, {1, 0, 2}, {1, 2, 0}, {2, 0, 1}, {2, 1, 0}
+};
+
+/**
+    A partial transform, the first rows of a candidate canonical form.
+*/
+typedef struct canon_state canon_state;
+struct canon_state {
+    unsigned char col[SUDOKU_SIZE];         // As in sudoku_transform.
+    unsigned char row[SUDOKU_SIZE];         // Rows taken so far.
+    unsigned char label[SUDOKU_SIZE + 1];   // 0 for digits not seen yet.
+    unsigned char next;                     // Next new digit to hand out.
+    unsigned char transpose;
+    unsigned short used;                    // Rows taken so far, one bit each.
+    unsigned short tied;                    // Bit j set if columns j and j + 1
+                                            // are empty in every row so far.
+};
+
+/**
+    Order of a cell in the comparison, the digits before the empty cell.
+*/
+static inline int canon_rank(int v){
+    return v ? v : SUDOKU_SIZE + 1;
+}
+/**
+    Compares the clue counts of the stacks of two rows, sorted largest first.
+    The row with more clues in its fullest stacks gives the smaller first row.
+    @return {int} - Negative if a gives the smaller first row, 0 if equal.
+*/
+static int canon_cmp_counts(const int* a, const int* b){
+    int i;
+    for(i = 0; i < BAND; i++)
+        if(a[i] != b[i])
+            return b[i] - a[i];
+    return 0;
+}
+/**
+    Counts the clues of each stack of a row, and sorts the counts into
+    sorted, largest first.
+*/
+static void canon_counts(const unsigned char* row, int* count, int* sorted){
+    int s, i, tmp;
+    for(s = 0; s < BAND; s++){
+        count[s] = 0;
+        for(i = 0; i < BAND; i++)
+            count[s] += row[s * BAND + i] != 0;
+        sorted[s] = count[s];
+    }
+    for(s = 1; s < BAND; s++)
+        for(i = s; i > 0 && sorted[i] > sorted[i - 1]; i--){
+            tmp = sorted[i];
+            sorted[i] = sorted[i - 1];
+            sorted[i - 1] = tmp;
+        }
+}
+/**
+    Adds the states for every column order giving a row its smallest form as
+    the first row.
+    @return {int} - Non-zero if there are too many states.
+*/
+static int canon_first_row(const unsigned char* grid, int transpose, int r, const int* count,
+                                                    canon_state* states, int* n){
+    const unsigned char* row = grid + r * SUDOKU_SIZE;
+    int ok[BAND][6];    // Non-zero for the orders putting the clues of a stack first.
+    int p, s, w, i, j;
+    int w0, w1, w2;
+    const unsigned char* stacks;
+    canon_state* st;
+
+    // Empty cells go last, in one order since they are tied.
+    for(s = 0; s < BAND; s++)
+        for(w = 0; w < 6; w++){
+            ok[s][w] = 1;
+            for(i = 1; i < BAND; i++)
+                if(!row[s * BAND + perm3[w][i - 1]] && (row[s * BAND + perm3[w][i]]
+                                            || perm3[w][i - 1] > perm3[w][i]))
+                    ok[s][w] = 0;
+        }
+    for(p = 0; p < 6; p++){
+        stacks = perm3[p];
+        if(count[stacks[0]] < count[stacks[1]] || count[stacks[1]] < count[stacks[2]])
+            continue;
+        for(w0 = 0; w0 < 6; w0++){
+            if(!ok[stacks[0]][w0])
+                continue;
+            for(w1 = 0; w1 < 6; w1++){
+                if(!ok[stacks[1]][w1])
+                    continue;
+                for(w2 = 0; w2 < 6; w2++){
+                    if(!ok[stacks[2]][w2])
+                        continue;
+                    if(*n == SUDOKU_CANON_MAX_TIES)
+                        return 1;
+                    st = states + (*n)++;
+                    for(i = 0; i < BAND; i++){
+                        st->col[i]            = stacks[0] * BAND + perm3[w0][i];
+                        st->col[BAND + i]     = stacks[1] * BAND + perm3[w1][i];
+                        st->col[2 * BAND + i] = stacks[2] * BAND + perm3[w2][i];
+                    }
+                    memset(st->label, 0, sizeof(st->label));
+                    st->next = 1;
+                    st->tied = 0;
+                    for(j = 0; j < SUDOKU_SIZE; j++){
+                        if(row[st->col[j]])
+                            st->label[row[st->col[j]]] = st->next++;
+                        else if(j % BAND && !row[st->col[j - 1]])
+                            st->tied |= 1 << (j - 1);
+                    }
+                    st->row[0] = r;
+                    st->used = 1 << r;
+                    st->transpose = transpose;
+                }
+            }
+        }
+    }
+    return 0;
+}
+/**
+    Orders the tied columns of a state for its next row: in every run of
+    tied columns the digits seen before come first, smallest label first,
+    then the new digits, then the empty cells.
+
+    @param {canon_state*} s - The state.
+    @param {unsigned char*} src - The next row.
+    @param {unsigned char*} col - Set to the column order.
+    @param {int*} seg - Set to the first column of the new digits of every run
+                        with more than one.
+    @param {int*} seg_len - Set to the number of those new digits.
+    @return {int} - Number of runs with more than one new digit.
+*/
+static int canon_arrange(const canon_state* s, const unsigned char* src, unsigned char* col,
+                                                                    int* seg, int* seg_len){
+    int key[SUDOKU_SIZE];
+    int start, end, i, j, v, n_new, tmp;
+    int n_seg = 0;
+
+    memcpy(col, s->col, SUDOKU_SIZE);
+    for(start = 0; s->tied && start < SUDOKU_SIZE; start = end){
+        for(end = start + 1; end < SUDOKU_SIZE && s->tied & (1 << (end - 1)); end++)
+            ;
+        if(end - start == 1)
+            continue;
+        n_new = 0;
+        for(i = start; i < end; i++){
+            v = src[col[i]];
+            key[i] = !v ? SUDOKU_SIZE + 2 : s->label[v] ? s->label[v] : SUDOKU_SIZE + 1;
+            n_new += key[i] == SUDOKU_SIZE + 1;
+        }
+        // Sorted on the key, equal keys in column order.
+        for(i = start + 1; i < end; i++)
+            for(j = i; j > start && (key[j] < key[j - 1] || (key[j] == key[j - 1] && col[j] < col[j - 1])); j--){
+                tmp = key[j];
+                key[j] = key[j - 1];
+                key[j - 1] = tmp;
+                tmp = col[j];
+                col[j] = col[j - 1];
+                col[j - 1] = tmp;
+            }
+        if(n_new > 1){
+            for(i = start; key[i] != SUDOKU_SIZE + 1; i++)
+                ;
+            seg[n_seg] = i;
+            seg_len[n_seg++] = n_new;
+        }
+    }
+    return n_seg;
+}
+/**
+    Finds the canonical form of a puzzle.
+
+    @param {char*} puzzle - The puzzle, SUDOKU_CELLS characters.
+    @param {char*} key - Buffer of SUDOKU_CELLS characters. Set to the canonical form.
+    @param {sudoku_transform*} t - Set to the transform from the puzzle to the key.
+    @return {int} - 0 if successful. Non-zero if the puzzle has an unknown
+                    character or more than SUDOKU_CANON_MAX_TIES ties.
+*/
+int             sudoku_canonical_form(const char* puzzle, char* key, sudoku_transform* t){
+    unsigned char grid[2][SUDOKU_CELLS];    // The puzzle and its transpose.
+    canon_state buf[2][SUDOKU_CANON_MAX_TIES];
+    canon_state* cur = buf[0];
+    canon_state* next = buf[1];
+    canon_state* tmp;
+    unsigned char best[SUDOKU_SIZE];
+    unsigned char row[SUDOKU_SIZE];
+    unsigned char col[SUDOKU_SIZE];
+    unsigned char label[SUDOKU_SIZE + 1];
+    const unsigned char* src;
+    int count[BAND], sorted[BAND], best_sorted[BAND];
+    int seg[SUDOKU_SIZE], seg_len[SUDOKU_SIZE];
+    int n_cur = 0, n_next, have_best;
+    int r, c, k, i, j, v, d, order, lo, hi;
+    int n_seg, n_orders, choice, g, w;
+    unsigned short tied;
+    unsigned char n_label;
+    const canon_state* s;
+
+    for(r = 0; r < SUDOKU_SIZE; r++)
+        for(c = 0; c < SUDOKU_SIZE; c++){
+            v = puzzle[r * SUDOKU_SIZE + c];
+            if(v == '.')
+                v = 0;
+            else if(v >= '0' && v <= '0' + SUDOKU_SIZE)
+                v -= '0';
+            else
+                return 1;
+            grid[0][r * SUDOKU_SIZE + c] = v;
+            grid[1][c * SUDOKU_SIZE + r] = v;
+        }
+
+    // First row: the rows with the most clues in their fullest stacks.
+    have_best = 0;
+    for(i = 0; i < 2; i++)
+        for(r = 0; r < SUDOKU_SIZE; r++){
+            canon_counts(grid[i] + r * SUDOKU_SIZE, count, sorted);
+            if(!have_best || canon_cmp_counts(sorted, best_sorted) < 0){
+                memcpy(best_sorted, sorted, sizeof(sorted));
+                have_best = 1;
+            }
+        }
+    for(i = 0; i < 2; i++)
+        for(r = 0; r < SUDOKU_SIZE; r++){
+            canon_counts(grid[i] + r * SUDOKU_SIZE, count, sorted);
+            if(canon_cmp_counts(sorted, best_sorted) == 0 &&
+                        canon_first_row(grid[i], i, r, count, cur, &n_cur))
+                return 1;
+        }
+    src = grid[cur->transpose] + cur->row[0] * SUDOKU_SIZE;
+    for(j = 0; j < SUDOKU_SIZE; j++)
+        key[j] = '0' + (src[cur->col[j]] ? cur->label[src[cur->col[j]]] : 0);
+
+    // Every other row: the smallest of the rows each state may take next.
+    for(k = 1; k < SUDOKU_SIZE; k++){
+        n_next = 0;
+        have_best = 0;
+        for(i = 0; i < n_cur; i++){
+            s = cur + i;
+            if(k % BAND == 0){ // A new band, any row not taken yet.
+                lo = 0;
+                hi = SUDOKU_SIZE;
+            }else{ // The band of the previous row.
+                lo = s->row[k - 1] / BAND * BAND;
+                hi = lo + BAND;
+            }
+            for(r = lo; r < hi; r++){
+                if(s->used & (1 << r))
+                    continue;
+                src = grid[s->transpose] + r * SUDOKU_SIZE;
+                n_seg = canon_arrange(s, src, col, seg, seg_len);
+                memcpy(label, s->label, sizeof(label));
+                n_label = s->next;
+                order = have_best ? 0 : -1; // 0 while equal to best, -1 once smaller.
+                for(j = 0; j < SUDOKU_SIZE; j++){
+                    v = src[col[j]];
+                    if(v){
+                        if(!label[v])
+                            label[v] = n_label++;
+                        v = label[v];
+                    }
+                    row[j] = v;
+                    if(order == 0){
+                        if(canon_rank(v) > canon_rank(best[j]))
+                            break;
+                        if(canon_rank(v) < canon_rank(best[j]))
+                            order = -1;
+                    }
+                }
+                if(j < SUDOKU_SIZE) // Larger than the best row.
+                    continue;
+                if(order < 0){
+                    memcpy(best, row, sizeof(best));
+                    have_best = 1;
+                    n_next = 0;
+                }
+                // Tied columns stay tied while empty.
+                tied = 0;
+                for(j = 0; j + 1 < SUDOKU_SIZE; j++)
+                    if(s->tied & (1 << j) && !row[j] && !row[j + 1])
+                        tied |= 1 << j;
+                // A state for every order of the new digits of each run.
+                n_orders = 1;
+                for(g = 0; g < n_seg; g++)
+                    n_orders *= seg_len[g] == BAND ? 6 : 2;
+                for(c = 0; c < n_orders; c++){
+                    if(n_next == SUDOKU_CANON_MAX_TIES)
+                        return 1;
+                    tmp = next + n_next++;
+                    *tmp = *s;
+                    memcpy(tmp->col, col, sizeof(col));
+                    for(g = 0, choice = c; g < n_seg; g++){
+                        // Two digits take the orders of perm3 keeping the third in place.
+                        w = seg_len[g] == BAND ? choice % 6 : choice % 2 * 2;
+                        choice /= seg_len[g] == BAND ? 6 : 2;
+                        for(j = 0; j < seg_len[g]; j++)
+                            tmp->col[seg[g] + j] = col[seg[g] + perm3[w][j]];
+                    }
+                    for(j = 0; j < SUDOKU_SIZE; j++){
+                        v = src[tmp->col[j]];
+                        if(v && !tmp->label[v])
+                            tmp->label[v] = tmp->next++;
+                    }
+                    tmp->tied = tied;
+                    tmp->row[k] = r;
+                    tmp->used |= 1 << r;
+                }
+            }
+        }
+        for(j = 0; j < SUDOKU_SIZE; j++)
+            key[k * SUDOKU_SIZE + j] = '0' + best[j];
+        tmp = cur;
+        cur = next;
+        next = tmp;
+        n_cur = n_next;
+    }
+
+    // Any of the states left gives the key. Digits not in the puzzle get
+    // the new digits left over, in order.
+    t->transpose = cur->transpose;
+    memcpy(t->row, cur->row, sizeof(t->row));
+    memcpy(t->col, cur->col, sizeof(t->col));
+    memcpy(t->label, cur->label, sizeof(t->label));
+    n_label = cur->next;
+    for(d = 1; d <= SUDOKU_SIZE; d++)
+        if(!t->label[d])
+            t->label[d] = n_label++;
+    return 0;
+}
+/**
+    Maps a grid in canonical form back to the puzzle a transform was found
+    for, eg the solution of the key to a solution of the puzzle.
+
+    @param {sudoku_transform*} t - The transform of the puzzle.
+    @param {char*} canonical - The grid in canonical form, SUDOKU_CELLS characters.
+    @param {char*} out - Buffer of SUDOKU_CELLS characters. Set to the grid.
+*/
+void            sudoku_transform_back(const sudoku_transform* t, const char* canonical, char* out){
+    unsigned char digit[SUDOKU_SIZE + 1];
+    int i, j, v, rc;
+
+    for(v = 0; v <= SUDOKU_SIZE; v++)
+        digit[t->label[v]] = v;
+    for(i = 0; i < SUDOKU_SIZE; i++)
+        for(j = 0; j < SUDOKU_SIZE; j++){
+            v = canonical[i * SUDOKU_SIZE + j];
+            v = v >= '1' && v <= '0' + SUDOKU_SIZE ? digit[v - '0'] : 0;
+            rc = t->transpose ? t->col[j] * SUDOKU_SIZE + t->row[i]
+                              : t->row[i] * SUDOKU_SIZE + t->col[j];
+            out[rc] = '0' + v;
+        }
+}
+/**
+    Applies a transform to a puzzle, the inverse of sudoku_transform_back.
+
+    @param {sudoku_transform*} t - The transform.
+    @param {char*} puzzle - The puzzle, SUDOKU_CELLS characters.
+    @param {char*} out - Buffer of SUDOKU_CELLS characters. Set to the
+                         transformed puzzle, '0' for empty cells.
+*/
+void            sudoku_transform_apply(const sudoku_transform* t, const char* puzzle, char* out){
+    int i, j, v, rc;
+
+    for(i = 0; i < SUDOKU_SIZE; i++)
+        for(j = 0; j < SUDOKU_SIZE; j++){
+            rc = t->transpose ? t->col[j] * SUDOKU_SIZE + t->row[i]
+                              : t->row[i] * SUDOKU_SIZE + t->col[j];
+            v = puzzle[rc];
+            v = v >= '1' && v <= '0' + SUDOKU_SIZE ? t->label[v - '0'] : 0;
+            out[i * SUDOKU_SIZE + j] = '0' + v;
+        }
+}
+/**
+    Gets the next number of a splitmix64 sequence.
+*/
+static uint64_t transform_rand(uint64_t* state){
+    uint64_t z = (*state += 0x9E3779B97F4A7C15ULL);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+/**
+    Shuffles n numbers in place.
+*/
+static void transform_shuffle(unsigned char* a, int n, uint64_t* state){
+    unsigned char tmp;
+    int i, j;
+
+    for(i = n - 1; i > 0; i--){
+        j = transform_rand(state) % (i + 1);
+        tmp = a[i];
+        a[i] = a[j];
+        a[j] = tmp;
+    }
+}
+/**
+    Picks an order of the rows or columns that keeps the bands or stacks.
+*/
+static void transform_random_lines(unsigned char* line, uint64_t* state){
+    unsigned char band[SUDOKU_SIZE / SUDOKU_BOX_WIDTH];
+    unsigned char within[SUDOKU_BOX_WIDTH];
+    int b, k;
+
+    for(b = 0; b < SUDOKU_SIZE / SUDOKU_BOX_WIDTH; b++)
+        band[b] = b;
+    transform_shuffle(band, SUDOKU_SIZE / SUDOKU_BOX_WIDTH, state);
+    for(b = 0; b < SUDOKU_SIZE / SUDOKU_BOX_WIDTH; b++){
+        for(k = 0; k < SUDOKU_BOX_WIDTH; k++)
+            within[k] = k;
+        transform_shuffle(within, SUDOKU_BOX_WIDTH, state);
+        for(k = 0; k < SUDOKU_BOX_WIDTH; k++)
+            line[b * SUDOKU_BOX_WIDTH + k] = band[b] * SUDOKU_BOX_WIDTH + within[k];
+    }
+}
+/**
+    Picks a transform at random: a random relabelling, random row and column
+    orders that keep the bands and stacks, and transposition half the time.
+
+    @param {sudoku_transform*} t - Set to the transform.
+    @param {uint64_t} seed - The same seed gives the same transform.
+*/
+void            sudoku_transform_random(sudoku_transform* t, uint64_t seed){
+    int v;
+
+    t->transpose = transform_rand(&seed) & 1;
+    transform_random_lines(t->row, &seed);
+    transform_random_lines(t->col, &seed);
+    for(v = 0; v <= SUDOKU_SIZE; v++)
+        t->label[v] = v;
+    transform_shuffle(t->label + 1, SUDOKU_SIZE, &seed);
+}
+
+// Solution cache
+
+/**
+    A cached key. Entries are linked into their hash chain and into the list
+    of entries from most to least recently used.
+*/
+typedef struct cache_entry cache_entry;
+struct cache_entry {
+    char key[SUDOKU_CELLS];
+    char solution[SUDOKU_CELLS];
+    char solved;        // 0 if the key is unsolvable.
+    uint32_t hash;
+    int chain;          // Next entry of the hash chain, -1 at the end.
+    int newer, older;   // Neighbours in the use order, -1 at the ends.
+};
+struct sudoku_cache {
+    pthread_mutex_t lock;
+    cache_entry* entries;
+    int* buckets;       // First entry of each hash chain, -1 if empty.
+    uint32_t mask;      // Number of buckets - 1.
+    int capacity;
+    int count;          // Entries in use, entries[0..count-1].
+    int newest, oldest; // Ends of the use order, -1 if empty.
+    long hits, misses, skipped;
+};
+
+/**
+    FNV-1a of a key.
+*/
+static uint32_t cache_hash(const char* key){
+    uint32_t h = 2166136261u;
+    int i;
+    for(i = 0; i < SUDOKU_CELLS; i++){
+        h ^= (unsigned char) key[i];
+        h *= 16777619u;
+    }
+    return h;
+}
+/**
+    Takes an entry out of the use order.
+*/
+static void cache_unlink(sudoku_cache* cache, int e){
+    cache_entry* entry = cache->entries + e;
+    if(entry->newer != -1)
+        cache->entries[entry->newer].older = entry->older;
+    else
+        cache->newest = entry->older;
+    if(entry->older != -1)
+        cache->entries[entry->older].newer = entry->newer;
+    else
+        cache->oldest = entry->newer;
+}
+/**
+    Puts an entry first in the use order.
+*/
+static void cache_push(sudoku_cache* cache, int e){
+    cache_entry* entry = cache->entries + e;
+    entry->newer = -1;
+    entry->older = cache->newest;
+    if(cache->newest != -1)
+        cache->entries[cache->newest].newer = e;
+    else
+        cache->oldest = e;
+    cache->newest = e;
+}
+/**
+    Finds the entry of a key.
+    @return {int} - The entry. -1 if not cached.
+*/
+static int cache_find(const sudoku_cache* cache, const char* key, uint32_t hash){
+    int e;
+    for(e = cache->buckets[hash & cache->mask]; e != -1; e = cache->entries[e].chain)
+        if(cache->entries[e].hash == hash && memcmp(cache->entries[e].key, key, SUDOKU_CELLS) == 0)
+            return e;
+    return -1;
+}
+/**
+    Allocates an empty cache.
+    @param {int} capacity - Most entries kept, at least 1.
+    @return {sudoku_cache*} - The cache. NULL if out of memory or capacity < 1.
+*/
+sudoku_cache*   init_sudoku_cache(int capacity){
+    sudoku_cache* cache;
+    uint32_t n_buckets = 1;
+
+    if(capacity < 1)
+        return NULL;
+    while(n_buckets < (uint32_t) capacity && n_buckets < (1u << 30))
+        n_buckets <<= 1;
+    if((cache = malloc(sizeof(sudoku_cache))) == NULL)
+        return NULL;
+    cache->entries = malloc((size_t) capacity * sizeof(cache_entry));
+    cache->buckets = malloc((size_t) n_buckets * sizeof(int));
+    if(cache->entries == NULL || cache->buckets == NULL){
+        free(cache->entries);
+        free(cache->buckets);
+        free(cache);
+        return NULL;
+    }
+    memset(cache->buckets, -1, (size_t) n_buckets * sizeof(int));
+    cache->mask = n_buckets - 1;
+    cache->capacity = capacity;
+    cache->count = 0;
+    cache->newest = cache->oldest = -1;
+    cache->hits = cache->misses = cache->skipped = 0;
+    pthread_mutex_init(&cache->lock, NULL);
+    return cache;
+}
+/**
+    Frees a cache.
+    @param {sudoku_cache*} cache - The cache. May be NULL.
+*/
+void            free_sudoku_cache(sudoku_cache* cache){
+    if(cache == NULL)
+        return;
+    pthread_mutex_destroy(&cache->lock);
+    free(cache->entries);
+    free(cache->buckets);
+    free(cache);
+}
+/**
+    Looks up a key and marks it as recently used.
+
+    @param {sudoku_cache*} cache - The cache.
+    @param {char*} key - A canonical form.
+    @param {char*} solution - Buffer of SUDOKU_CELLS characters. Set to the
+                              solution of the key if it has one.
+    @return {int} - SUDOKU_CACHE_SOLVED, SUDOKU_CACHE_UNSOLVABLE or SUDOKU_CACHE_MISS.
+*/
+int             sudoku_cache_get(sudoku_cache* cache, const char* key, char* solution){
+    uint32_t hash = cache_hash(key);
+    int e, ret;
+
+    pthread_mutex_lock(&cache->lock);
+    if((e = cache_find(cache, key, hash)) == -1){
+        cache->misses++;
+        ret = SUDOKU_CACHE_MISS;
+    }else{
+        cache->hits++;
+        cache_unlink(cache, e);
+        cache_push(cache, e);
+        if(cache->entries[e].solved){
+            memcpy(solution, cache->entries[e].solution, SUDOKU_CELLS);
+            ret = SUDOKU_CACHE_SOLVED;
+        }else{
+            ret = SUDOKU_CACHE_UNSOLVABLE;
+        }
+    }
+    pthread_mutex_unlock(&cache->lock);
+    return ret;
+}
+/**
+    Adds the outcome of a key, evicting the least recently used entry if full.
+
+    @param {sudoku_cache*} cache - The cache.
+    @param {char*} key - A canonical form.
+    @param {char*} solution - The solution of the key. NULL if unsolvable.
+*/
+void            sudoku_cache_put(sudoku_cache* cache, const char* key, const char* solution){
+    uint32_t hash = cache_hash(key);
+    cache_entry* entry;
+    int e, *link;
+
+    pthread_mutex_lock(&cache->lock);
+    if((e = cache_find(cache, key, hash)) != -1){ // Put by another thread meanwhile.
+        cache_unlink(cache, e);
+        cache_push(cache, e);
+        pthread_mutex_unlock(&cache->lock);
+        return;
+    }
+    if(cache->count < cache->capacity){
+        e = cache->count++;
+    }else{ // Reuse the oldest entry.
+        e = cache->oldest;
+        cache_unlink(cache, e);
+        link = cache->buckets + (cache->entries[e].hash & cache->mask);
+        while(*link != e)
+            link = &cache->entries[*link].chain;
+        *link = cache->entries[e].chain;
+    }
+    entry = cache->entries + e;
+    memcpy(entry->key, key, SUDOKU_CELLS);
+    entry->solved = solution != NULL;
+    if(solution != NULL)
+        memcpy(entry->solution, solution, SUDOKU_CELLS);
+    entry->hash = hash;
+    entry->chain = cache->buckets[hash & cache->mask];
+    cache->buckets[hash & cache->mask] = e;
+    cache_push(cache, e);
+    pthread_mutex_unlock(&cache->lock);
+}
+/**
+    Solves a puzzle through the cache. On a miss the canonical form is solved
+    with the engine and its outcome cached. Puzzles with more than one
+    solution get the one found for their class, which need not be the one the
+    engine finds for the puzzle itself.
+
+    @param {sudoku_cache*} cache - The cache.
+    @param {sudoku_field*} f - Scratch field for solving on a miss.
+    @param {su_engine_t} engine - The engine to solve with.
+    @param {sudoku_solve_ctl*} ctl - Search control of the solve on a miss. May be NULL.
+    @param {char*} puzzle - The puzzle, SUDOKU_CELLS characters.
+    @param {char*} solution - Buffer of SUDOKU_CELLS characters. Set to the
+                              solution if solved.
+    @return {int} - SUDOKU_CACHE_SOLVED or SUDOKU_CACHE_UNSOLVABLE.
+                    SUDOKU_CACHE_BUDGET if the solve was stopped by ctl.
+                    SUDOKU_CACHE_SKIPPED if the puzzle has no canonical form,
+                    in which case nothing is solved.
+*/
+int             sudoku_cache_solve(sudoku_cache* cache, sudoku_field* f, su_engine_t engine,
+                                    sudoku_solve_ctl* ctl, const char* puzzle, char* solution){
+    sudoku_transform t;
+    char key[SUDOKU_CELLS];
+    char canonical[SUDOKU_CELLS];
+    int ret;
+
+    if(sudoku_canonical_form(puzzle, key, &t)){
+        pthread_mutex_lock(&cache->lock);
+        cache->skipped++;
+        pthread_mutex_unlock(&cache->lock);
+        return SUDOKU_CACHE_SKIPPED;
+    }
+    ret = sudoku_cache_get(cache, key, canonical);
+    if(ret == SUDOKU_CACHE_MISS){
+        // The key is solved rather than the puzzle, so that the solution
+        // fits every puzzle of the class.
+        ret = SUDOKU_CACHE_UNSOLVABLE;
+        if(sudoku_read_line(f, key) == SUDOKU_LINE_OK){
+            switch(sudoku_solve_status(f, engine, ctl)){
+                case(SUDOKU_SOLVE_SOLVED):
+                    sudoku_write_line(f, canonical);
+                    ret = SUDOKU_CACHE_SOLVED;
+                    break;
+                case(SUDOKU_SOLVE_UNSOLVABLE):
+                    break;
+                default:
+                    // Says nothing about the class, so it isn't cached.
+                    return SUDOKU_CACHE_BUDGET;
+            }
+        }
+        sudoku_cache_put(cache, key, ret == SUDOKU_CACHE_SOLVED ? canonical : NULL);
+    }
+    if(ret == SUDOKU_CACHE_SOLVED)
+        sudoku_transform_back(&t, canonical, solution);
+    return ret;
+}
+/**
+    Prints the hit counters of a cache.
+    @param {FILE*} out - Stream to print to.
+    @param {sudoku_cache*} cache - The cache.
+*/
+void            print_sudoku_cache_stats(FILE* out, sudoku_cache* cache){
+    pthread_mutex_lock(&cache->lock);
+    fprintf(out, "Cache hits: %ld Misses: %ld Skipped: %ld Entries: %d\n",
+                cache->hits, cache->misses, cache->skipped, cache->count);
+    pthread_mutex_unlock(&cache->lock);
+}
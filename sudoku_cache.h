@@ -0,0 +1,149 @@
+#ifndef SUDOKU_CACHE_H_INCLUDED
+#define SUDOKU_CACHE_H_INCLUDED
+
+#include <stdio.h>      // FILE
+#include <stdint.h>     // uint64_t
+
+#include "sudoku_general_tools.h"
+
+/**
+    Canonical forms of SUDOKU_SIZE puzzles and a solution cache keyed on them.
+
+    A puzzle keeps its solutions, relabelled alike, when its digits are
+    permuted, rows are swapped within a band, bands are swapped, columns are
+    swapped within a stack, stacks are swapped or it is transposed. The
+    canonical form is the smallest puzzle that can be made this way, compared
+    cell by cell in reading order with the digits below the empty cell, and
+    with the digits relabelled 1, 2, 3.. in the order they first appear. Every
+    puzzle of a class has the same canonical form, so solving the canonical
+    puzzle once answers all of them through the inverse transform.
+
+    Puzzles and keys are SUDOKU_CELLS characters as read by sudoku_read_line,
+    '0' or '.' for an empty cell. Keys always use '0'.
+*/
+
+// Most partial transforms that can tie for the smallest form while it is
+// built. Orders of columns that are empty so far don't count, but every
+// order of the clues of the first row does, so puzzles with more ties get no
+// canonical form: nearly empty ones, and those with a full row or another
+// row of three full stacks (1296 orders).
+#define SUDOKU_CANON_MAX_TIES (512)
+
+/**
+    A transform of a puzzle into its canonical form.
+*/
+typedef struct sudoku_transform sudoku_transform;
+struct sudoku_transform {
+    unsigned char transpose;                // Non-zero if rows and columns are swapped first.
+    unsigned char row[SUDOKU_SIZE];         // Row of the (transposed) puzzle moved to each row.
+    unsigned char col[SUDOKU_SIZE];         // Column of the (transposed) puzzle moved to each column.
+    unsigned char label[SUDOKU_SIZE + 1];   // New digit of each digit. label[0] is 0.
+};
+
+// Outcomes of sudoku_cache_get and sudoku_cache_solve.
+#define SUDOKU_CACHE_SOLVED     (0)
+#define SUDOKU_CACHE_UNSOLVABLE (1)
+#define SUDOKU_CACHE_MISS       (2) // Not in the cache.
+#define SUDOKU_CACHE_SKIPPED    (3) // No canonical form, the cache was not used.
+#define SUDOKU_CACHE_BUDGET     (4) // The solve was stopped, nothing was cached.
+
+/**
+    A bounded cache of solutions keyed on canonical forms. When full, the
+    least recently used entry makes way for a new one. All functions lock the
+    cache, so one cache can be shared by any number of threads.
+*/
+typedef struct sudoku_cache sudoku_cache;
+
+/**
+    Finds the canonical form of a puzzle.
+
+    @param {char*} puzzle - The puzzle, SUDOKU_CELLS characters.
+    @param {char*} key - Buffer of SUDOKU_CELLS characters. Set to the canonical form.
+    @param {sudoku_transform*} t - Set to the transform from the puzzle to the key.
+    @return {int} - 0 if successful. Non-zero if the puzzle has an unknown
+                    character or more than SUDOKU_CANON_MAX_TIES ties.
+*/
+int             sudoku_canonical_form(const char* puzzle, char* key, sudoku_transform* t);
+/**
+    Maps a grid in canonical form back to the puzzle a transform was found
+    for, eg the solution of the key to a solution of the puzzle.
+
+    @param {sudoku_transform*} t - The transform of the puzzle.
+    @param {char*} canonical - The grid in canonical form, SUDOKU_CELLS characters.
+    @param {char*} out - Buffer of SUDOKU_CELLS characters. Set to the grid.
+*/
+void            sudoku_transform_back(const sudoku_transform* t, const char* canonical, char* out);
+/**
+    Applies a transform to a puzzle, the inverse of sudoku_transform_back.
+
+    @param {sudoku_transform*} t - The transform.
+    @param {char*} puzzle - The puzzle, SUDOKU_CELLS characters.
+    @param {char*} out - Buffer of SUDOKU_CELLS characters. Set to the
+                         transformed puzzle, '0' for empty cells.
+*/
+void            sudoku_transform_apply(const sudoku_transform* t, const char* puzzle, char* out);
+/**
+    Picks a transform at random: a random relabelling, random row and column
+    orders that keep the bands and stacks, and transposition half the time.
+
+    @param {sudoku_transform*} t - Set to the transform.
+    @param {uint64_t} seed - The same seed gives the same transform.
+*/
+void            sudoku_transform_random(sudoku_transform* t, uint64_t seed);
+/**
+    Allocates an empty cache.
+    @param {int} capacity - Most entries kept, at least 1.
+    @return {sudoku_cache*} - The cache. NULL if out of memory or capacity < 1.
+*/
+sudoku_cache*   init_sudoku_cache(int capacity);
+/**
+    Frees a cache.
+    @param {sudoku_cache*} cache - The cache. May be NULL.
+*/
+void            free_sudoku_cache(sudoku_cache* cache);
+/**
+    Looks up a key and marks it as recently used.
+
+    @param {sudoku_cache*} cache - The cache.
+    @param {char*} key - A canonical form.
+    @param {char*} solution - Buffer of SUDOKU_CELLS characters. Set to the
+                              solution of the key if it has one.
+    @return {int} - SUDOKU_CACHE_SOLVED, SUDOKU_CACHE_UNSOLVABLE or SUDOKU_CACHE_MISS.
+*/
+int             sudoku_cache_get(sudoku_cache* cache, const char* key, char* solution);
+/**
+    Adds the outcome of a key, evicting the least recently used entry if full.
+
+    @param {sudoku_cache*} cache - The cache.
+    @param {char*} key - A canonical form.
+    @param {char*} solution - The solution of the key. NULL if unsolvable.
+*/
+void            sudoku_cache_put(sudoku_cache* cache, const char* key, const char* solution);
+/**
+    Solves a puzzle through the cache. On a miss the canonical form is solved
+    with the engine and its outcome cached. Puzzles with more than one
+    solution get the one found for their class, which need not be the one the
+    engine finds for the puzzle itself.
+
+    @param {sudoku_cache*} cache - The cache.
+    @param {sudoku_field*} f - Scratch field for solving on a miss.
+    @param {su_engine_t} engine - The engine to solve with.
+    @param {sudoku_solve_ctl*} ctl - Search control of the solve on a miss. May be NULL.
+    @param {char*} puzzle - The puzzle, SUDOKU_CELLS characters.
+    @param {char*} solution - Buffer of SUDOKU_CELLS characters. Set to the
+                              solution if solved.
+    @return {int} - SUDOKU_CACHE_SOLVED or SUDOKU_CACHE_UNSOLVABLE.
+                    SUDOKU_CACHE_BUDGET if the solve was stopped by ctl.
+                    SUDOKU_CACHE_SKIPPED if the puzzle has no canonical form,
+                    in which case nothing is solved.
+*/
+int             sudoku_cache_solve(sudoku_cache* cache, sudoku_field* f, su_engine_t engine,
+                                    sudoku_solve_ctl* ctl, const char* puzzle, char* solution);
+/**
+    Prints the hit counters of a cache.
+    @param {FILE*} out - Stream to print to.
+    @param {sudoku_cache*} cache - The cache.
+*/
+void            print_sudoku_cache_stats(FILE* out, sudoku_cache* cache);
+
+#endif // SUDOKU_CACHE_H_INCLUDED
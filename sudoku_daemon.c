@@ -0,0 +1,643 @@
+// Sudoku solving daemon
+#define _POSIX_C_SOURCE 200809L // sigset_t, pthread_sigmask
+#include <stdio.h>      // For standard IO
+#include <stdlib.h>     // For standard stuff
+#include <string.h>     // memchr, memcpy
+#include <stdint.h>     // uint64_t
+#include <errno.h>      // EAGAIN, EINTR
+#include <signal.h>     // Stopping on SIGINT and SIGTERM
+#include <pthread.h>    // Solver threads
+#include <unistd.h>     // read, close, unlink
+#include <fcntl.h>      // O_NONBLOCK
+#include <sys/socket.h> // socket, accept, send
+#include <sys/un.h>     // sockaddr_un
+#include <sys/epoll.h>  // The event loop
+#include <sys/eventfd.h>    // Waking the loop from the solver threads
+#include <sys/signalfd.h>   // Signals as events of the loop
+
+#include "sudoku_general_tools.h"
+#include "sudoku_kernel.h"
+#include "sudoku_lib.h"
+#include "sudoku_daemon.h"
+
+/**
+    A daemon serving solve requests over a Unix domain socket. One thread
+    runs the epoll loop, reading requests and writing replies for every
+    client, and a pool of solver threads solves the batches it hands out.
+*/
+
+// Most requests in a batch.
+#define DAEMON_BATCH        (64)
+// Longest request line, without line break.
+#define DAEMON_MAX_LINE     (SUDOKU_DAEMON_MAX_ID + 1 + SUDOKU_MAX_SIZE * SUDOKU_MAX_SIZE + 1)
+// Events handled per epoll_wait.
+#define DAEMON_EVENTS       (64)
+// Bytes read from a client at a time.
+#define DAEMON_READ_SIZE    (1 << 16)
+// Batches handed to the solver threads and not yet answered, per thread.
+// While this many are in flight no client is read from.
+#define DAEMON_IN_FLIGHT_PER_THREAD (4)
+// Bytes of unsent replies after which a client is not read from until it
+// reads its replies.
+#define DAEMON_MAX_OUT      (1 << 20)
+
+/**
+    A request, and its solution once solved.
+*/
+typedef struct daemon_job daemon_job;
+struct daemon_job {
+    unsigned long client;   // Serial of the client that sent it.
+    int fd;                 // Socket of the client.
+    char id[SUDOKU_DAEMON_MAX_ID + 1];
+    char puzzle[SUDOKU_MAX_SIZE * SUDOKU_MAX_SIZE];
+    char solution[SUDOKU_MAX_SIZE * SUDOKU_MAX_SIZE];
+};
+/**
+    Requests solved together by one solver thread.
+*/
+typedef struct daemon_batch daemon_batch;
+struct daemon_batch {
+    daemon_batch* next;
+    int n;
+    daemon_job jobs[DAEMON_BATCH];
+    su_status_t status[DAEMON_BATCH];
+};
+/**
+    A connected client. Only used by the loop thread.
+*/
+typedef struct daemon_client daemon_client;
+struct daemon_client {
+    int fd;
+    unsigned long serial;   // Tells a client from a later one on the same fd.
+    char line[DAEMON_MAX_LINE]; // The request line read so far.
+    size_t line_len;
+    int discard;            // The line is too long and is skipped to its end.
+    char* out;              // Replies not written yet, from out_pos.
+    size_t out_len;
+    size_t out_pos;
+    size_t out_cap;
+    long pending;           // Requests handed to the solver threads.
+    int eof;                // The client will send no more requests.
+    int events;             // The epoll events the client is registered for.
+};
+/**
+    The state of a daemon run.
+*/
+typedef struct daemon_state daemon_state;
+struct daemon_state {
+    const sudoku_daemon_opts* opts;
+    sudoku_daemon_stats* stats;
+    int size;
+    int cells;
+    int epoll_fd;
+    int listen_fd;
+    int wake_fd;            // eventfd written by the solver threads.
+    int signal_fd;
+
+    daemon_client** clients;    // Indexed by fd.
+    int n_clients;              // Length of clients.
+    unsigned long next_serial;
+    daemon_batch* filling;      // Batch the loop adds requests to.
+    daemon_batch* spare;        // Batches to reuse. Loop thread only.
+    int in_flight;              // Batches submitted and not yet collected.
+    int max_in_flight;
+    int throttled;              // Clients stopped being read from, as
+                                // in_flight reached max_in_flight.
+
+    pthread_t* threads;
+    pthread_mutex_t lock;       // Protects todo, done and quit.
+    pthread_cond_t work;
+    daemon_batch* todo;         // Batches to solve, oldest first.
+    daemon_batch* todo_last;
+    daemon_batch* done;         // Solved batches.
+    int quit;
+};
+
+/**
+    Solver thread. Solves batches until the daemon stops.
+*/
+static void* daemon_worker_main(void* arg){
+    daemon_state* d = arg;
+    daemon_batch* b;
+    uint64_t one = 1;
+    su_status_t ret;
+    sudoku_solve_ctl ctl_buf;
+    sudoku_solve_ctl* ctl = NULL; // NULL without budgets, which keeps the checks out of the search.
+    int i;
+
+    // Builds the thread's matrix before the first request needs it.
+    if(d->size == SUDOKU_SIZE && d->opts->engine == SUDOKU_ENGINE_DLX)
+        sudoku_thread_dlx();
+    if(d->opts->max_nodes > 0 || d->opts->max_seconds > 0){
+        ctl = &ctl_buf;
+        init_sudoku_solve_ctl(ctl);
+        ctl->max_nodes = d->opts->max_nodes;
+        ctl->max_seconds = d->opts->max_seconds;
+    }
+    while(1){
+        pthread_mutex_lock(&d->lock);
+        while(d->todo == NULL && !d->quit)
+            pthread_cond_wait(&d->work, &d->lock);
+        if(d->todo == NULL){
+            pthread_mutex_unlock(&d->lock);
+            return NULL;
+        }
+        b = d->todo;
+        d->todo = b->next;
+        pthread_mutex_unlock(&d->lock);
+
+        // The jobs are solved in place, the strides skip the rest of each job.
+        ret = sudoku_lib_solve_batch_ctl(d->size, d->opts->engine, b->jobs[0].puzzle, sizeof(daemon_job),
+                                b->n, b->jobs[0].solution, sizeof(daemon_job), b->status, ctl);
+        for(i = 0; ret != SUDOKU_OK && i < b->n; i++){
+            b->status[i] = ret;
+            memset(b->jobs[i].solution, '0', d->cells);
+        }
+        for(i = 0; d->opts->retry_engine >= 0 && i < b->n; i++)
+            if(b->status[i] == SUDOKU_E_BUDGET)
+                b->status[i] = sudoku_lib_solve(d->size, d->opts->retry_engine, b->jobs[i].puzzle,
+                                                                b->jobs[i].solution);
+
+        pthread_mutex_lock(&d->lock);
+        b->next = d->done;
+        d->done = b;
+        pthread_mutex_unlock(&d->lock);
+        if(write(d->wake_fd, &one, sizeof(one)) != sizeof(one) && errno != EAGAIN){
+            fprintf(stderr, "Could not wake the daemon loop, %d", __LINE__);
+            exit(1);
+        }
+    }
+}
+/**
+    Hands the batch being filled to the solver threads.
+*/
+static void daemon_submit(daemon_state* d){
+    daemon_batch* b = d->filling;
+
+    if(b == NULL || b->n == 0)
+        return;
+    d->filling = NULL;
+    d->stats->batches++;
+    if(++d->in_flight >= d->max_in_flight)
+        d->throttled = 1;
+    b->next = NULL;
+    pthread_mutex_lock(&d->lock);
+    if(d->todo == NULL)
+        d->todo = b;
+    else
+        d->todo_last->next = b;
+    d->todo_last = b;
+    pthread_cond_signal(&d->work);
+    pthread_mutex_unlock(&d->lock);
+}
+/**
+    Gets an empty batch to fill, reusing a solved one if there is any.
+*/
+static daemon_batch* daemon_batch_get(daemon_state* d){
+    daemon_batch* b = d->spare;
+
+    if(b != NULL){
+        d->spare = b->next;
+    }else if((b = malloc(sizeof(daemon_batch))) == NULL){
+        fprintf(stderr, "Could not allocate memory for a batch, %d", __LINE__);
+        exit(1);
+    }
+    b->n = 0;
+    return b;
+}
+
+// Clients
+
+/**
+    Changes the epoll events a client is registered for.
+*/
+static void daemon_watch(daemon_state* d, daemon_client* c, int events){
+    struct epoll_event ev;
+
+    if(c->events == events)
+        return;
+    ev.events = events;
+    ev.data.fd = c->fd;
+    epoll_ctl(d->epoll_fd, EPOLL_CTL_MOD, c->fd, &ev);
+    c->events = events;
+}
+/**
+    Gets the epoll events a client should be registered for. Reading stops
+    while too many batches are in flight or the client doesn't read its
+    replies, so memory stays bounded however fast requests come in.
+*/
+static int daemon_events(daemon_state* d, daemon_client* c){
+    int events = c->out_len ? EPOLLOUT : 0;
+
+    if(!c->eof && d->in_flight < d->max_in_flight && c->out_len - c->out_pos < DAEMON_MAX_OUT)
+        events |= EPOLLIN;
+    return events;
+}
+/**
+    Disconnects a client. Replies to requests still being solved are dropped.
+*/
+static void daemon_close_client(daemon_state* d, daemon_client* c){
+    epoll_ctl(d->epoll_fd, EPOLL_CTL_DEL, c->fd, NULL);
+    close(c->fd);
+    d->clients[c->fd] = NULL;
+    free(c->out);
+    free(c);
+}
+/**
+    Closes a client that sent everything and got every reply.
+    @return {int} - 1 if the client was closed. 0 otherwise.
+*/
+static int daemon_maybe_close(daemon_state* d, daemon_client* c){
+    if(c->eof && c->pending == 0 && c->out_pos == c->out_len){
+        daemon_close_client(d, c);
+        return 1;
+    }
+    return 0;
+}
+/**
+    Writes as many pending replies as the socket takes, and watches for the
+    socket to become writable if some are left.
+    @return {int} - 0 if the client is still connected. Non-zero if it was closed.
+*/
+static int daemon_flush(daemon_state* d, daemon_client* c){
+    ssize_t n;
+
+    while(c->out_pos < c->out_len){
+        n = send(c->fd, c->out + c->out_pos, c->out_len - c->out_pos, MSG_NOSIGNAL);
+        if(n < 0 && errno == EINTR)
+            continue;
+        if(n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+            break;
+        if(n < 0){
+            daemon_close_client(d, c); // Gone without reading its replies.
+            return 1;
+        }
+        c->out_pos += n;
+    }
+    if(c->out_pos == c->out_len)
+        c->out_pos = c->out_len = 0;
+    daemon_watch(d, c, daemon_events(d, c));
+    return daemon_maybe_close(d, c);
+}
+/**
+    Adds a reply line to the replies of a client.
+*/
+static void daemon_reply(daemon_state* d, daemon_client* c, const char* id, int id_len,
+                                        su_status_t status, const char* solution){
+    size_t need = id_len + 16 + d->cells;
+
+    if(c->out_len + need > c->out_cap){
+        c->out_cap = (c->out_len + need) * 2;
+        if((c->out = realloc(c->out, c->out_cap)) == NULL){
+            fprintf(stderr, "Could not allocate memory for the replies, %d", __LINE__);
+            exit(1);
+        }
+    }
+    c->out_len += sprintf(c->out + c->out_len, "%.*s %d ", id_len, id, (int) status);
+    if(solution != NULL)
+        memcpy(c->out + c->out_len, solution, d->cells);
+    else
+        memset(c->out + c->out_len, '0', d->cells);
+    c->out_len += d->cells;
+    c->out[c->out_len++] = '\n';
+    d->stats->requests++;
+}
+/**
+    Handles a request line, without line break. Good requests are added to the
+    batch being filled, bad ones are answered at once.
+*/
+static void daemon_request(daemon_state* d, daemon_client* c, const char* line, size_t len){
+    const char* space;
+    size_t id_len;
+    daemon_job* job;
+
+    if(len > 0 && line[len - 1] == '\r')
+        len--;
+    if(len == 0)
+        return;
+    space = memchr(line, ' ', len);
+    id_len = space != NULL ? (size_t) (space - line) : 0;
+    if(id_len == 0 || id_len > SUDOKU_DAEMON_MAX_ID){
+        daemon_reply(d, c, "-", 1, SUDOKU_E_BAD_ARG, NULL);
+        return;
+    }
+    if(len - id_len - 1 != (size_t) d->cells){
+        daemon_reply(d, c, line, id_len, SUDOKU_E_BAD_ARG, NULL);
+        return;
+    }
+    if(d->filling == NULL)
+        d->filling = daemon_batch_get(d);
+    job = d->filling->jobs + d->filling->n++;
+    job->client = c->serial;
+    job->fd = c->fd;
+    memcpy(job->id, line, id_len);
+    job->id[id_len] = '\0';
+    memcpy(job->puzzle, space + 1, d->cells);
+    c->pending++;
+    if(d->filling->n == DAEMON_BATCH)
+        daemon_submit(d);
+}
+/**
+    Reads what a client sent and handles every complete request line.
+    @return {int} - 0 if the client is still connected. Non-zero if it was closed.
+*/
+static int daemon_read(daemon_state* d, daemon_client* c){
+    char buf[DAEMON_READ_SIZE];
+    const char* p;
+    const char* end;
+    const char* nl;
+    ssize_t n;
+    size_t len;
+
+    // Readable while over a limit, before its events were changed.
+    if(!(daemon_events(d, c) & EPOLLIN)){
+        daemon_watch(d, c, daemon_events(d, c));
+        return 0;
+    }
+    n = read(c->fd, buf, sizeof(buf));
+    if(n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR))
+        return 0;
+    if(n < 0){
+        daemon_close_client(d, c);
+        return 1;
+    }
+    if(n == 0){ // Every request is in, the replies may not be out yet.
+        c->eof = 1;
+        if(c->line_len > 0 && !c->discard)
+            daemon_request(d, c, c->line, c->line_len);
+        c->line_len = 0;
+        return daemon_flush(d, c);
+    }
+    for(p = buf, end = buf + n; p < end; p = nl + 1){
+        nl = memchr(p, '\n', end - p);
+        len = (nl != NULL ? nl : end) - p;
+        if(!c->discard && c->line_len + len > DAEMON_MAX_LINE){
+            c->discard = 1;
+            daemon_reply(d, c, "-", 1, SUDOKU_E_BAD_ARG, NULL);
+        }
+        if(!c->discard){
+            if(c->line_len == 0 && nl != NULL){
+                daemon_request(d, c, p, len); // The whole line is in buf.
+            }else{
+                memcpy(c->line + c->line_len, p, len);
+                c->line_len += len;
+                if(nl != NULL){
+                    daemon_request(d, c, c->line, c->line_len);
+                    c->line_len = 0;
+                }
+            }
+        }
+        if(nl == NULL)
+            break;
+        c->discard = 0;
+        c->line_len = 0;
+    }
+    return daemon_flush(d, c);
+}
+/**
+    Accepts every waiting connection.
+*/
+static void daemon_accept(daemon_state* d){
+    struct epoll_event ev;
+    daemon_client* c;
+    int fd, n;
+
+    while((fd = accept(d->listen_fd, NULL, NULL)) >= 0){
+        fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+        if(fd >= d->n_clients){
+            n = fd * 2 + 16;
+            d->clients = realloc(d->clients, n * sizeof(daemon_client*));
+            if(d->clients == NULL){
+                fprintf(stderr, "Could not allocate memory for the clients, %d", __LINE__);
+                exit(1);
+            }
+            memset(d->clients + d->n_clients, 0, (n - d->n_clients) * sizeof(daemon_client*));
+            d->n_clients = n;
+        }
+        if((c = calloc(1, sizeof(daemon_client))) == NULL){
+            fprintf(stderr, "Could not allocate memory for a client, %d", __LINE__);
+            exit(1);
+        }
+        c->fd = fd;
+        c->serial = d->next_serial++;
+        c->events = EPOLLIN;
+        ev.events = EPOLLIN;
+        ev.data.fd = fd;
+        epoll_ctl(d->epoll_fd, EPOLL_CTL_ADD, fd, &ev);
+        d->clients[fd] = c;
+        d->stats->clients++;
+    }
+}
+/**
+    Sends the replies of every solved batch to the clients still connected.
+*/
+static void daemon_collect(daemon_state* d){
+    daemon_batch* b;
+    daemon_batch* next;
+    daemon_job* job;
+    daemon_client* c;
+    uint64_t count;
+    int i;
+
+    if(read(d->wake_fd, &count, sizeof(count)) != sizeof(count))
+        return;
+    pthread_mutex_lock(&d->lock);
+    b = d->done;
+    d->done = NULL;
+    pthread_mutex_unlock(&d->lock);
+
+    for(; b != NULL; b = next){
+        next = b->next;
+        for(i = 0; i < b->n; i++){
+            job = b->jobs + i;
+            c = d->clients[job->fd];
+            if(c == NULL || c->serial != job->client)
+                continue; // Disconnected.
+            daemon_reply(d, c, job->id, strlen(job->id), b->status[i], b->status[i] == SUDOKU_OK ? job->solution : NULL);
+            c->pending--;
+        }
+        // Written once per client, rather than once per reply.
+        for(i = 0; i < b->n; i++){
+            job = b->jobs + i;
+            c = d->clients[job->fd];
+            if(c != NULL && c->serial == job->client && c->out_len > c->out_pos)
+                daemon_flush(d, c);
+            else if(c != NULL && c->serial == job->client)
+                daemon_maybe_close(d, c);
+        }
+        b->next = d->spare;
+        d->spare = b;
+        d->in_flight--;
+    }
+    // Room for more batches, so every client is read from again.
+    if(d->throttled && d->in_flight < d->max_in_flight){
+        d->throttled = 0;
+        for(i = 0; i < d->n_clients; i++)
+            if((c = d->clients[i]) != NULL)
+                daemon_watch(d, c, daemon_events(d, c));
+    }
+}
+
+// Setup
+
+/**
+    Creates the listening socket, replacing any file at its path.
+    @return {int} - The socket. -1 on errors, which are printed.
+*/
+static int daemon_listen(const char* path){
+    struct sockaddr_un addr;
+    int fd;
+
+    if(strlen(path) >= sizeof(addr.sun_path)){
+        fprintf(stderr, "Socket path %s is too long.\n", path);
+        return -1;
+    }
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    strcpy(addr.sun_path, path);
+    unlink(path);
+    if((fd = socket(AF_UNIX, SOCK_STREAM, 0)) < 0
+            || bind(fd, (struct sockaddr*) &addr, sizeof(addr)) || listen(fd, SOMAXCONN)){
+        perror(path);
+        if(fd >= 0)
+            close(fd);
+        return -1;
+    }
+    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+    return fd;
+}
+/**
+    Adds a descriptor to the epoll set, for reading.
+*/
+static void daemon_add(daemon_state* d, int fd){
+    struct epoll_event ev;
+    ev.events = EPOLLIN;
+    ev.data.fd = fd;
+    epoll_ctl(d->epoll_fd, EPOLL_CTL_ADD, fd, &ev);
+}
+/**
+    Runs the daemon until it gets SIGINT or SIGTERM. The socket is removed
+    again when it stops.
+
+    @param {sudoku_daemon_opts*} opts - Options of the daemon.
+    @param {sudoku_daemon_stats*} stats - Filled in with the counters of the run.
+    @return {int} - 0 if stopped by a signal. Non-zero if the socket could not
+                    be set up.
+*/
+int sudoku_daemon_run(const sudoku_daemon_opts* opts, sudoku_daemon_stats* stats){
+    daemon_state d;
+    daemon_batch* b;
+    struct epoll_event events[DAEMON_EVENTS];
+    sigset_t stop_signals, old_mask;
+    int i, n, fd, t;
+    int running = 1;
+
+    memset(stats, 0, sizeof(*stats));
+    memset(&d, 0, sizeof(d));
+    d.opts = opts;
+    d.stats = stats;
+    d.size = opts->size ? opts->size : SUDOKU_SIZE;
+    d.cells = d.size * d.size;
+    d.max_in_flight = opts->threads * DAEMON_IN_FLIGHT_PER_THREAD;
+    if((d.listen_fd = daemon_listen(opts->path)) < 0)
+        return 1;
+
+    // Blocked before the threads start, so only the signalfd sees them.
+    sigemptyset(&stop_signals);
+    sigaddset(&stop_signals, SIGINT);
+    sigaddset(&stop_signals, SIGTERM);
+    pthread_sigmask(SIG_BLOCK, &stop_signals, &old_mask);
+    d.signal_fd = signalfd(-1, &stop_signals, 0);
+    d.wake_fd = eventfd(0, EFD_NONBLOCK);
+    d.epoll_fd = epoll_create1(0);
+    if(d.signal_fd < 0 || d.wake_fd < 0 || d.epoll_fd < 0){
+        fprintf(stderr, "Could not set up the daemon loop, %d", __LINE__);
+        exit(1);
+    }
+    daemon_add(&d, d.listen_fd);
+    daemon_add(&d, d.wake_fd);
+    daemon_add(&d, d.signal_fd);
+
+    pthread_mutex_init(&d.lock, NULL);
+    pthread_cond_init(&d.work, NULL);
+    if((d.threads = malloc(opts->threads * sizeof(pthread_t))) == NULL){
+        fprintf(stderr, "Could not allocate memory for the solver threads, %d", __LINE__);
+        exit(1);
+    }
+    for(t = 0; t < opts->threads; t++){
+        if(pthread_create(d.threads + t, NULL, daemon_worker_main, &d)){
+            fprintf(stderr, "Could not start solver thread, %d", __LINE__);
+            exit(1);
+        }
+    }
+
+    while(running){
+        n = epoll_wait(d.epoll_fd, events, DAEMON_EVENTS, -1);
+        if(n < 0 && errno == EINTR)
+            continue;
+        if(n < 0){
+            perror("epoll_wait");
+            break;
+        }
+        for(i = 0; i < n; i++){
+            fd = events[i].data.fd;
+            if(fd == d.listen_fd){
+                daemon_accept(&d);
+            }else if(fd == d.wake_fd){
+                daemon_collect(&d);
+            }else if(fd == d.signal_fd){
+                running = 0;
+            }else if(d.clients[fd] != NULL){
+                if(events[i].events & (EPOLLERR | EPOLLHUP) && !(events[i].events & EPOLLIN))
+                    daemon_close_client(&d, d.clients[fd]);
+                else if(events[i].events & EPOLLIN)
+                    daemon_read(&d, d.clients[fd]);
+                else if(events[i].events & EPOLLOUT)
+                    daemon_flush(&d, d.clients[fd]);
+            }
+        }
+        // Requests that came in together are solved together.
+        daemon_submit(&d);
+    }
+
+    pthread_mutex_lock(&d.lock);
+    d.quit = 1;
+    pthread_cond_broadcast(&d.work);
+    pthread_mutex_unlock(&d.lock);
+    for(t = 0; t < opts->threads; t++)
+        pthread_join(d.threads[t], NULL);
+    for(fd = 0; fd < d.n_clients; fd++){
+        if(d.clients[fd] != NULL)
+            daemon_close_client(&d, d.clients[fd]);
+    }
+    // Every batch is solved by now, and in done or spare.
+    while((b = d.done) != NULL){
+        d.done = b->next;
+        free(b);
+    }
+    while((b = d.spare) != NULL){
+        d.spare = b->next;
+        free(b);
+    }
+    free(d.filling);
+    free(d.clients);
+    free(d.threads);
+    pthread_cond_destroy(&d.work);
+    pthread_mutex_destroy(&d.lock);
+    close(d.epoll_fd);
+    close(d.wake_fd);
+    close(d.signal_fd);
+    close(d.listen_fd);
+    unlink(opts->path);
+    pthread_sigmask(SIG_SETMASK, &old_mask, NULL);
+    return 0;
+}
+/**
+    Prints the counters of a daemon run.
+
+    @param {FILE*} out - Stream to print to.
+    @param {sudoku_daemon_stats*} stats - The counters of the run.
+*/
+void print_sudoku_daemon_stats(FILE* out, const sudoku_daemon_stats* stats){
+    fprintf(out, "Clients: %ld Requests: %ld Batches: %ld\n", stats->clients, stats->requests, stats->batches);
+}
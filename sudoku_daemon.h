@@ -0,0 +1,80 @@
+#ifndef SUDOKU_DAEMON_H_INCLUDED
+#define SUDOKU_DAEMON_H_INCLUDED
+
+#include <stdio.h>      // FILE
+
+#include "sudoku_general_tools.h"
+
+/**
+    The solving daemon. It listens on a Unix domain socket and serves any
+    number of clients at once from one epoll loop. Puzzles that arrive
+    together are grouped into batches for a fixed pool of solver threads, so
+    the number of threads is the only limit on concurrent solving. Every
+    solver thread keeps its scratch field and engine state between batches.
+
+    The protocol is line based. A request is a line
+
+        <id> <puzzle>
+
+    where id is any text of at most SUDOKU_DAEMON_MAX_ID characters without
+    white space, and the puzzle is in the format of sudoku_lib.h. Every
+    request gets exactly one reply line
+
+        <id> <status> <solution>
+
+    where status is the su_status_t as a number (0 when solved) and the
+    solution is '0' in every cell unless solved. Puzzles that run over the
+    search budget of the daemon get SUDOKU_E_BUDGET, so a client can tell
+    them from puzzles without a solution. Replies come as soon as
+    their puzzle is solved, so they need not be in request order. Lines that
+    are not a request are answered with SUDOKU_E_BAD_ARG, using id "-" if
+    the line has no id.
+*/
+
+// Longest request id.
+#define SUDOKU_DAEMON_MAX_ID (64)
+
+/**
+    Options of the daemon.
+*/
+typedef struct sudoku_daemon_opts sudoku_daemon_opts;
+struct sudoku_daemon_opts {
+    const char* path;   // Path of the socket. Replaced if it exists.
+    su_engine_t engine; // Engine for SUDOKU_SIZE puzzles.
+    int size;           // 0 for SUDOKU_SIZE puzzles, or a sized kernel size.
+    int threads;        // Solver threads.
+    long long max_nodes;// Search nodes allowed per puzzle. 0 for no limit.
+    double max_seconds; // Seconds allowed per puzzle. 0 for no limit.
+    int retry_engine;   // Engine that solves puzzles over budget again,
+                        // without budget. -1 replies SUDOKU_E_BUDGET instead.
+};
+
+/**
+    Counters of a daemon run.
+*/
+typedef struct sudoku_daemon_stats sudoku_daemon_stats;
+struct sudoku_daemon_stats {
+    long clients;       // Connections accepted.
+    long requests;      // Reply lines sent, including bad requests.
+    long batches;       // Batches handed to the solver threads.
+};
+
+/**
+    Runs the daemon until it gets SIGINT or SIGTERM. The socket is removed
+    again when it stops.
+
+    @param {sudoku_daemon_opts*} opts - Options of the daemon.
+    @param {sudoku_daemon_stats*} stats - Filled in with the counters of the run.
+    @return {int} - 0 if stopped by a signal. Non-zero if the socket could not
+                    be set up.
+*/
+int sudoku_daemon_run(const sudoku_daemon_opts* opts, sudoku_daemon_stats* stats);
+/**
+    Prints the counters of a daemon run.
+
+    @param {FILE*} out - Stream to print to.
+    @param {sudoku_daemon_stats*} stats - The counters of the run.
+*/
+void print_sudoku_daemon_stats(FILE* out, const sudoku_daemon_stats* stats);
+
+#endif // SUDOKU_DAEMON_H_INCLUDED
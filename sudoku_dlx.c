@@ -0,0 +1,237 @@
+// Sudoku solver using Dancing Links
+#include <stdio.h>      // For standard IO
+#include <stdlib.h>     // For standard stuff
+#include <pthread.h>    // One matrix per thread
+
+#include "sudoku_general_tools.h"
+
+/**
+    Knuth's Algorithm X on a dancing-links matrix. Sudoku is an exact cover
+    problem with one matrix row per (cell, value) and four columns per row:
+    the cell is filled, and the value is in the row, the column and the box.
+
+    The matrix is the same for every puzzle, so it is built once per
+    sudoku_dlx. A puzzle covers the rows of its clues, the search runs, and
+    everything is uncovered again in reverse order, leaving the matrix ready
+    for the next puzzle. Nothing is allocated during a solve.
+
+    Node 0 is the root, nodes 1 to DLX_COLUMNS the column headers, and every
+    matrix row is four consecutive nodes after those.
+*/
+
+#define DLX_COLUMNS (4 * SUDOKU_CELLS)
+#define DLX_ROWS    (SUDOKU_CELLS * SUDOKU_SIZE)
+#define DLX_NODES   (1 + DLX_COLUMNS + 4 * DLX_ROWS)
+#define DLX_ROOT    (0)
+
+struct sudoku_dlx {
+    int left[DLX_NODES];
+    int right[DLX_NODES];
+    int up[DLX_NODES];
+    int down[DLX_NODES];
+    int column[DLX_NODES];
+    int size[DLX_COLUMNS + 1];  // Nodes left in each column.
+    int chosen[SUDOKU_CELLS];   // First node of the row chosen at each depth.
+};
+
+static int dlx_row_of(int node){
+    return (node - DLX_COLUMNS - 1) / 4;
+}
+static int dlx_first_node(int row){
+    return DLX_COLUMNS + 1 + 4 * row;
+}
+static void dlx_cover(sudoku_dlx* x, int c){
+    int i, j;
+    x->left[x->right[c]] = x->left[c];
+    x->right[x->left[c]] = x->right[c];
+    for(i = x->down[c]; i != c; i = x->down[i]){
+        for(j = x->right[i]; j != i; j = x->right[j]){
+            x->up[x->down[j]] = x->up[j];
+            x->down[x->up[j]] = x->down[j];
+            x->size[x->column[j]]--;
+        }
+    }
+}
+static void dlx_uncover(sudoku_dlx* x, int c){
+    int i, j;
+    for(i = x->up[c]; i != c; i = x->up[i]){
+        for(j = x->left[i]; j != i; j = x->left[j]){
+            x->size[x->column[j]]++;
+            x->up[x->down[j]] = j;
+            x->down[x->up[j]] = j;
+        }
+    }
+    x->left[x->right[c]] = c;
+    x->right[x->left[c]] = c;
+}
+/**
+    Covers the columns of every node in the row of node n, starting with n.
+*/
+static void dlx_select(sudoku_dlx* x, int n){
+    int j;
+    dlx_cover(x, x->column[n]);
+    for(j = x->right[n]; j != n; j = x->right[j])
+        dlx_cover(x, x->column[j]);
+}
+static void dlx_unselect(sudoku_dlx* x, int n){
+    int j;
+    for(j = x->left[n]; j != n; j = x->left[j])
+        dlx_uncover(x, x->column[j]);
+    dlx_uncover(x, x->column[n]);
+}
+/**
+    Builds the full matrix, with no rows selected.
+*/
+static void dlx_build(sudoku_dlx* x){
+    int c, row, k, n, rc, v, col;
+    int cols[4];
+
+    for(c = 0; c <= DLX_COLUMNS; c++){
+        x->left[c] = c == 0 ? DLX_COLUMNS : c - 1;
+        x->right[c] = c == DLX_COLUMNS ? 0 : c + 1;
+        x->up[c] = x->down[c] = c;
+        x->column[c] = c;
+        x->size[c] = 0;
+    }
+    for(row = 0; row < DLX_ROWS; row++){
+        rc = row / SUDOKU_SIZE;
+        v = row % SUDOKU_SIZE;
+        cols[0] = 1 + rc;
+        cols[1] = 1 + SUDOKU_CELLS     + rc_to_r(rc) * SUDOKU_SIZE + v;
+        cols[2] = 1 + 2 * SUDOKU_CELLS + rc_to_c(rc) * SUDOKU_SIZE + v;
+        cols[3] = 1 + 3 * SUDOKU_CELLS + rc_to_b(rc) * SUDOKU_SIZE + v;
+        for(k = 0; k < 4; k++){
+            n = dlx_first_node(row) + k;
+            col = cols[k];
+            x->left[n] = dlx_first_node(row) + (k + 3) % 4;
+            x->right[n] = dlx_first_node(row) + (k + 1) % 4;
+            x->column[n] = col;
+            x->up[n] = x->up[col];
+            x->down[n] = col;
+            x->down[x->up[col]] = n;
+            x->up[col] = n;
+            x->size[col]++;
+        }
+    }
+}
+/**
+    Algorithm X, always branching on the column with the fewest rows left.
+    On success the chosen rows are written into the field. The matrix is
+    restored before returning, whatever the outcome.
+    @return {int} - 1 if solved. 0 otherwise.
+*/
+static int dlx_search(sudoku_dlx* x, int depth, sudoku_field* f, sudoku_solve_ctl* ctl){
+    int c, best, r, k, row;
+    int ret = 0;
+
+    if(x->right[DLX_ROOT] == DLX_ROOT){ // Every constraint is met.
+        for(k = 0; k < depth; k++){
+            row = dlx_row_of(x->chosen[k]);
+            set_cell_lin(f, row / SUDOKU_SIZE, ONE << (row % SUDOKU_SIZE));
+        }
+        return 1;
+    }
+    if(sudoku_solve_stopped(ctl))
+        return 0;
+    best = x->right[DLX_ROOT];
+    for(c = x->right[best]; c != DLX_ROOT && x->size[best] > 1; c = x->right[c]){
+        if(x->size[c] < x->size[best])
+            best = c;
+    }
+    if(x->size[best] == 0)
+        return 0;
+
+    dlx_cover(x, best);
+    for(r = x->down[best]; r != best && !ret; r = x->down[r]){
+        x->chosen[depth] = r;
+        for(k = x->right[r]; k != r; k = x->right[k])
+            dlx_cover(x, x->column[k]);
+        SUDOKU_STAT_DEPTH(depth + 1);
+        ret = dlx_search(x, depth + 1, f, ctl);
+        for(k = x->left[r]; k != r; k = x->left[k])
+            dlx_uncover(x, x->column[k]);
+        if(!ret)
+            SUDOKU_STAT_ADD(backtracks, 1);
+    }
+    dlx_uncover(x, best);
+    return ret;
+}
+
+/**
+    Allocates and builds a dancing-links matrix.
+
+    @return {sudoku_dlx*} - A pointer to the new matrix.
+*/
+sudoku_dlx*     alloc_sudoku_dlx(void){
+    sudoku_dlx* ret = malloc(sizeof(sudoku_dlx));
+    if(ret == NULL){
+        fprintf(stderr, "Could not allocate memory for the dancing links, %d", __LINE__);
+        exit(1);
+    }
+    dlx_build(ret);
+    return ret;
+}
+/**
+    Frees a dancing-links matrix.
+    @param {sudoku_dlx*} x - The matrix to free.
+*/
+void            free_sudoku_dlx(sudoku_dlx* x){
+    free(x);
+}
+/**
+    Solves the input sudoku in place with Algorithm X on a prebuilt matrix.
+    The field is left unchanged if no solution exists.
+
+    @param {sudoku_dlx*} x - Matrix from alloc_sudoku_dlx. Reusable afterwards.
+    @param {sudoku_field*} f - Input sudoku to solve.
+    @param {sudoku_solve_ctl*} ctl - Search control. May be NULL.
+    @return {sudoku_field*} - The input field (solved) if successful. NULL otherwise.
+*/
+sudoku_field*   sudoku_solve_dlx(sudoku_dlx* x, sudoku_field* f, sudoku_solve_ctl* ctl){
+    int clues[SUDOKU_CELLS]; // First node of the row of every clue.
+    int n_clues = 0;
+    int rc, solved;
+    su_cell_t cell;
+
+    for(rc = 0; rc < SUDOKU_CELLS; rc++){
+        if((cell = get_cell_lin(f, rc))){
+            clues[n_clues] = dlx_first_node(rc * SUDOKU_SIZE + __builtin_ctz(cell));
+            dlx_select(x, clues[n_clues++]);
+        }
+    }
+    solved = dlx_search(x, 0, f, ctl);
+    while(n_clues > 0)
+        dlx_unselect(x, clues[--n_clues]);
+    return solved ? f : NULL;
+}
+
+// Matrix of the calling thread, for the engine.
+static pthread_key_t dlx_key;
+static pthread_once_t dlx_key_once = PTHREAD_ONCE_INIT;
+
+static void dlx_free_key(void* x){
+    free_sudoku_dlx(x);
+}
+static void dlx_create_key(void){
+    pthread_key_create(&dlx_key, dlx_free_key);
+}
+/**
+    Gets the dancing-links matrix of the calling thread, building it on first
+    use. It is freed when the thread exits.
+
+    @return {sudoku_dlx*} - The matrix of the thread. NULL if it could not be
+                            allocated.
+*/
+sudoku_dlx*     sudoku_thread_dlx(void){
+    sudoku_dlx* x;
+    pthread_once(&dlx_key_once, dlx_create_key);
+    x = pthread_getspecific(dlx_key);
+    if(x == NULL){
+        // Not alloc_sudoku_dlx, running out of memory is left to the caller.
+        if((x = malloc(sizeof(sudoku_dlx))) == NULL)
+            return NULL;
+        dlx_build(x);
+        pthread_setspecific(dlx_key, x);
+    }
+    return x;
+}
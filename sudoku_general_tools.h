@@ -1,6 +1,9 @@
 #ifndef SUDOKU_GENERAL_TOOLS_H_INCLUDED
 #define SUDOKU_GENERAL_TOOLS_H_INCLUDED
 
+#include <stdatomic.h>  // atomic_int
+#include <stdio.h>      // FILE
+
 /**
    The Sudoku is assumed to be stored in a bitfield containing the data.
    In a given cell represented by an unsigned number (preliminary a short)
@@ -32,22 +35,130 @@
 // than at pre processing time.
 #define SUDOKU_SIZE (9)
 #define SUDOKU_BOX_WIDTH (3)
+#define SUDOKU_CELLS (SUDOKU_SIZE * SUDOKU_SIZE)
+// Mask with every possible value of a cell set.
+#define SUDOKU_ALL_VALUES ((ONE << SUDOKU_SIZE) - 1)
 
 // FLAGS
+// SUDOKU_STATS - Define to count search statistics, see sudoku_search_stats.
+// Without it the counting is compiled out.
 
 // Checks
 typedef unsigned short su_cell_t; // Type used for storing cell values.
 typedef unsigned int su_rcb_t;  // Type used to store row, column or box values.
 
 /**
+    The available solver engines. Selected through init_sudoku_solve_engine
+    or the --engine program option.
+*/
+typedef enum su_engine_t {
+    SUDOKU_ENGINE_LINEAR = 0,   // sudoku_solve_rec_lin, row-major cell order.
+    SUDOKU_ENGINE_MRV,          // sudoku_solve_rec_mrv, fewest candidates first.
+    SUDOKU_ENGINE_PROP,         // sudoku_solve_rec_prop, singles propagation and MRV.
+    SUDOKU_ENGINE_ITER,         // sudoku_solve_iter_lin, row-major without recursion.
+    SUDOKU_ENGINE_BITBOARD,     // sudoku_solve_bitboard, scalar candidate scan.
+    SUDOKU_ENGINE_SIMD,         // sudoku_solve_bitboard, vectorized candidate scan.
+    SUDOKU_ENGINE_DLX,          // sudoku_solve_dlx, Algorithm X on dancing links.
+    SUDOKU_ENGINE_COUNT         // Number of engines. Not an engine.
+} su_engine_t;
+#define SUDOKU_ENGINE_DEFAULT SUDOKU_ENGINE_PROP
+
+// Return values of find_mrv_cell that are not cell positions.
+#define SUDOKU_NO_EMPTY_CELL (-1)   // Every cell is filled.
+#define SUDOKU_DEAD_CELL     (-2)   // An empty cell has no candidates left.
 
+/**
+    A sudoku and the values placed in each row, column and box. Everything is
+    stored inline, so a field can live on the stack or in an array and is
+    copied with a plain assignment.
 */
 typedef struct sudoku_field sudoku_field;
 struct sudoku_field {
-    su_cell_t* row_contains;    // is used to reference the whole internal  memory arena.
-    su_cell_t* col_contains;
-    su_cell_t* box_contains;
-    su_cell_t* field;
+    su_cell_t row_contains[SUDOKU_SIZE];
+    su_cell_t col_contains[SUDOKU_SIZE];
+    su_cell_t box_contains[SUDOKU_SIZE];
+    su_cell_t field[SUDOKU_CELLS];
+};
+
+// Size of a cache line, the alignment of the fields of a sudoku_field_pool.
+#define SUDOKU_CACHE_LINE (64)
+/**
+    A slab of cache-line aligned fields, see alloc_sudoku_field_pool.
+*/
+typedef struct sudoku_field_pool sudoku_field_pool;
+
+// Outcomes of sudoku_solve_status, and reasons a search was stopped.
+#define SUDOKU_SOLVE_SOLVED     (0)
+#define SUDOKU_SOLVE_UNSOLVABLE (1)
+#define SUDOKU_SOLVE_BUDGET     (2) // The node or time budget ran out first.
+#define SUDOKU_SOLVE_CANCELLED  (3) // The cancel flag was set.
+// Search nodes between looks at the clock when a solve has a time budget.
+#define SUDOKU_CLOCK_NODES      (1024)
+
+/**
+    Controls a running search from the outside. Every engine checks the
+    control once per search node and gives up, leaving the field as it was,
+    when told to stop or when its budget runs out. Set up with
+    init_sudoku_solve_ctl, then set the limits of interest. The budgets hold
+    for every solve the control is passed to, counted from its start.
+*/
+typedef struct sudoku_solve_ctl sudoku_solve_ctl;
+struct sudoku_solve_ctl {
+    atomic_int* cancel; // The search stops once this is non-zero. May be NULL.
+    long long max_nodes;// Search nodes allowed per solve. 0 for no limit.
+    double max_seconds; // Wall-clock seconds allowed per solve. 0 for no limit.
+    double deadline;    // sudoku_clock_seconds time every solve must end by.
+                        // 0 for none.
+    int stopped;        // Set by the engine to SUDOKU_SOLVE_BUDGET or
+                        // SUDOKU_SOLVE_CANCELLED if the search was stopped.
+    long long nodes;    // Search nodes of the last solve.
+    double stop_at;     // The earlier of deadline and the time budget of the
+                        // running solve. Set by the engine.
+};
+
+/**
+    Search counters. When compiled with SUDOKU_STATS every thread counts the
+    work of the engines it runs in its own sudoku_search_stats, which costs a
+    few additions per search node. Without SUDOKU_STATS the counters stay 0.
+*/
+typedef struct sudoku_search_stats sudoku_search_stats;
+struct sudoku_search_stats {
+    long long solves;       // Calls of sudoku_solve_engine_ctl.
+    long long nodes;        // Search nodes visited, see sudoku_solve_stopped.
+    long long backtracks;   // Guesses taken back after their branch failed.
+    long long failed_sets;  // set_cell calls refused by a row, column or box.
+    long long propagations; // Values placed by propagation of singles.
+    int max_depth;          // Most guesses on the stack at once.
+    int depth;              // Guesses on the stack now. Not a result.
+    double seconds;         // Wall-clock time in sudoku_solve_engine_ctl.
+};
+#ifdef SUDOKU_STATS
+extern _Thread_local sudoku_search_stats sudoku_thread_stats;
+#define SUDOKU_STAT_ADD(counter, n) (sudoku_thread_stats.counter += (n))
+// Records the depth of an engine that keeps its own.
+#define SUDOKU_STAT_DEPTH(d) do{ if((d) > sudoku_thread_stats.max_depth) \
+                                    sudoku_thread_stats.max_depth = (d); }while(0)
+// Around the recursive call of a guess, for engines without a depth.
+#define SUDOKU_STAT_DOWN() do{ sudoku_thread_stats.depth++; \
+                               SUDOKU_STAT_DEPTH(sudoku_thread_stats.depth); }while(0)
+#define SUDOKU_STAT_UP() (sudoku_thread_stats.depth--)
+#else
+#define SUDOKU_STAT_ADD(counter, n) ((void) 0)
+#define SUDOKU_STAT_DEPTH(d) ((void) 0)
+#define SUDOKU_STAT_DOWN() ((void) 0)
+#define SUDOKU_STAT_UP() ((void) 0)
+#endif
+
+/**
+    Candidate masks for every cell, kept alongside a sudoku field by the
+    propagating engine. The trail records the cells placed through
+    place_candidate_lin so that they can be unset again on backtrack.
+*/
+typedef struct sudoku_candidates sudoku_candidates;
+struct sudoku_candidates {
+    su_cell_t cell[SUDOKU_CELLS];   // Candidates of each cell. ZERO for filled cells.
+    int trail[SUDOKU_CELLS];        // rc index of the placed cells, oldest first.
+    int trail_len;
 };
 
 /**
@@ -99,6 +210,20 @@ su_cell_t get_cell( const sudoku_field*, su_rcb_t r, su_rcb_t c);
     @return {su_cell_t} - The value of the cell.
 */
 su_cell_t get_cell_lin( const sudoku_field*, int rc);
+/**
+    Gets the values that can still be placed in a given cell, ie the values
+    not present in the row, column or box of the cell.
+    @param {sudokufield} f - The input sudoku field.
+    @param {int} rc - The position of the cell in a linear memory arena.
+    @return {su_cell_t} - Mask of the candidate values.
+*/
+su_cell_t get_candidates_lin( const sudoku_field*, int rc);
+/**
+    Counts the number of values set in a candidate mask.
+    @param {su_cell_t} candidates - The candidate mask.
+    @return {int} - The number of candidates.
+*/
+int count_candidates(su_cell_t);
 
 
 /**
@@ -195,6 +320,35 @@ void unset_cell_lin(sudoku_field* f, int rc, su_cell_t nbr);
     @return {sudoku_field*} - A solved sudoku if successful. NULL otherwise.
 */
 sudoku_field*   init_sudoku_solve( const sudoku_field*);
+/**
+    Initiates and starts solving of a sudoku field using a given engine.
+    Returns a new sudoku field.
+
+    @param {sudoku_field*} f - Input sudoku to solve.
+    @param {su_engine_t} engine - The engine to solve with.
+    @return {sudoku_field*} - A solved sudoku if successful. NULL otherwise.
+*/
+sudoku_field*   init_sudoku_solve_engine( const sudoku_field*, su_engine_t);
+/**
+    Solves the input sudoku in place using a given engine. The field is left
+    unchanged if no solution exists.
+
+    @param {sudoku_field*} f - Input sudoku to solve.
+    @param {su_engine_t} engine - The engine to solve with.
+    @return {sudoku_field*} - The input field (solved) if successful. NULL otherwise.
+*/
+sudoku_field*   sudoku_solve_engine( sudoku_field*, su_engine_t);
+/**
+    Solves the input sudoku in place using a given engine, under the control
+    of a sudoku_solve_ctl. The field is left unchanged if no solution exists
+    or if the search is stopped.
+
+    @param {sudoku_field*} f - Input sudoku to solve.
+    @param {su_engine_t} engine - The engine to solve with.
+    @param {sudoku_solve_ctl*} ctl - Search control. May be NULL.
+    @return {sudoku_field*} - The input field (solved) if successful. NULL otherwise.
+*/
+sudoku_field*   sudoku_solve_engine_ctl( sudoku_field*, su_engine_t, sudoku_solve_ctl*);
 /**
     Tries to solve the input sudoku recursively. Returns the input sudoku field
     (solved) if successful and NULL otherwise. Caution is therefore needed to
@@ -220,34 +374,276 @@ sudoku_field*   sudoku_solve_rec(sudoku_field* f, su_rcb_t next_r, su_rcb_t next
     @return {sudoku_field*} - A solved sudoku if successful. NULL otherwise.
 */
 sudoku_field*   sudoku_solve_rec_lin(sudoku_field* ,int);
+/**
+    Solves the input sudoku without recursion, visiting the cells in the same
+    order and trying the values in the same order as sudoku_solve_rec_lin, so
+    the solutions are the same. The search state is a fixed-size stack of the
+    values placed in the empty cells, which doubles as the trail used to unset
+    them again. Nothing is allocated during the solve.
+
+    @param {sudoku_field*} f - Input sudoku to solve.
+    @return {sudoku_field*} - The input field (solved) if successful. NULL otherwise.
+*/
+sudoku_field*   sudoku_solve_iter_lin(sudoku_field*);
+/**
+    Finds the empty cell with the fewest candidates (minimum remaining values).
+
+    @param {sudoku_field*} f - The input sudoku field.
+    @param {su_cell_t*} candidates - Set to the candidates of the found cell.
+    @return {int} - rc index of the cell, SUDOKU_NO_EMPTY_CELL if the field is
+                    full or SUDOKU_DEAD_CELL if an empty cell has no candidates.
+*/
+int             find_mrv_cell(const sudoku_field*, su_cell_t* candidates);
+/**
+    Tries to solve the input sudoku recursively, always branching on the empty
+    cell with the fewest candidates. A branch is abandoned as soon as any
+    empty cell runs out of candidates. Returns the input sudoku field (solved)
+    if successful and NULL otherwise.
+
+    @param {sudoku_field*} f - Input sudoku to solve.
+    @return {sudoku_field*} - A solved sudoku if successful. NULL otherwise.
+*/
+sudoku_field*   sudoku_solve_rec_mrv(sudoku_field*);
+
+/**
+    Sets up the candidate masks of a sudoku field and clears the trail.
+    @param {sudoku_field*} f - The input sudoku field.
+    @param {sudoku_candidates*} c - The candidates to set up.
+*/
+void            init_sudoku_candidates(const sudoku_field*, sudoku_candidates*);
+/**
+    Places a value in a cell and removes it from the candidates of every cell
+    sharing row, column or box with it. The cell is added to the trail.
+    @param {sudoku_field*} f - The sudoku field.
+    @param {sudoku_candidates*} c - The candidates of the field.
+    @param {int} rc - The position of the cell in a linear memory arena.
+    @param {su_cell_t} nbr - The value to place.
+    @return {int} - 0 if successful. Non-zero otherwise.
+*/
+int             place_candidate_lin(sudoku_field*, sudoku_candidates*, int rc, su_cell_t nbr);
+/**
+    Places naked singles (cells with one candidate) and hidden singles (values
+    with one possible cell in a row, column or box) until nothing changes.
+    @param {sudoku_field*} f - The sudoku field.
+    @param {sudoku_candidates*} c - The candidates of the field.
+    @return {int} - 0 if successful. Non-zero if a contradiction was found.
+*/
+int             propagate_sudoku_candidates(sudoku_field*, sudoku_candidates*);
+/**
+    Unsets every cell placed since the trail had a given length.
+    NOTE! The candidate masks are not restored.
+    @param {sudoku_field*} f - The sudoku field.
+    @param {sudoku_candidates*} c - The candidates of the field.
+    @param {int} mark - The trail length to go back to.
+*/
+void            undo_sudoku_candidates(sudoku_field*, sudoku_candidates*, int mark);
+/**
+    Tries to solve the input sudoku recursively. Singles are propagated before
+    every branch and the search branches on the cell with the fewest
+    candidates. Everything placed is undone on backtrack. Returns the input
+    sudoku field (solved) if successful and NULL otherwise.
+
+    @param {sudoku_field*} f - Input sudoku to solve.
+    @param {sudoku_candidates*} c - Candidates of f, see init_sudoku_candidates.
+    @return {sudoku_field*} - A solved sudoku if successful. NULL otherwise.
+*/
+sudoku_field*   sudoku_solve_rec_prop(sudoku_field*, sudoku_candidates*);
+
+// Outcome of sudoku_count_solutions with a limit of 2.
+#define SUDOKU_COUNT_NONE       (0)
+#define SUDOKU_COUNT_UNIQUE     (1)
+#define SUDOKU_COUNT_MULTIPLE   (2)
+/**
+    Counts the solutions of a sudoku, stopping as soon as limit solutions are
+    found. The search is the one of sudoku_solve_rec_prop, which never loses
+    solutions since propagation only places forced values. With a limit of 2
+    the result is one of the SUDOKU_COUNT_ codes, and a puzzle with several
+    solutions is answered as soon as the second one is found. The field is
+    left unchanged.
+
+    @param {sudoku_field*} f - Input sudoku.
+    @param {int} limit - Largest count of interest, at least 1.
+    @param {sudoku_solve_ctl*} ctl - Search control. May be NULL.
+    @return {int} - Number of solutions found, at most limit. May be less than
+                    the true count if the search was stopped.
+*/
+int             sudoku_count_solutions(sudoku_field*, int limit, sudoku_solve_ctl*);
+
+/**
+    Checks whether a search should stop, and records it in the control if so.
+    Called once per search node, that is every time an engine descends into a
+    search state and never on backtracking, so the node counts of the engines
+    can be compared. The clock is only read every SUDOKU_CLOCK_NODES nodes,
+    so a time budget can be overrun by that many.
+    @param {sudoku_solve_ctl*} ctl - Search control. May be NULL.
+    @return {int} - Non-zero if the search should stop. 0 otherwise.
+*/
+int             sudoku_solve_stopped(sudoku_solve_ctl*);
+/**
+    Sets up a control without cancel flag or budgets.
+    @param {sudoku_solve_ctl*} ctl - The control.
+*/
+void            init_sudoku_solve_ctl(sudoku_solve_ctl*);
+/**
+    Solves the input sudoku in place like sudoku_solve_engine_ctl, telling a
+    puzzle without solution apart from a search that was stopped.
+
+    @param {sudoku_field*} f - Input sudoku to solve.
+    @param {su_engine_t} engine - The engine to solve with.
+    @param {sudoku_solve_ctl*} ctl - Search control. May be NULL.
+    @return {int} - A SUDOKU_SOLVE_ outcome. The field is solved only for
+                    SUDOKU_SOLVE_SOLVED.
+*/
+int             sudoku_solve_status(sudoku_field*, su_engine_t, sudoku_solve_ctl*);
+/**
+    Gets the time of the monotonic clock, as used for deadlines.
+    @return {double} - Seconds from an arbitrary starting point.
+*/
+double          sudoku_clock_seconds(void);
+/**
+    Gets the search counters of the calling thread and starts them over.
+    Taken before and after a solve they give the counters of that solve.
+    @param {sudoku_search_stats*} out - Set to the counters. May be NULL to
+                                        only start over.
+*/
+void            take_sudoku_search_stats(sudoku_search_stats* out);
+/**
+    Adds counters to a total. max_depth becomes the larger of the two.
+    @param {sudoku_search_stats*} total - The total.
+    @param {sudoku_search_stats*} s - The counters to add.
+*/
+void            add_sudoku_search_stats(sudoku_search_stats* total, const sudoku_search_stats* s);
+/**
+    Prints counters as a JSON object, without line break.
+    @param {FILE*} out - Stream to print to.
+    @param {sudoku_search_stats*} s - The counters.
+*/
+void            print_sudoku_search_stats_json(FILE* out, const sudoku_search_stats* s);
+/**
+    Tries to solve the input sudoku by scanning the candidates of every cell
+    at once before each step. All naked singles found by a scan are placed
+    together, otherwise the search branches on the cell with the fewest
+    candidates. The scan is vectorized (AVX2) when asked for and supported by
+    the CPU, and scalar otherwise, so both can be compared on equal terms.
+    See sudoku_bitboard.c.
+
+    @param {sudoku_field*} f - Input sudoku to solve.
+    @param {int} vectorized - Non-zero to use the vectorized scan.
+    @param {sudoku_solve_ctl*} ctl - Search control. May be NULL.
+    @return {sudoku_field*} - The input field (solved) if successful. NULL otherwise.
+*/
+sudoku_field*   sudoku_solve_bitboard(sudoku_field*, int vectorized, sudoku_solve_ctl*);
+/**
+    A prebuilt dancing-links matrix for sudoku_solve_dlx. See sudoku_dlx.c.
+*/
+typedef struct sudoku_dlx sudoku_dlx;
+/**
+    Allocates and builds a dancing-links matrix.
+
+    @return {sudoku_dlx*} - A pointer to the new matrix.
+*/
+sudoku_dlx*     alloc_sudoku_dlx(void);
+/**
+    Frees a dancing-links matrix.
+    @param {sudoku_dlx*} x - The matrix to free.
+*/
+void            free_sudoku_dlx(sudoku_dlx*);
+/**
+    Gets the dancing-links matrix of the calling thread, building it on first
+    use. It is freed when the thread exits.
+
+    @return {sudoku_dlx*} - The matrix of the thread. NULL if it could not be
+                            allocated.
+*/
+sudoku_dlx*     sudoku_thread_dlx(void);
+/**
+    Solves the input sudoku in place with Algorithm X on a prebuilt matrix.
+    The field is left unchanged if no solution exists.
+
+    @param {sudoku_dlx*} x - Matrix from alloc_sudoku_dlx. Reusable afterwards.
+    @param {sudoku_field*} f - Input sudoku to solve.
+    @param {sudoku_solve_ctl*} ctl - Search control. May be NULL.
+    @return {sudoku_field*} - The input field (solved) if successful. NULL otherwise.
+*/
+sudoku_field*   sudoku_solve_dlx(sudoku_dlx*, sudoku_field*, sudoku_solve_ctl*);
+/**
+    Gets the engine with a given name, eg "linear" or "mrv".
+    @param {char*} name - The engine name.
+    @return {int} - The su_engine_t value. -1 if there is no such engine.
+*/
+int             sudoku_engine_from_name(const char*);
+/**
+    Gets the name of an engine.
+    @param {su_engine_t} engine - The engine.
+    @return {char*} - The engine name.
+*/
+const char*     sudoku_engine_name(su_engine_t);
 
 // Support functions
 /**
-    This function is supposed check wether or not a sudoku is valid before even
-    trying to complete it.
-    IT DOES NOT CURRENTLY DO THAT.
-    @param {sudoku_field*} f - A pointer to the field.s
-    @return {int} - 1 if seemingly valid, 0 otherwise.
+    Checks that a sudoku is consistent before trying to complete it: single
+    values in the cells, no value twice in a row, column or box, masks that
+    match the cells, a candidate left in every empty cell and a cell left for
+    every missing value of a row, column or box.
+    @param {sudoku_field*} f - A pointer to the field.
+    @return {int} - 1 if valid, 0 otherwise.
 */
 int             sudoku_valid(const sudoku_field*);
 /**
-    Get a sudoku field from a string or char array. Currently only designed
-    for 9x9 or 16x16 sudokus. Also the sudoku size currently set by a size
-    define in the sudoku_general_tools header
+    Get a sudoku field from a string or char array, in the format of
+    sudoku_read_line.
 
-    @param {char*} s - The input string.
-    @return {sudoku_field} - The return sudoku field.
+    @param {char*} s - The input string, at least SUDOKU_CELLS characters.
+    @return {sudoku_field} - The return sudoku field. NULL if the string has
+                             unknown characters or conflicting clues.
 */
 sudoku_field*   sudoku_from_input(const char*);
+// Return values of sudoku_read_line.
+#define SUDOKU_LINE_OK          (0)
+#define SUDOKU_LINE_BAD_CHAR    (1) // Not a value of this sudoku size.
+#define SUDOKU_LINE_CONFLICT    (2) // Two clues share a value in a row, column or box.
 /**
-    This function is supposed to return a string containing the sudoku.
-    IT DOES NOT CURRENTLY DO THAT.
-    @param {sudoku_field*} f - A pointer to the field.s
-    @return {char*} - A string containing the sudoku.
+    Reads a sudoku from a line of SUDOKU_CELLS characters into an existing
+    field, without printing anything. '0' and '.' are empty cells.
+
+    @param {sudoku_field*} f - The field to read into. Cleared first.
+    @param {char*} line - The input line.
+    @return {int} - SUDOKU_LINE_OK if successful. Non-zero otherwise.
 */
-char*           sudoku_to_string(sudoku_field*);
+int             sudoku_read_line(sudoku_field*, const char* line);
 /**
-    Print a sudoku field. Currently only designed for 9x9 or 16x16 sudokus.
+    Writes a sudoku as SUDOKU_CELLS characters, the same format as read by
+    sudoku_read_line. No line break or terminating null is written.
+
+    @param {sudoku_field*} f - The field to write.
+    @param {char*} out - Buffer of at least SUDOKU_CELLS characters.
+*/
+void            sudoku_write_line(const sudoku_field*, char* out);
+// Formats of sudoku_to_string.
+#define SUDOKU_FORMAT_LINE  (0) // SUDOKU_CELLS characters as sudoku_write_line.
+#define SUDOKU_FORMAT_GRID  (1) // One row per line, boxes set apart:
+                                //  5 3 4 | 6 7 8 | 9 1 2
+                                //  ------+-------+------
+#define SUDOKU_FORMAT_ROWS  (2) // One row per line, as print_sudoku_from_field.
+// Characters in a row of SUDOKU_FORMAT_GRID, without the line break.
+#define SUDOKU_GRID_WIDTH   (2 * SUDOKU_SIZE - 1 + 2 * (SUDOKU_SIZE / SUDOKU_BOX_WIDTH - 1))
+// Buffer size that holds any format, including the terminating null.
+#define SUDOKU_STRING_MAX   ((SUDOKU_SIZE + SUDOKU_SIZE / SUDOKU_BOX_WIDTH - 1) * (SUDOKU_GRID_WIDTH + 1) + 1)
+/**
+    Writes a sudoku as text into a buffer, ending with a line break and a
+    terminating null. Nothing is allocated, so many sudokus can be written
+    one after the other into one buffer and printed at once. Empty cells are
+    written as '0' and cells holding more than one value as 'X'.
+
+    @param {sudoku_field*} f - The field to write.
+    @param {int} format - A SUDOKU_FORMAT_.
+    @param {char*} out - Buffer of at least SUDOKU_STRING_MAX characters.
+    @return {size_t} - Number of characters written, without the null. 0 for
+                       an unknown format.
+*/
+size_t          sudoku_to_string(const sudoku_field* f, int format, char* out);
+/**
+    Print a sudoku field, one row per line, with a single write to stdout.
 
     @param {sudoku_field} s - The sudoku field to be printed.
     @return {int} - 0 if successful. Non zero otherwise.
@@ -255,32 +651,53 @@ char*           sudoku_to_string(sudoku_field*);
 int print_sudoku_from_field(const sudoku_field*);
 
 /**
-    Allocates the memory for a sudoku field, including the internal arena.
+    Allocates a cleared sudoku field.
 
-    @return {sudoku_field*} - A pointer to the new arena.
+    @return {sudoku_field*} - A pointer to the new field.
 */
 sudoku_field* alloc_sudoku_field();
 /**
-    Allocates the  internal memory of the sudoku field as a cleared arena.
-
-    @param {sudoku_field*} s - The field to get a new arena.
-    @return {int} - 0 if successful. Non zero otherwise..
+    Clears a sudoku field, ie empties every cell.
+    @param {sudoku_field*} f - The field to clear.
 */
-int alloc_sudoku_field_internal_arena(sudoku_field*);
+void clear_sudoku_field(sudoku_field*);
 /**
     Frees the memory of  a sudoku field.
     @param {sudoku_field*} f - A pointer to the field to be freed.
 */
 void free_sudoku_field(sudoku_field*);
-/**
-    Frees the internal memory of a sudoku field.
-    @param {sudoku_field*} f - A pointer to the field.
-*/
-void free_sudoku_field_internal_arena(sudoku_field*);
 /**
     Returns a pointer to a complete copy of the input sudoku field.
     @param {sudoku_field*} f - A pointer to the field to be copied.
 */
 sudoku_field* copy_sudoku_field(const sudoku_field* from);
+/**
+    Allocates a pool of fields in one contiguous slab. Every field starts on
+    its own cache line, so fields used by different threads never share one.
+    A pool is not thread safe, take the fields before handing them out.
+
+    @param {int} capacity - Number of fields in the pool.
+    @return {sudoku_field_pool*} - A pointer to the new pool.
+*/
+sudoku_field_pool* alloc_sudoku_field_pool(int capacity);
+/**
+    Takes a cleared field from a pool.
+    @param {sudoku_field_pool*} pool - The pool.
+    @return {sudoku_field*} - A pointer to the field. NULL if the pool is empty.
+*/
+sudoku_field* take_sudoku_field(sudoku_field_pool*);
+/**
+    Gives a field back to the pool it was taken from, to be taken again.
+    Pools that take their fields once, as the batch pools do, needn't give
+    them back: free_sudoku_field_pool frees taken fields as well.
+    @param {sudoku_field_pool*} pool - The pool.
+    @param {sudoku_field*} f - The field.
+*/
+void give_sudoku_field(sudoku_field_pool*, sudoku_field*);
+/**
+    Frees a pool and every field in it, taken or not.
+    @param {sudoku_field_pool*} pool - The pool to free.
+*/
+void free_sudoku_field_pool(sudoku_field_pool*);
 
 #endif // SUDOKU_GENERAL_TOOLS_H_INCLUDED
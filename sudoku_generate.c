@@ -0,0 +1,311 @@
+// Sudoku puzzle generator
+#include <stdio.h>      // For standard IO
+#include <stdlib.h>     // For standard stuff
+#include <string.h>     // strcmp, memset
+#include <stdatomic.h>  // Shared counters
+#include <pthread.h>    // Generator threads
+
+#include "sudoku_general_tools.h"
+#include "sudoku_generate.h"
+
+/**
+    Generation of puzzles with a unique solution.
+*/
+
+// Full grids a thread tries in a row for one puzzle before giving up.
+#define GENERATE_MAX_GRIDS  (1000)
+
+// Symmetry names, indexed by su_symmetry_t.
+static const char* symmetry_names[SUDOKU_SYM_COUNT] = {
+    "none",
+    "central",
+    "rotational",
+    "mirror"
+};
+
+/**
+    Gets the next number of a xorshift64* sequence.
+*/
+static uint64_t generate_rand(uint64_t* state){
+    uint64_t x = *state;
+    x ^= x >> 12;
+    x ^= x << 25;
+    x ^= x >> 27;
+    *state = x;
+    return x * 0x2545F4914F6CDD1DULL;
+}
+/**
+    Gets the non-zero start state of the random sequence of a thread, by
+    mixing the seed and the thread number (splitmix64).
+*/
+static uint64_t generate_seed(uint64_t seed, int id){
+    uint64_t z = seed + (id + 1) * 0x9E3779B97F4A7C15ULL;
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    z ^= z >> 31;
+    return z != 0 ? z : 1;
+}
+/**
+    Gets a random one of the set bits of a mask.
+*/
+static su_cell_t generate_pick(su_cell_t mask, uint64_t* rng){
+    int k = generate_rand(rng) % count_candidates(mask);
+    while(k-- > 0)
+        mask &= mask - 1;
+    return mask & (~mask + 1);
+}
+/**
+    Fills every empty cell of a field with random values, always filling the
+    cell with the fewest candidates next.
+    @return {int} - 1 if the field was filled. 0 if there is no way to fill it.
+*/
+static int generate_fill(sudoku_field* f, uint64_t* rng){
+    su_cell_t candidates, nbr;
+    int rc = find_mrv_cell(f, &candidates);
+
+    if(rc == SUDOKU_NO_EMPTY_CELL)
+        return 1;
+    if(rc == SUDOKU_DEAD_CELL)
+        return 0;
+    while(candidates){
+        nbr = generate_pick(candidates, rng);
+        candidates ^= nbr;
+        set_cell_lin(f, rc, nbr);
+        if(generate_fill(f, rng))
+            return 1;
+        unset_cell_lin(f, rc, nbr);
+    }
+    return 0;
+}
+/**
+    Gets the cells a cell is mapped to by a symmetry, the cell itself first.
+    @return {int} - Number of distinct cells written to orbit.
+*/
+static int generate_orbit(int rc, su_symmetry_t symmetry, int orbit[4]){
+    int r = rc_to_r(rc);
+    int c = rc_to_c(rc);
+    int last = SUDOKU_SIZE - 1;
+    int images[3];
+    int n_images = 0;
+    int n = 1;
+    int i, j;
+
+    switch(symmetry){
+        case(SUDOKU_SYM_CENTRAL):
+            images[n_images++] = r_and_c_to_rc(last - r, last - c);
+            break;
+        case(SUDOKU_SYM_ROTATIONAL):
+            images[n_images++] = r_and_c_to_rc(c, last - r);
+            images[n_images++] = r_and_c_to_rc(last - r, last - c);
+            images[n_images++] = r_and_c_to_rc(last - c, r);
+            break;
+        case(SUDOKU_SYM_MIRROR):
+            images[n_images++] = r_and_c_to_rc(r, last - c);
+            break;
+        default:
+            break;
+    }
+    orbit[0] = rc;
+    for(i = 0; i < n_images; i++){
+        for(j = 0; j < n && orbit[j] != images[i]; j++)
+            ;
+        if(j == n)
+            orbit[n++] = images[i];
+    }
+    return n;
+}
+/**
+    Checks whether a field has a solution with another value than nbr in
+    cell rc. The field is left unchanged.
+*/
+static int generate_has_other(sudoku_field* f, int rc, su_cell_t nbr){
+    sudoku_candidates c;
+    int ret;
+
+    init_sudoku_candidates(f, &c);
+    c.cell[rc] &= ~nbr;
+    if(c.cell[rc] == ZERO)
+        return 0;
+    ret = sudoku_solve_rec_prop(f, &c) != NULL;
+    undo_sudoku_candidates(f, &c, 0);
+    return ret;
+}
+
+/**
+    Generates one puzzle with a unique solution in place.
+
+    Removing clues from a puzzle whose only solution is known can only give a
+    second solution that differs from it in one of the removed cells. So
+    instead of counting solutions, every removal is checked by looking for a
+    solution with another value in each removed cell, which fails fast.
+
+    @param {sudoku_field*} f - The field to generate into. Its contents are lost.
+    @param {int} clues - Largest number of clues to accept.
+    @param {su_symmetry_t} symmetry - Symmetry of the clue pattern.
+    @param {uint64_t*} rng - Random state, non-zero. Updated.
+    @return {sudoku_field*} - The field holding the puzzle if successful. NULL
+                              if the grid could not be brought down to clues.
+*/
+sudoku_field* sudoku_generate_one(sudoku_field* f, int clues, su_symmetry_t symmetry, uint64_t* rng){
+    int order[SUDOKU_CELLS];
+    int orbit[4];
+    su_cell_t values[4];
+    int n_clues = SUDOKU_CELLS;
+    int i, j, n, tmp, unique;
+
+    clear_sudoku_field(f);
+    generate_fill(f, rng); // An empty field can always be filled.
+
+    for(i = 0; i < SUDOKU_CELLS; i++)
+        order[i] = i;
+    for(i = SUDOKU_CELLS - 1; i > 0; i--){
+        j = generate_rand(rng) % (i + 1);
+        tmp = order[i];
+        order[i] = order[j];
+        order[j] = tmp;
+    }
+    for(i = 0; i < SUDOKU_CELLS && n_clues > clues; i++){
+        if(!get_cell_lin(f, order[i]))
+            continue; // Already removed with another cell of its orbit.
+        n = generate_orbit(order[i], symmetry, orbit);
+        for(j = 0; j < n; j++){
+            values[j] = get_cell_lin(f, orbit[j]);
+            unset_cell_lin(f, orbit[j], values[j]);
+        }
+        unique = 1;
+        for(j = 0; j < n && unique; j++)
+            unique = !generate_has_other(f, orbit[j], values[j]);
+        if(unique){
+            n_clues -= n;
+        }else{
+            for(j = 0; j < n; j++)
+                set_cell_lin(f, orbit[j], values[j]);
+        }
+    }
+    return n_clues <= clues ? f : NULL;
+}
+
+// Generator threads
+
+/**
+    State shared by the generator threads.
+*/
+typedef struct generate_run generate_run;
+struct generate_run {
+    const sudoku_generate_opts* opts;
+    FILE* out;
+    pthread_mutex_t out_lock;   // Protects out.
+    atomic_long claimed;        // Puzzles handed out so far.
+    atomic_long generated;
+    atomic_long grids;
+    atomic_int gave_up;         // Set when the clue target looks out of reach.
+};
+typedef struct generate_worker generate_worker;
+struct generate_worker {
+    pthread_t thread;
+    generate_run* run;
+    uint64_t rng;
+};
+
+/**
+    Generator thread. Claims puzzles until enough have been handed out.
+*/
+static void* generate_worker_main(void* arg){
+    generate_worker* w = arg;
+    generate_run* run = w->run;
+    sudoku_field f; // Reused for every puzzle.
+    char line[SUDOKU_CELLS + 1];
+    int tries;
+
+    while(!atomic_load(&run->gave_up) && atomic_fetch_add(&run->claimed, 1) < run->opts->count){
+        for(tries = 1; ; tries++){
+            atomic_fetch_add(&run->grids, 1);
+            if(sudoku_generate_one(&f, run->opts->clues, run->opts->symmetry, &w->rng) != NULL)
+                break;
+            if(tries == GENERATE_MAX_GRIDS || atomic_load(&run->gave_up)){
+                atomic_store(&run->gave_up, 1);
+                return NULL;
+            }
+        }
+        sudoku_write_line(&f, line);
+        line[SUDOKU_CELLS] = '\n';
+        pthread_mutex_lock(&run->out_lock);
+        fwrite(line, 1, sizeof(line), run->out);
+        pthread_mutex_unlock(&run->out_lock);
+        atomic_fetch_add(&run->generated, 1);
+    }
+    return NULL;
+}
+/**
+    Generates puzzles on several threads and writes them to a stream, one
+    puzzle per line in the format of sudoku_read_line. The order of the lines
+    depends on the thread scheduling.
+
+    @param {FILE*} out - Stream to write puzzles to.
+    @param {sudoku_generate_opts*} opts - Options of the run.
+    @param {sudoku_generate_stats*} stats - Filled in with the counters of the run.
+    @return {int} - 0 if successful. Non-zero on write errors or if the clue
+                    target seems to be out of reach.
+*/
+int sudoku_generate(FILE* out, const sudoku_generate_opts* opts, sudoku_generate_stats* stats){
+    generate_run run;
+    generate_worker* workers;
+    int t;
+    double start = sudoku_clock_seconds();
+
+    workers = malloc(opts->threads * sizeof(generate_worker));
+    if(workers == NULL){
+        fprintf(stderr, "Could not allocate memory for the generator, %d", __LINE__);
+        exit(1);
+    }
+    run.opts = opts;
+    run.out = out;
+    pthread_mutex_init(&run.out_lock, NULL);
+    atomic_init(&run.claimed, 0);
+    atomic_init(&run.generated, 0);
+    atomic_init(&run.grids, 0);
+    atomic_init(&run.gave_up, 0);
+    for(t = 0; t < opts->threads; t++){
+        workers[t].run = &run;
+        workers[t].rng = generate_seed(opts->seed, t);
+        if(pthread_create(&workers[t].thread, NULL, generate_worker_main, workers + t)){
+            fprintf(stderr, "Could not start generator thread, %d", __LINE__);
+            exit(1);
+        }
+    }
+    for(t = 0; t < opts->threads; t++)
+        pthread_join(workers[t].thread, NULL);
+    fflush(out);
+
+    memset(stats, 0, sizeof(*stats));
+    stats->generated = atomic_load(&run.generated);
+    stats->grids = atomic_load(&run.grids);
+    stats->seconds = sudoku_clock_seconds() - start;
+    pthread_mutex_destroy(&run.out_lock);
+    free(workers);
+    return ferror(out) || atomic_load(&run.gave_up);
+}
+/**
+    Prints the summary of a generator run.
+
+    @param {FILE*} out - Stream to print to.
+    @param {sudoku_generate_stats*} stats - The counters of the run.
+*/
+void print_sudoku_generate_stats(FILE* out, const sudoku_generate_stats* stats){
+    fprintf(out, "Generated: %ld Grids: %ld\n", stats->generated, stats->grids);
+    fprintf(out, "Time: %.3f s Throughput: %.0f puzzles/s\n", stats->seconds,
+                stats->seconds > 0 ? stats->generated / stats->seconds : 0.0);
+}
+/**
+    Gets the symmetry with a given name, eg "none" or "central".
+    @param {char*} name - The symmetry name.
+    @return {int} - The su_symmetry_t value. -1 if there is no such symmetry.
+*/
+int sudoku_symmetry_from_name(const char* name){
+    int s;
+    for(s = 0; s < SUDOKU_SYM_COUNT; s++){
+        if(strcmp(name, symmetry_names[s]) == 0)
+            return s;
+    }
+    return -1;
+}
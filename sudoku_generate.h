@@ -0,0 +1,88 @@
+#ifndef SUDOKU_GENERATE_H_INCLUDED
+#define SUDOKU_GENERATE_H_INCLUDED
+
+#include <stdio.h>      // FILE
+#include <stdint.h>     // uint64_t
+
+#include "sudoku_general_tools.h"
+
+/**
+    Generation of puzzles with a unique solution. A random full grid is
+    filled in, after which clues are removed in random order as long as the
+    solution stays unique. Clues are removed together with their images under
+    the chosen symmetry, so the clue pattern keeps that symmetry.
+*/
+
+/**
+    Symmetry of the clue pattern.
+*/
+typedef enum {
+    SUDOKU_SYM_NONE = 0,
+    SUDOKU_SYM_CENTRAL,     // 180 degree rotation.
+    SUDOKU_SYM_ROTATIONAL,  // 90 degree rotation.
+    SUDOKU_SYM_MIRROR,      // Left-right reflection.
+    SUDOKU_SYM_COUNT        // Number of symmetries, not a symmetry.
+} su_symmetry_t;
+
+/**
+    Options of a generator run.
+*/
+typedef struct sudoku_generate_opts sudoku_generate_opts;
+struct sudoku_generate_opts {
+    long count;             // Puzzles to generate.
+    int clues;              // Target number of clues. Puzzles get at most this
+                            // many, the symmetry may force one or more less.
+    su_symmetry_t symmetry;
+    int threads;            // Generator threads.
+    uint64_t seed;          // On one thread, the same seed gives the same puzzles.
+};
+
+/**
+    Counters for a generator run.
+*/
+typedef struct sudoku_generate_stats sudoku_generate_stats;
+struct sudoku_generate_stats {
+    long generated;
+    long grids;             // Full grids used, including those that could not
+                            // be brought down to the target.
+    double seconds;         // Wall-clock time of the whole run.
+};
+
+/**
+    Generates one puzzle with a unique solution in place.
+
+    @param {sudoku_field*} f - The field to generate into. Its contents are lost.
+    @param {int} clues - Largest number of clues to accept.
+    @param {su_symmetry_t} symmetry - Symmetry of the clue pattern.
+    @param {uint64_t*} rng - Random state, non-zero. Updated.
+    @return {sudoku_field*} - The field holding the puzzle if successful. NULL
+                              if the grid could not be brought down to clues.
+*/
+sudoku_field* sudoku_generate_one(sudoku_field* f, int clues, su_symmetry_t symmetry, uint64_t* rng);
+/**
+    Generates puzzles on several threads and writes them to a stream, one
+    puzzle per line in the format of sudoku_read_line. The order of the lines
+    depends on the thread scheduling.
+
+    @param {FILE*} out - Stream to write puzzles to.
+    @param {sudoku_generate_opts*} opts - Options of the run.
+    @param {sudoku_generate_stats*} stats - Filled in with the counters of the run.
+    @return {int} - 0 if successful. Non-zero on write errors or if the clue
+                    target seems to be out of reach.
+*/
+int sudoku_generate(FILE* out, const sudoku_generate_opts* opts, sudoku_generate_stats* stats);
+/**
+    Prints the summary of a generator run.
+
+    @param {FILE*} out - Stream to print to.
+    @param {sudoku_generate_stats*} stats - The counters of the run.
+*/
+void print_sudoku_generate_stats(FILE* out, const sudoku_generate_stats* stats);
+/**
+    Gets the symmetry with a given name, eg "none" or "central".
+    @param {char*} name - The symmetry name.
+    @return {int} - The su_symmetry_t value. -1 if there is no such symmetry.
+*/
+int sudoku_symmetry_from_name(const char* name);
+
+#endif // SUDOKU_GENERATE_H_INCLUDED
@@ -0,0 +1,117 @@
+// Sudoku solvers for sizes chosen at runtime
+#include <stdint.h>     // uint16_t, uint32_t
+#include <stdlib.h>     // malloc, free
+#include <string.h>     // memset
+#include <stdatomic.h>  // Shared subtree index and cancellation
+#include <pthread.h>    // Solver threads of sudoku_solve_sized_parallel
+
+#include "sudoku_kernel.h"
+
+/**
+    One instance of sudoku_kernel_impl.h per supported size. The cells are
+    16 bits wide up to 16x16 and 32 bits wide for 25x25.
+*/
+
+// Subtrees to aim for per thread in sudoku_solve_sized_parallel.
+#define SUDOKU_SIZED_SUBTREES_PER_THREAD (16)
+
+#define K_SIZE (4)
+#define K_BOX_WIDTH (2)
+#define K_CELL_T uint16_t
+#define K_NAME(x) kernel4_##x
+#include "sudoku_kernel_impl.h"
+#undef K_SIZE
+#undef K_BOX_WIDTH
+#undef K_CELL_T
+#undef K_NAME
+
+#define K_SIZE (9)
+#define K_BOX_WIDTH (3)
+#define K_CELL_T uint16_t
+#define K_NAME(x) kernel9_##x
+#include "sudoku_kernel_impl.h"
+#undef K_SIZE
+#undef K_BOX_WIDTH
+#undef K_CELL_T
+#undef K_NAME
+
+#define K_SIZE (16)
+#define K_BOX_WIDTH (4)
+#define K_CELL_T uint16_t
+#define K_NAME(x) kernel16_##x
+#include "sudoku_kernel_impl.h"
+#undef K_SIZE
+#undef K_BOX_WIDTH
+#undef K_CELL_T
+#undef K_NAME
+
+#define K_SIZE (25)
+#define K_BOX_WIDTH (5)
+#define K_CELL_T uint32_t
+#define K_NAME(x) kernel25_##x
+#include "sudoku_kernel_impl.h"
+#undef K_SIZE
+#undef K_BOX_WIDTH
+#undef K_CELL_T
+#undef K_NAME
+
+/**
+    Checks whether there is a solver for a given size.
+    @param {int} size - Number of rows (4, 9, 16 or 25).
+    @return {int} - Non-zero if the size is supported. 0 otherwise.
+*/
+int sudoku_size_supported(int size){
+    return size == 4 || size == 9 || size == 16 || size == 25;
+}
+/**
+    Solves a sudoku of a given size.
+    @param {int} size - Number of rows (4, 9, 16 or 25).
+    @param {char*} in - The puzzle, size*size characters.
+    @param {char*} out - Buffer of size*size characters for the solution. Only
+                         written if the sudoku is solved.
+    @return {int} - SUDOKU_SIZED_SOLVED if successful. Non-zero otherwise.
+*/
+int sudoku_solve_sized(int size, const char* in, char* out){
+    switch(size){
+        case(4):
+            return kernel4_solve(in, out);
+        case(9):
+            return kernel9_solve(in, out);
+        case(16):
+            return kernel16_solve(in, out);
+        case(25):
+            return kernel25_solve(in, out);
+        default:
+            return SUDOKU_SIZED_BAD_INPUT;
+    }
+}
+/**
+    Solves a sudoku of a given size on several threads. The top of the search
+    tree is split into subtrees that the threads take turns solving, and the
+    others are cancelled as soon as one finds a solution.
+    @param {int} size - Number of rows (4, 9, 16 or 25).
+    @param {char*} in - The puzzle, size*size characters.
+    @param {char*} out - Buffer of size*size characters for the solution. Only
+                         written if the sudoku is solved.
+    @param {int} n_threads - Number of threads, the calling one included. At
+                             most SUDOKU_SIZED_MAX_THREADS are used.
+    @return {int} - SUDOKU_SIZED_SOLVED if successful. Non-zero otherwise.
+*/
+int sudoku_solve_sized_parallel(int size, const char* in, char* out, int n_threads){
+    if(n_threads <= 1)
+        return sudoku_solve_sized(size, in, out);
+    if(n_threads > SUDOKU_SIZED_MAX_THREADS)
+        n_threads = SUDOKU_SIZED_MAX_THREADS;
+    switch(size){
+        case(4):
+            return kernel4_solve_parallel(in, out, n_threads);
+        case(9):
+            return kernel9_solve_parallel(in, out, n_threads);
+        case(16):
+            return kernel16_solve_parallel(in, out, n_threads);
+        case(25):
+            return kernel25_solve_parallel(in, out, n_threads);
+        default:
+            return SUDOKU_SIZED_BAD_INPUT;
+    }
+}
@@ -0,0 +1,57 @@
+#ifndef SUDOKU_KERNEL_H_INCLUDED
+#define SUDOKU_KERNEL_H_INCLUDED
+
+/**
+    Solvers for sudokus of a size chosen at runtime. Every supported size has
+    its own instance of the same solver, compiled with the size, box width and
+    cell type as constants (see sudoku_kernel_impl.h), and
+    sudoku_solve_sized dispatches to the right one.
+
+    Puzzles are size*size characters, row by row. '0' or '.' is an empty cell,
+    '1' to '9' are the values 1 to 9 and 'A' onwards are the values from 10,
+    so a 16x16 sudoku uses 1-9 and A-G.
+*/
+
+// Largest supported size.
+#define SUDOKU_MAX_SIZE (25)
+// Characters of the values 0 (empty) to SUDOKU_MAX_SIZE. Every reader and
+// writer of puzzles uses them, the sudoku_field ones included.
+#define SUDOKU_VALUE_CHARS "0123456789ABCDEFGHIJKLMNOP"
+// Most threads of sudoku_solve_sized_parallel.
+#define SUDOKU_SIZED_MAX_THREADS (64)
+
+// Return values of sudoku_solve_sized.
+#define SUDOKU_SIZED_SOLVED     (0)
+#define SUDOKU_SIZED_UNSOLVABLE (1) // Including puzzles with conflicting clues.
+#define SUDOKU_SIZED_BAD_INPUT  (2) // Unsupported size or unknown character.
+
+/**
+    Checks whether there is a solver for a given size.
+    @param {int} size - Number of rows (4, 9, 16 or 25).
+    @return {int} - Non-zero if the size is supported. 0 otherwise.
+*/
+int sudoku_size_supported(int size);
+/**
+    Solves a sudoku of a given size.
+    @param {int} size - Number of rows (4, 9, 16 or 25).
+    @param {char*} in - The puzzle, size*size characters.
+    @param {char*} out - Buffer of size*size characters for the solution. Only
+                         written if the sudoku is solved.
+    @return {int} - SUDOKU_SIZED_SOLVED if successful. Non-zero otherwise.
+*/
+int sudoku_solve_sized(int size, const char* in, char* out);
+/**
+    Solves a sudoku of a given size on several threads. The top of the search
+    tree is split into subtrees that the threads take turns solving, and the
+    others are cancelled as soon as one finds a solution.
+    @param {int} size - Number of rows (4, 9, 16 or 25).
+    @param {char*} in - The puzzle, size*size characters.
+    @param {char*} out - Buffer of size*size characters for the solution. Only
+                         written if the sudoku is solved.
+    @param {int} n_threads - Number of threads, the calling one included. At
+                             most SUDOKU_SIZED_MAX_THREADS are used.
+    @return {int} - SUDOKU_SIZED_SOLVED if successful. Non-zero otherwise.
+*/
+int sudoku_solve_sized_parallel(int size, const char* in, char* out, int n_threads);
+
+#endif // SUDOKU_KERNEL_H_INCLUDED
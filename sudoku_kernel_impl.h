@@ -0,0 +1,362 @@
+// Sudoku solver kernel for one size. NOT a normal header!
+/**
+    Included once per supported size by sudoku_kernel.c, with the following
+    defined beforehand:
+
+    K_SIZE       - Number of rows, columns and boxes.
+    K_BOX_WIDTH  - Width of a box. K_SIZE = K_BOX_WIDTH * K_BOX_WIDTH.
+    K_CELL_T     - Unsigned type with at least K_SIZE bits for the masks.
+    K_NAME(x)    - Gives the name of x for this size, eg kernel9_##x.
+
+    Since the size is a constant every division and modulo below is folded
+    into multiplications and shifts, and the loops have known trip counts.
+    The solver propagates naked and hidden singles, branches on the cell with
+    the fewest candidates and undoes its placements through a trail. All
+    state lives in one struct on the stack, so a copy of it is a subtree that
+    another thread can search.
+*/
+
+#define K_CELLS (K_SIZE * K_SIZE)
+#define K_ALL   ((K_CELL_T) ((((unsigned long) 1) << K_SIZE) - 1))
+#define K_STATE K_NAME(state)
+
+typedef struct K_STATE K_STATE;
+struct K_STATE {
+    K_CELL_T unit[3 * K_SIZE];  // Values in each row, then column, then box.
+    K_CELL_T cell[K_CELLS];     // One bit set for filled cells. 0 for empty.
+    short trail[K_CELLS];       // Cells placed by the solver, oldest first.
+    int trail_len;
+    atomic_int* cancel;         // The search gives up once set. May be NULL.
+};
+
+static inline int K_NAME(box_of)(int rc){
+    return K_BOX_WIDTH * ((rc / K_SIZE) / K_BOX_WIDTH) + (rc % K_SIZE) / K_BOX_WIDTH;
+}
+/**
+    Gets the rc index of the i:th cell of a unit. Rows come first, followed by
+    the columns and then the boxes.
+*/
+static inline int K_NAME(unit_cell)(int unit, int i){
+    int b;
+    if(unit < K_SIZE)
+        return unit * K_SIZE + i;
+    if(unit < 2 * K_SIZE)
+        return i * K_SIZE + unit - K_SIZE;
+    b = unit - 2 * K_SIZE;
+    return (K_BOX_WIDTH * (b / K_BOX_WIDTH) + i / K_BOX_WIDTH) * K_SIZE
+                + K_BOX_WIDTH * (b % K_BOX_WIDTH) + i % K_BOX_WIDTH;
+}
+static inline K_CELL_T K_NAME(candidates)(const K_STATE* s, int rc){
+    return ~(s->unit[rc / K_SIZE] | s->unit[K_SIZE + rc % K_SIZE]
+                | s->unit[2 * K_SIZE + K_NAME(box_of)(rc)]) & K_ALL;
+}
+/**
+    Places a value in an empty cell.
+    @return {int} - 0 if successful. Non-zero if the value is already taken.
+*/
+static inline int K_NAME(place)(K_STATE* s, int rc, K_CELL_T nbr){
+    int r = rc / K_SIZE;
+    int c = K_SIZE + rc % K_SIZE;
+    int b = 2 * K_SIZE + K_NAME(box_of)(rc);
+    if((s->unit[r] | s->unit[c] | s->unit[b]) & nbr)
+        return 1;
+    s->unit[r] |= nbr;
+    s->unit[c] |= nbr;
+    s->unit[b] |= nbr;
+    s->cell[rc] = nbr;
+    s->trail[s->trail_len++] = (short) rc;
+    return 0;
+}
+static void K_NAME(undo)(K_STATE* s, int mark){
+    int rc;
+    K_CELL_T nbr;
+    while(s->trail_len > mark){
+        rc = s->trail[--s->trail_len];
+        nbr = s->cell[rc];
+        s->unit[rc / K_SIZE] ^= nbr;
+        s->unit[K_SIZE + rc % K_SIZE] ^= nbr;
+        s->unit[2 * K_SIZE + K_NAME(box_of)(rc)] ^= nbr;
+        s->cell[rc] = 0;
+    }
+}
+/**
+    Places naked and hidden singles until nothing changes.
+    @return {int} - 0 if successful. Non-zero if a contradiction was found.
+*/
+static int K_NAME(propagate)(K_STATE* s){
+    int rc, unit, i;
+    int changed = 1;
+    K_CELL_T cand, once, twice, hidden, nbr, placed;
+
+    while(changed){
+        changed = 0;
+        for(rc = 0; rc < K_CELLS; rc++){
+            if(s->cell[rc])
+                continue;
+            cand = K_NAME(candidates)(s, rc);
+            if(cand == 0)
+                return 1;
+            if(!(cand & (cand - 1))){
+                K_NAME(place)(s, rc, cand);
+                changed = 1;
+            }
+        }
+        for(unit = 0; unit < 3 * K_SIZE; unit++){
+            once = twice = 0;
+            for(i = 0; i < K_SIZE; i++){
+                rc = K_NAME(unit_cell)(unit, i);
+                cand = s->cell[rc] ? 0 : K_NAME(candidates)(s, rc);
+                twice |= once & cand;
+                once  |= cand;
+            }
+            placed = s->unit[unit];
+            if((once | placed) != K_ALL)
+                return 1;
+            hidden = once & ~twice;
+            while(hidden){
+                nbr = hidden & (~hidden + 1);
+                hidden ^= nbr;
+                for(i = 0; i < K_SIZE; i++){
+                    rc = K_NAME(unit_cell)(unit, i);
+                    if(!s->cell[rc] && (K_NAME(candidates)(s, rc) & nbr))
+                        break;
+                }
+                if(i == K_SIZE || K_NAME(place)(s, rc, nbr))
+                    return 1;
+                changed = 1;
+            }
+        }
+    }
+    return 0;
+}
+/**
+    Propagates, then branches on the empty cell with the fewest candidates.
+    Everything placed is undone if no solution is found.
+    @return {int} - 1 if solved. 0 otherwise.
+*/
+static int K_NAME(search)(K_STATE* s){
+    int mark = s->trail_len;
+    int guess_mark;
+    int rc, count;
+    int best_rc = -1;
+    int best_count = K_SIZE + 1;
+    K_CELL_T candidates, nbr;
+
+    if(s->cancel != NULL && atomic_load_explicit(s->cancel, memory_order_relaxed))
+        return 0;
+    if(K_NAME(propagate)(s)){
+        K_NAME(undo)(s, mark);
+        return 0;
+    }
+    for(rc = 0; rc < K_CELLS && best_count > 2; rc++){
+        if(s->cell[rc])
+            continue;
+        count = __builtin_popcountl(K_NAME(candidates)(s, rc));
+        if(count < best_count){
+            best_rc = rc;
+            best_count = count;
+        }
+    }
+    if(best_rc == -1)
+        return 1;
+
+    guess_mark = s->trail_len;
+    candidates = K_NAME(candidates)(s, best_rc);
+    while(candidates){
+        nbr = candidates & (~candidates + 1);
+        candidates ^= nbr;
+        K_NAME(place)(s, best_rc, nbr);
+        if(K_NAME(search)(s))
+            return 1;
+        K_NAME(undo)(s, guess_mark);
+    }
+    K_NAME(undo)(s, mark);
+    return 0;
+}
+/**
+    Reads a puzzle of K_SIZE*K_SIZE characters into a cleared state.
+    @return {int} - 0 if successful. A SUDOKU_SIZED_ error otherwise.
+*/
+static int K_NAME(read)(K_STATE* s, const char* in){
+    int rc, v;
+    char ch;
+
+    memset(s, 0, sizeof(*s));
+    for(rc = 0; rc < K_CELLS; rc++){
+        ch = in[rc];
+        if(ch == '0' || ch == '.')
+            continue;
+        if(ch >= '1' && ch <= '9')
+            v = ch - '0';
+        else if(ch >= 'A' && ch <= 'Z')
+            v = ch - 'A' + 10;
+        else
+            return SUDOKU_SIZED_BAD_INPUT;
+        if(v > K_SIZE)
+            return SUDOKU_SIZED_BAD_INPUT;
+        if(K_NAME(place)(s, rc, (K_CELL_T) 1 << (v - 1)))
+            return SUDOKU_SIZED_UNSOLVABLE;
+    }
+    s->trail_len = 0; // Clues are never undone.
+    return 0;
+}
+static void K_NAME(write)(const K_STATE* s, char* out){
+    int rc;
+    for(rc = 0; rc < K_CELLS; rc++)
+        out[rc] = SUDOKU_VALUE_CHARS[__builtin_ctzl(s->cell[rc]) + 1];
+}
+/**
+    Solves a puzzle of K_SIZE*K_SIZE characters. See sudoku_solve_sized.
+*/
+static int K_NAME(solve)(const char* in, char* out){
+    K_STATE s;
+    int ret;
+
+    if((ret = K_NAME(read)(&s, in)))
+        return ret;
+    if(!K_NAME(search)(&s))
+        return SUDOKU_SIZED_UNSOLVABLE;
+    K_NAME(write)(&s, out);
+    return SUDOKU_SIZED_SOLVED;
+}
+
+// Parallel solving, see sudoku_solve_sized_parallel.
+
+/**
+    State shared by the threads solving one puzzle.
+*/
+typedef struct K_NAME(race) K_NAME(race);
+struct K_NAME(race) {
+    K_STATE* subtrees;
+    int n_subtrees;
+    atomic_int next;            // Index of the next subtree to hand out.
+    atomic_int cancel;          // Set once a solution is found.
+    int solution;               // Index of the solved subtree, -1 if none.
+};
+/**
+    Expands the frontier breadth first until it holds at least target
+    subtrees, as expand_frontier in sudoku_parallel.c. Dead ends are dropped.
+
+    @return {int} - Number of subtrees, -1 if a subtree was solved while
+                    splitting (it is then stored first), or -2 if out of memory.
+*/
+static int K_NAME(expand)(K_STATE** frontier, int n, int target){
+    K_STATE* next;
+    K_CELL_T candidates, nbr;
+    int n_next, i, rc, count, best_rc, best_count;
+
+    while(n > 0 && n < target){
+        if((next = malloc((size_t) n * K_SIZE * sizeof(K_STATE))) == NULL)
+            return -2;
+        n_next = 0;
+        for(i = 0; i < n; i++){
+            if(K_NAME(propagate)(*frontier + i))
+                continue;
+            best_rc = -1;
+            best_count = K_SIZE + 1;
+            for(rc = 0; rc < K_CELLS; rc++){
+                if((*frontier)[i].cell[rc])
+                    continue;
+                count = __builtin_popcountl(K_NAME(candidates)(*frontier + i, rc));
+                if(count < best_count){
+                    best_rc = rc;
+                    best_count = count;
+                }
+            }
+            if(best_rc == -1){
+                (*frontier)[0] = (*frontier)[i];
+                free(next);
+                return -1;
+            }
+            candidates = K_NAME(candidates)(*frontier + i, best_rc);
+            while(candidates){
+                nbr = candidates & (~candidates + 1);
+                candidates ^= nbr;
+                next[n_next] = (*frontier)[i];
+                next[n_next].trail_len = 0; // Every subtree starts over.
+                K_NAME(place)(next + n_next++, best_rc, nbr);
+            }
+        }
+        free(*frontier);
+        *frontier = next;
+        n = n_next;
+    }
+    return n;
+}
+/**
+    Solver thread. Takes subtrees until they run out or one is solved.
+*/
+static void* K_NAME(race_main)(void* arg){
+    K_NAME(race)* race = arg;
+    K_STATE local;
+    int i;
+
+    while(!atomic_load(&race->cancel)){
+        i = atomic_fetch_add(&race->next, 1);
+        if(i >= race->n_subtrees)
+            break;
+        local = race->subtrees[i];
+        local.cancel = &race->cancel;
+        if(K_NAME(search)(&local)){
+            if(atomic_exchange(&race->cancel, 1) == 0){
+                race->subtrees[i] = local;
+                race->solution = i;
+            }
+            break;
+        }
+    }
+    return NULL;
+}
+/**
+    Solves a puzzle on n_threads threads. See sudoku_solve_sized_parallel.
+*/
+static int K_NAME(solve_parallel)(const char* in, char* out, int n_threads){
+    K_NAME(race) race;
+    pthread_t threads[SUDOKU_SIZED_MAX_THREADS];
+    K_STATE* frontier;
+    int n, t, started;
+    int ret;
+
+    if((frontier = malloc(sizeof(K_STATE))) == NULL)
+        return K_NAME(solve)(in, out);
+    if((ret = K_NAME(read)(frontier, in))){
+        free(frontier);
+        return ret;
+    }
+    n = K_NAME(expand)(&frontier, 1, n_threads * SUDOKU_SIZED_SUBTREES_PER_THREAD);
+    if(n == -2){ // Out of memory, so on this thread alone.
+        free(frontier);
+        return K_NAME(solve)(in, out);
+    }
+    if(n == -1){
+        K_NAME(write)(frontier, out);
+        free(frontier);
+        return SUDOKU_SIZED_SOLVED;
+    }
+
+    race.subtrees = frontier;
+    race.n_subtrees = n;
+    race.solution = -1;
+    atomic_init(&race.next, 0);
+    atomic_init(&race.cancel, 0);
+    // The calling thread is one of the solvers. If a thread can't be
+    // started the others take its share.
+    for(started = 0; started < n_threads - 1; started++)
+        if(pthread_create(threads + started, NULL, K_NAME(race_main), &race))
+            break;
+    K_NAME(race_main)(&race);
+    for(t = 0; t < started; t++)
+        pthread_join(threads[t], NULL);
+
+    ret = SUDOKU_SIZED_UNSOLVABLE;
+    if(race.solution != -1){
+        K_NAME(write)(frontier + race.solution, out);
+        ret = SUDOKU_SIZED_SOLVED;
+    }
+    free(frontier);
+    return ret;
+}
+
+#undef K_CELLS
+#undef K_ALL
+#undef K_STATE
@@ -0,0 +1,179 @@
+// Sudoku library interface
+#include <string.h>     // memset
+
+#include "sudoku_general_tools.h"
+#include "sudoku_kernel.h"
+#include "sudoku_lib.h"
+
+/**
+    Side-effect free entry points for embedding the solvers, see sudoku_lib.h.
+*/
+
+static const char* status_strings[SUDOKU_STATUS_COUNT] = {
+    "solved", "unsolvable", "conflicting clues", "unknown character",
+    "bad argument", "out of memory", "search budget exceeded", "cancelled"
+};
+
+/**
+    Gets a short description of a status.
+    @param {su_status_t} status - The status.
+    @return {char*} - The description. "unknown status" if out of range.
+*/
+const char* sudoku_status_string(su_status_t status){
+    if((int) status < 0 || status >= SUDOKU_STATUS_COUNT)
+        return "unknown status";
+    return status_strings[status];
+}
+/**
+    Checks the size and engine of a solve, and that the engine can run on
+    the calling thread.
+*/
+static su_status_t lib_check(int size, su_engine_t engine){
+    if(size == SUDOKU_SIZE){
+        if((int) engine < 0 || engine >= SUDOKU_ENGINE_COUNT)
+            return SUDOKU_E_BAD_ARG;
+        // The only engine that allocates, done here so that it can't fail
+        // inside sudoku_solve_engine.
+        if(engine == SUDOKU_ENGINE_DLX && sudoku_thread_dlx() == NULL)
+            return SUDOKU_E_NO_MEMORY;
+        return SUDOKU_OK;
+    }
+    return sudoku_size_supported(size) ? SUDOKU_OK : SUDOKU_E_BAD_ARG;
+}
+/**
+    Solves one puzzle whose size and engine have been checked.
+*/
+static su_status_t lib_solve(sudoku_field* f, int size, su_engine_t engine,
+                                        const char* puzzle, char* solution, sudoku_solve_ctl* ctl){
+    su_status_t ret;
+
+    if(size != SUDOKU_SIZE){
+        switch(sudoku_solve_sized(size, puzzle, solution)){
+            case(SUDOKU_SIZED_SOLVED):
+                return SUDOKU_OK;
+            case(SUDOKU_SIZED_UNSOLVABLE):
+                ret = SUDOKU_E_UNSOLVABLE;
+                break;
+            default:
+                ret = SUDOKU_E_BAD_CHAR;
+        }
+    }else{
+        switch(sudoku_read_line(f, puzzle)){
+            case(SUDOKU_LINE_OK):
+                switch(sudoku_solve_status(f, engine, ctl)){
+                    case(SUDOKU_SOLVE_SOLVED):
+                        ret = SUDOKU_OK;
+                        break;
+                    case(SUDOKU_SOLVE_BUDGET):
+                        ret = SUDOKU_E_BUDGET;
+                        break;
+                    case(SUDOKU_SOLVE_CANCELLED):
+                        ret = SUDOKU_E_CANCELLED;
+                        break;
+                    default:
+                        ret = SUDOKU_E_UNSOLVABLE;
+                }
+                break;
+            case(SUDOKU_LINE_CONFLICT):
+                ret = SUDOKU_E_CONFLICT;
+                break;
+            default:
+                ret = SUDOKU_E_BAD_CHAR;
+        }
+        if(ret == SUDOKU_OK){
+            sudoku_write_line(f, solution);
+            return SUDOKU_OK;
+        }
+    }
+    memset(solution, '0', size * size);
+    return ret;
+}
+/**
+    Solves a single puzzle.
+
+    @param {int} size - Number of rows. SUDOKU_SIZE solves with the engine,
+                        other sizes supported by sudoku_size_supported use the
+                        sized kernels.
+    @param {su_engine_t} engine - Engine for SUDOKU_SIZE puzzles.
+    @param {char*} puzzle - The puzzle, size*size characters.
+    @param {char*} solution - Buffer of size*size characters. Filled with the
+                        solution if solved, with '0' otherwise.
+    @return {su_status_t} - SUDOKU_OK if solved. Non-zero otherwise.
+*/
+su_status_t sudoku_lib_solve(int size, su_engine_t engine, const char* puzzle, char* solution){
+    return sudoku_lib_solve_ctl(size, engine, puzzle, solution, NULL);
+}
+/**
+    Solves a single puzzle under a search control, which can stop it with
+    SUDOKU_E_BUDGET or SUDOKU_E_CANCELLED. The sized kernels don't check it.
+
+    @param {int} size - Number of rows, as for sudoku_lib_solve.
+    @param {su_engine_t} engine - Engine for SUDOKU_SIZE puzzles.
+    @param {char*} puzzle - The puzzle, size*size characters.
+    @param {char*} solution - Buffer of size*size characters, as for sudoku_lib_solve.
+    @param {sudoku_solve_ctl*} ctl - Search control. May be NULL.
+    @return {su_status_t} - SUDOKU_OK if solved. Non-zero otherwise.
+*/
+su_status_t sudoku_lib_solve_ctl(int size, su_engine_t engine, const char* puzzle, char* solution,
+                                 sudoku_solve_ctl* ctl){
+    sudoku_field f;
+    su_status_t ret;
+
+    if(puzzle == NULL || solution == NULL)
+        return SUDOKU_E_BAD_ARG;
+    if((ret = lib_check(size, engine)) != SUDOKU_OK)
+        return ret;
+    return lib_solve(&f, size, engine, puzzle, solution, ctl);
+}
+/**
+    Solves n puzzles in one call. Puzzle i starts at puzzles + i*stride and
+    its solution is written to solutions + i*solution_stride, so newline
+    separated buffers can be used as they are (stride size*size + 1). Bytes
+    between the solutions are left alone.
+
+    @param {int} size - Number of rows, as for sudoku_lib_solve.
+    @param {su_engine_t} engine - Engine for SUDOKU_SIZE puzzles.
+    @param {char*} puzzles - The puzzles.
+    @param {size_t} stride - Distance between puzzles, at least size*size.
+    @param {size_t} n - Number of puzzles.
+    @param {char*} solutions - Buffer for the solutions.
+    @param {size_t} solution_stride - Distance between solutions, at least size*size.
+    @param {su_status_t*} status - Buffer of n statuses, one per puzzle.
+    @return {su_status_t} - SUDOKU_OK if the arguments are valid, in which case
+                            every puzzle has its status. SUDOKU_E_BAD_ARG or
+                            SUDOKU_E_NO_MEMORY otherwise, and nothing is written.
+*/
+su_status_t sudoku_lib_solve_batch(int size, su_engine_t engine,
+                                   const char* puzzles, size_t stride, size_t n,
+                                   char* solutions, size_t solution_stride,
+                                   su_status_t* status){
+    return sudoku_lib_solve_batch_ctl(size, engine, puzzles, stride, n, solutions, solution_stride,
+                                                                                status, NULL);
+}
+/**
+    Solves n puzzles in one call like sudoku_lib_solve_batch, every one under
+    the same search control. Budgets hold for each puzzle on its own.
+
+    @param {sudoku_solve_ctl*} ctl - Search control. May be NULL.
+    @return {su_status_t} - As for sudoku_lib_solve_batch.
+*/
+su_status_t sudoku_lib_solve_batch_ctl(int size, su_engine_t engine,
+                                       const char* puzzles, size_t stride, size_t n,
+                                       char* solutions, size_t solution_stride,
+                                       su_status_t* status, sudoku_solve_ctl* ctl){
+    sudoku_field f; // Reused for every puzzle.
+    su_status_t ret;
+    size_t i;
+
+    if(n == 0)
+        return SUDOKU_OK;
+    if(puzzles == NULL || solutions == NULL || status == NULL)
+        return SUDOKU_E_BAD_ARG;
+    if((ret = lib_check(size, engine)) != SUDOKU_OK)
+        return ret;
+    if(stride < (size_t) (size * size) || solution_stride < (size_t) (size * size))
+        return SUDOKU_E_BAD_ARG;
+    for(i = 0; i < n; i++)
+        status[i] = lib_solve(&f, size, engine, puzzles + i * stride, solutions + i * solution_stride, ctl);
+    return SUDOKU_OK;
+}
@@ -0,0 +1,101 @@
+#ifndef SUDOKU_LIB_H_INCLUDED
+#define SUDOKU_LIB_H_INCLUDED
+
+#include <stddef.h>     // size_t
+
+#include "sudoku_general_tools.h"
+
+/**
+    The embeddable solver library. Every function here works on buffers owned
+    by the caller and reports problems through its return value: nothing is
+    printed, nothing exits, and nothing is allocated except the per-thread
+    matrix of the dlx engine. The functions are reentrant and may be called
+    from any number of threads at once.
+
+    Puzzles and solutions are size*size characters in the format of the sized
+    kernels (see sudoku_kernel.h), without line break or terminating null.
+*/
+
+/**
+    Outcome of a solve.
+*/
+typedef enum su_status_t {
+    SUDOKU_OK = 0,
+    SUDOKU_E_UNSOLVABLE,    // The puzzle has no solution.
+    SUDOKU_E_CONFLICT,      // Two clues share a value in a row, column or box.
+                            // Sized kernels report these as unsolvable.
+    SUDOKU_E_BAD_CHAR,      // A character that is not a value of the size.
+    SUDOKU_E_BAD_ARG,       // Unknown engine or size, or a NULL buffer.
+    SUDOKU_E_NO_MEMORY,
+    SUDOKU_E_BUDGET,        // The search ran out of nodes or time, see sudoku_solve_ctl.
+    SUDOKU_E_CANCELLED,     // The search was stopped through its cancel flag.
+    SUDOKU_STATUS_COUNT     // Number of statuses. Not a status.
+} su_status_t;
+
+/**
+    Gets a short description of a status.
+    @param {su_status_t} status - The status.
+    @return {char*} - The description. "unknown status" if out of range.
+*/
+const char* sudoku_status_string(su_status_t status);
+/**
+    Solves a single puzzle.
+
+    @param {int} size - Number of rows. SUDOKU_SIZE solves with the engine,
+                        other sizes supported by sudoku_size_supported use the
+                        sized kernels.
+    @param {su_engine_t} engine - Engine for SUDOKU_SIZE puzzles.
+    @param {char*} puzzle - The puzzle, size*size characters.
+    @param {char*} solution - Buffer of size*size characters. Filled with the
+                        solution if solved, with '0' otherwise.
+    @return {su_status_t} - SUDOKU_OK if solved. Non-zero otherwise.
+*/
+su_status_t sudoku_lib_solve(int size, su_engine_t engine, const char* puzzle, char* solution);
+/**
+    Solves a single puzzle under a search control, which can stop it with
+    SUDOKU_E_BUDGET or SUDOKU_E_CANCELLED. The sized kernels don't check it.
+
+    @param {int} size - Number of rows, as for sudoku_lib_solve.
+    @param {su_engine_t} engine - Engine for SUDOKU_SIZE puzzles.
+    @param {char*} puzzle - The puzzle, size*size characters.
+    @param {char*} solution - Buffer of size*size characters, as for sudoku_lib_solve.
+    @param {sudoku_solve_ctl*} ctl - Search control. May be NULL.
+    @return {su_status_t} - SUDOKU_OK if solved. Non-zero otherwise.
+*/
+su_status_t sudoku_lib_solve_ctl(int size, su_engine_t engine, const char* puzzle, char* solution,
+                                 sudoku_solve_ctl* ctl);
+/**
+    Solves n puzzles in one call. Puzzle i starts at puzzles + i*stride and
+    its solution is written to solutions + i*solution_stride, so newline
+    separated buffers can be used as they are (stride size*size + 1). Bytes
+    between the solutions are left alone.
+
+    @param {int} size - Number of rows, as for sudoku_lib_solve.
+    @param {su_engine_t} engine - Engine for SUDOKU_SIZE puzzles.
+    @param {char*} puzzles - The puzzles.
+    @param {size_t} stride - Distance between puzzles, at least size*size.
+    @param {size_t} n - Number of puzzles.
+    @param {char*} solutions - Buffer for the solutions.
+    @param {size_t} solution_stride - Distance between solutions, at least size*size.
+    @param {su_status_t*} status - Buffer of n statuses, one per puzzle.
+    @return {su_status_t} - SUDOKU_OK if the arguments are valid, in which case
+                            every puzzle has its status. SUDOKU_E_BAD_ARG or
+                            SUDOKU_E_NO_MEMORY otherwise, and nothing is written.
+*/
+su_status_t sudoku_lib_solve_batch(int size, su_engine_t engine,
+                                   const char* puzzles, size_t stride, size_t n,
+                                   char* solutions, size_t solution_stride,
+                                   su_status_t* status);
+/**
+    Solves n puzzles in one call like sudoku_lib_solve_batch, every one under
+    the same search control. Budgets hold for each puzzle on its own.
+
+    @param {sudoku_solve_ctl*} ctl - Search control. May be NULL.
+    @return {su_status_t} - As for sudoku_lib_solve_batch.
+*/
+su_status_t sudoku_lib_solve_batch_ctl(int size, su_engine_t engine,
+                                       const char* puzzles, size_t stride, size_t n,
+                                       char* solutions, size_t solution_stride,
+                                       su_status_t* status, sudoku_solve_ctl* ctl);
+
+#endif // SUDOKU_LIB_H_INCLUDED
@@ -0,0 +1,360 @@
+// Sudoku packed binary files
+#define _POSIX_C_SOURCE 200809L // getline
+#include <stdio.h>      // For standard IO
+#include <stdlib.h>     // For standard stuff
+#include <string.h>     // memset, memcmp
+#include <fcntl.h>      // fcntl, O_APPEND
+
+#include "sudoku_pack.h"
+
+/**
+    Reading and writing of packed puzzle files, see sudoku_pack.h for the
+    layout.
+*/
+
+// Characters of the cell values, as in the sized kernels.
+static const char pack_chars[] = SUDOKU_VALUE_CHARS;
+
+/**
+    Sets up the header of an empty file of puzzles of a given size.
+    @param {sudoku_pack_header*} h - The header.
+    @param {int} size - Number of rows, at most SUDOKU_MAX_SIZE.
+*/
+void init_sudoku_pack_header(sudoku_pack_header* h, int size){
+    int cells = size * size;
+    h->size = size;
+    h->cell_bits = size <= 15 ? 4 : 5;
+    h->record_bytes = (cells * h->cell_bits + 7) / 8;
+    h->checksum = SUDOKU_PACK_SUM_INIT;
+    h->count = 0;
+}
+/**
+    Stores n bytes of a number, least significant first.
+*/
+static void put_le(unsigned char* buf, uint64_t x, int n){
+    int i;
+    for(i = 0; i < n; i++, x >>= 8)
+        buf[i] = x & 0xFF;
+}
+/**
+    Loads a number of n bytes, least significant first.
+*/
+static uint64_t get_le(const unsigned char* buf, int n){
+    uint64_t x = 0;
+    while(n-- > 0)
+        x = x << 8 | buf[n];
+    return x;
+}
+/**
+    Writes a header in its file layout.
+    @param {sudoku_pack_header*} h - The header.
+    @param {unsigned char*} buf - SUDOKU_PACK_HEADER_BYTES to write to.
+*/
+void encode_sudoku_pack_header(const sudoku_pack_header* h, unsigned char* buf){
+    memset(buf, 0, SUDOKU_PACK_HEADER_BYTES);
+    memcpy(buf, SUDOKU_PACK_MAGIC, 4);
+    buf[4] = SUDOKU_PACK_VERSION;
+    buf[5] = h->size;
+    buf[6] = h->cell_bits;
+    put_le(buf + 8, h->record_bytes, 4);
+    put_le(buf + 12, h->checksum, 4);
+    put_le(buf + 16, h->count, 8);
+}
+/**
+    Reads a header from its file layout.
+    @param {sudoku_pack_header*} h - Filled in with the header.
+    @param {unsigned char*} buf - SUDOKU_PACK_HEADER_BYTES to read.
+    @return {int} - SUDOKU_PACK_OK if successful. SUDOKU_PACK_BAD_HEADER
+                    otherwise.
+*/
+int decode_sudoku_pack_header(sudoku_pack_header* h, const unsigned char* buf){
+    if(memcmp(buf, SUDOKU_PACK_MAGIC, 4) != 0 || buf[4] != SUDOKU_PACK_VERSION
+                    || buf[5] < 1 || buf[5] > SUDOKU_MAX_SIZE)
+        return SUDOKU_PACK_BAD_HEADER;
+    init_sudoku_pack_header(h, buf[5]);
+    // Only the layout this version writes is read.
+    if(buf[6] != h->cell_bits || get_le(buf + 8, 4) != (uint64_t) h->record_bytes)
+        return SUDOKU_PACK_BAD_HEADER;
+    h->checksum = get_le(buf + 12, 4);
+    h->count = get_le(buf + 16, 8);
+    return SUDOKU_PACK_OK;
+}
+/**
+    Adds bytes to an FNV-1a checksum.
+    @param {uint32_t} sum - The checksum so far. SUDOKU_PACK_SUM_INIT to start.
+    @param {unsigned char*} data - Bytes to add.
+    @param {size_t} len - Number of bytes.
+    @return {uint32_t} - The new checksum.
+*/
+uint32_t sudoku_pack_checksum(uint32_t sum, const unsigned char* data, size_t len){
+    size_t i;
+    for(i = 0; i < len; i++)
+        sum = (sum ^ data[i]) * 16777619u;
+    return sum;
+}
+/**
+    Packs a text puzzle, size*size characters in the format of the sized
+    kernels, see sudoku_kernel.h.
+    @param {sudoku_pack_header*} h - Header of the file, for the size.
+    @param {char*} line - The puzzle.
+    @param {unsigned char*} record - Buffer of h->record_bytes.
+    @return {int} - 0 if successful. Non-zero on unknown characters.
+*/
+int sudoku_pack_record(const sudoku_pack_header* h, const char* line, unsigned char* record){
+    int cells = h->size * h->size;
+    int rc, v;
+    char ch;
+    uint32_t bits = 0;  // Cells not yet stored, first cell in the low bits.
+    int n_bits = 0;
+
+    for(rc = 0; rc < cells; rc++){
+        ch = line[rc];
+        if(ch == '0' || ch == '.')
+            v = 0;
+        else if(ch >= '1' && ch <= '9')
+            v = ch - '0';
+        else if(ch >= 'A' && ch <= 'Z')
+            v = ch - 'A' + 10;
+        else
+            return 1;
+        if(v > h->size)
+            return 1;
+        bits |= (uint32_t) v << n_bits;
+        for(n_bits += h->cell_bits; n_bits >= 8; n_bits -= 8, bits >>= 8)
+            *record++ = bits & 0xFF;
+    }
+    if(n_bits > 0)
+        *record = bits;
+    return 0;
+}
+/**
+    Unpacks a record into a text puzzle. Empty cells are written as '0' and
+    cells out of range as '?', which no puzzle reader accepts.
+    @param {sudoku_pack_header*} h - Header of the file, for the size.
+    @param {unsigned char*} record - The record.
+    @param {char*} line - Buffer of size*size characters. Not NUL terminated.
+    @return {int} - SUDOKU_PACK_OK if successful. SUDOKU_PACK_BAD_RECORD if a
+                    cell is out of range.
+*/
+int sudoku_unpack_record(const sudoku_pack_header* h, const unsigned char* record, char* line){
+    int cells = h->size * h->size;
+    int rc, v;
+    int top = 0; // Set if any cell is out of range.
+    uint32_t bits = 0;  // Bytes loaded but not yet unpacked.
+    int n_bits = 0;
+    uint32_t cell_mask = (1u << h->cell_bits) - 1;
+
+    for(rc = 0; rc < cells; rc++){
+        if(n_bits < h->cell_bits){
+            bits |= (uint32_t) *record++ << n_bits;
+            n_bits += 8;
+        }
+        v = bits & cell_mask;
+        bits >>= h->cell_bits;
+        n_bits -= h->cell_bits;
+        top |= v > h->size;
+        line[rc] = v <= h->size ? pack_chars[v] : '?';
+    }
+    return top ? SUDOKU_PACK_BAD_RECORD : SUDOKU_PACK_OK;
+}
+
+// Writing
+
+/**
+    Starts a packed file on a stream by writing its header.
+    @param {sudoku_pack_writer*} w - The writer.
+    @param {FILE*} out - Stream to write to, opened in binary mode.
+    @param {int} size - Number of rows of the puzzles.
+    @return {int} - 0 if successful. Non-zero on write errors.
+*/
+int open_sudoku_pack_writer(sudoku_pack_writer* w, FILE* out, int size){
+    unsigned char buf[SUDOKU_PACK_HEADER_BYTES];
+    int flags = fcntl(fileno(out), F_GETFL);
+
+    w->out = out;
+    init_sudoku_pack_header(&w->header, size);
+    // Appended streams can't have their header rewritten.
+    w->header_pos = flags != -1 && (flags & O_APPEND) ? -1 : ftell(out);
+    w->header.count = SUDOKU_PACK_UNKNOWN_COUNT;
+    encode_sudoku_pack_header(&w->header, buf);
+    w->header.count = 0;
+    return fwrite(buf, 1, sizeof(buf), out) != sizeof(buf);
+}
+/**
+    Packs a text puzzle and writes its record.
+    @param {sudoku_pack_writer*} w - The writer.
+    @param {char*} line - The puzzle, size*size characters.
+    @return {int} - 0 if successful. Non-zero on unknown characters, in which
+                    case nothing is written, or write errors.
+*/
+int sudoku_pack_write(sudoku_pack_writer* w, const char* line){
+    unsigned char record[SUDOKU_PACK_MAX_RECORD];
+
+    if(sudoku_pack_record(&w->header, line, record))
+        return 1;
+    w->header.checksum = sudoku_pack_checksum(w->header.checksum, record, w->header.record_bytes);
+    w->header.count++;
+    return fwrite(record, 1, w->header.record_bytes, w->out) != (size_t) w->header.record_bytes;
+}
+/**
+    Finishes a packed file, writing the count and checksum into its header.
+    The stream is flushed but not closed.
+    @param {sudoku_pack_writer*} w - The writer.
+    @return {int} - 0 if successful. Non-zero on write errors.
+*/
+int close_sudoku_pack_writer(sudoku_pack_writer* w){
+    unsigned char buf[SUDOKU_PACK_HEADER_BYTES];
+
+    if(w->header_pos != -1){
+        encode_sudoku_pack_header(&w->header, buf);
+        if(fseek(w->out, w->header_pos, SEEK_SET) == 0){
+            fwrite(buf, 1, sizeof(buf), w->out);
+            fseek(w->out, 0, SEEK_END);
+        }
+    }
+    return fflush(w->out) || ferror(w->out);
+}
+
+// Reading
+
+/**
+    Starts reading a packed file by reading its header.
+    @param {sudoku_pack_reader*} r - The reader.
+    @param {FILE*} in - Stream to read from, at the start of the header.
+    @return {int} - SUDOKU_PACK_OK if successful. Non-zero otherwise.
+*/
+int open_sudoku_pack_reader(sudoku_pack_reader* r, FILE* in){
+    unsigned char buf[SUDOKU_PACK_HEADER_BYTES];
+
+    memset(r, 0, sizeof(*r));
+    r->in = in;
+    r->checksum = SUDOKU_PACK_SUM_INIT;
+    r->in_order = 1;
+    if(fread(buf, 1, sizeof(buf), in) != sizeof(buf))
+        return ferror(in) ? SUDOKU_PACK_IO_ERROR : SUDOKU_PACK_BAD_HEADER;
+    if(decode_sudoku_pack_header(&r->header, buf))
+        return SUDOKU_PACK_BAD_HEADER;
+    r->data_pos = ftell(in);
+    return SUDOKU_PACK_OK;
+}
+/**
+    Reads the next record as a text puzzle.
+    @param {sudoku_pack_reader*} r - The reader.
+    @param {char*} line - Buffer of size*size characters. Not NUL terminated.
+    @return {int} - SUDOKU_PACK_OK if successful, SUDOKU_PACK_END after the
+                    last record. Other SUDOKU_PACK_ values on errors.
+*/
+int sudoku_pack_read(sudoku_pack_reader* r, char* line){
+    unsigned char record[SUDOKU_PACK_MAX_RECORD];
+    size_t n;
+
+    if(r->header.count != SUDOKU_PACK_UNKNOWN_COUNT && r->next >= r->header.count)
+        return SUDOKU_PACK_END;
+    n = fread(record, 1, r->header.record_bytes, r->in);
+    if(n == 0 && !ferror(r->in) && r->header.count == SUDOKU_PACK_UNKNOWN_COUNT)
+        return SUDOKU_PACK_END;
+    if(n != (size_t) r->header.record_bytes)
+        return SUDOKU_PACK_IO_ERROR; // Including files cut short.
+    r->checksum = sudoku_pack_checksum(r->checksum, record, n);
+    r->next++;
+    return sudoku_unpack_record(&r->header, record, line);
+}
+/**
+    Reads the record with a given index as a text puzzle. The stream must be
+    seekable. Reading in order continues after the record read.
+    @param {sudoku_pack_reader*} r - The reader.
+    @param {uint64_t} index - Index of the record, from 0.
+    @param {char*} line - Buffer of size*size characters. Not NUL terminated.
+    @return {int} - SUDOKU_PACK_OK if successful, SUDOKU_PACK_END if there is
+                    no such record. Other SUDOKU_PACK_ values on errors.
+*/
+int sudoku_pack_read_at(sudoku_pack_reader* r, uint64_t index, char* line){
+    if(r->data_pos == -1)
+        return SUDOKU_PACK_IO_ERROR;
+    if(r->header.count != SUDOKU_PACK_UNKNOWN_COUNT && index >= r->header.count)
+        return SUDOKU_PACK_END;
+    if(fseek(r->in, r->data_pos + (long) index * r->header.record_bytes, SEEK_SET))
+        return SUDOKU_PACK_IO_ERROR;
+    r->in_order = 0;
+    r->next = index;
+    return sudoku_pack_read(r, line);
+}
+/**
+    Checks, after every record was read in order, that the checksum matches.
+    @param {sudoku_pack_reader*} r - The reader.
+    @return {int} - SUDOKU_PACK_OK if the checksum matches or is not known.
+                    SUDOKU_PACK_BAD_SUM otherwise.
+*/
+int sudoku_pack_check(const sudoku_pack_reader* r){
+    if(!r->in_order || r->header.count == SUDOKU_PACK_UNKNOWN_COUNT)
+        return SUDOKU_PACK_OK;
+    return r->checksum == r->header.checksum ? SUDOKU_PACK_OK : SUDOKU_PACK_BAD_SUM;
+}
+
+// Converters
+
+/**
+    Converts a text file of puzzles, one per line, to a packed file. Empty
+    lines are skipped and lines that can't be packed are reported on stderr
+    and skipped.
+    @param {FILE*} in - Stream of text puzzles.
+    @param {FILE*} out - Stream to write the packed file to.
+    @param {int} size - Number of rows of the puzzles.
+    @param {long*} skipped - Set to the number of lines skipped.
+    @return {int} - 0 if successful. Non-zero on read or write errors.
+*/
+int sudoku_pack_text(FILE* in, FILE* out, int size, long* skipped){
+    sudoku_pack_writer w;
+    char* line = NULL;
+    size_t cap = 0;
+    ssize_t len;
+    long line_nbr = 0;
+    int ret;
+
+    *skipped = 0;
+    if(open_sudoku_pack_writer(&w, out, size))
+        return 1;
+    while((len = getline(&line, &cap, in)) != -1){
+        line_nbr++;
+        while(len > 0 && (line[len - 1] == '\n' || line[len - 1] == '\r'))
+            len--;
+        if(len == 0)
+            continue;
+        if(len != size * size){
+            fprintf(stderr, "Line %ld: expected %d characters, got %ld.\n", line_nbr, size * size, (long) len);
+            (*skipped)++;
+        }else if(sudoku_pack_write(&w, line)){
+            if(ferror(out))
+                break;
+            fprintf(stderr, "Line %ld: unknown character.\n", line_nbr);
+            (*skipped)++;
+        }
+    }
+    free(line);
+    ret = close_sudoku_pack_writer(&w);
+    return ret || ferror(in);
+}
+/**
+    Converts a packed file to text, one puzzle per line.
+    @param {FILE*} in - Stream of the packed file.
+    @param {FILE*} out - Stream to write the puzzles to.
+    @return {int} - SUDOKU_PACK_OK if successful. Non-zero otherwise.
+*/
+int sudoku_unpack_text(FILE* in, FILE* out){
+    sudoku_pack_reader r;
+    char line[SUDOKU_MAX_SIZE * SUDOKU_MAX_SIZE + 1];
+    int cells;
+    int ret = open_sudoku_pack_reader(&r, in);
+
+    if(ret != SUDOKU_PACK_OK)
+        return ret;
+    cells = r.header.size * r.header.size;
+    line[cells] = '\n';
+    while((ret = sudoku_pack_read(&r, line)) == SUDOKU_PACK_OK)
+        fwrite(line, 1, cells + 1, out);
+    if(ret != SUDOKU_PACK_END)
+        return ret;
+    if(fflush(out) || ferror(out))
+        return SUDOKU_PACK_IO_ERROR;
+    return sudoku_pack_check(&r);
+}
@@ -0,0 +1,212 @@
+#ifndef SUDOKU_PACK_H_INCLUDED
+#define SUDOKU_PACK_H_INCLUDED
+
+#include <stdio.h>      // FILE
+#include <stdint.h>     // uint32_t, uint64_t
+
+#include "sudoku_kernel.h"
+
+/**
+    Packed binary puzzle files. A file is a header of SUDOKU_PACK_HEADER_BYTES
+    followed by one record per puzzle (or solution). Every record has the same
+    length, so record i starts at SUDOKU_PACK_HEADER_BYTES + i * record_bytes
+    and can be read without reading the records before it.
+
+    A record holds the cells row by row, each cell the value 1..size or 0 for
+    an empty cell. Sizes up to 15 use 4 bits per cell and larger sizes 5 bits.
+    The cells are stored as one little-endian bit string, the first cell in
+    the lowest bits of the first byte, so a 9x9 record is 41 bytes instead of
+    the 82 of a text line and a 16x16 record 160 bytes instead of 257.
+
+    Header, all numbers little-endian:
+        0   magic, the 4 bytes of SUDOKU_PACK_MAGIC
+        4   version, 1 byte
+        5   size, 1 byte
+        6   bits per cell, 1 byte
+        7   reserved, 0
+        8   record_bytes, 4 bytes
+        12  checksum, 4 bytes. FNV-1a of every record byte.
+        16  count, 8 bytes. Number of records. SUDOKU_PACK_UNKNOWN_COUNT if the
+            file was written to a stream that could not be rewound, in which
+            case the checksum is not set either.
+        24  reserved, 0
+*/
+
+#define SUDOKU_PACK_MAGIC           "\x89SPK" // Not a puzzle character, so text
+                                              // and packed input can be told apart.
+#define SUDOKU_PACK_VERSION         (1)
+#define SUDOKU_PACK_HEADER_BYTES    (32)
+#define SUDOKU_PACK_UNKNOWN_COUNT   (UINT64_MAX)
+// Longest record, 5 bits per cell of the largest size.
+#define SUDOKU_PACK_MAX_RECORD      ((SUDOKU_MAX_SIZE * SUDOKU_MAX_SIZE * 5 + 7) / 8)
+
+// Return values of the reading functions.
+#define SUDOKU_PACK_OK          (0)
+#define SUDOKU_PACK_END         (1) // No more records.
+#define SUDOKU_PACK_BAD_HEADER  (2) // Not a packed file, or an unsupported one.
+#define SUDOKU_PACK_BAD_RECORD  (3) // A cell value larger than the size.
+#define SUDOKU_PACK_BAD_SUM     (4) // The checksum does not match the records.
+#define SUDOKU_PACK_IO_ERROR    (5)
+
+/**
+    The contents of a header.
+*/
+typedef struct sudoku_pack_header sudoku_pack_header;
+struct sudoku_pack_header {
+    int size;
+    int cell_bits;
+    int record_bytes;
+    uint32_t checksum;
+    uint64_t count;
+};
+
+/**
+    Sets up the header of an empty file of puzzles of a given size.
+    @param {sudoku_pack_header*} h - The header.
+    @param {int} size - Number of rows, at most SUDOKU_MAX_SIZE.
+*/
+void init_sudoku_pack_header(sudoku_pack_header* h, int size);
+/**
+    Writes a header in its file layout.
+    @param {sudoku_pack_header*} h - The header.
+    @param {unsigned char*} buf - SUDOKU_PACK_HEADER_BYTES to write to.
+*/
+void encode_sudoku_pack_header(const sudoku_pack_header* h, unsigned char* buf);
+/**
+    Reads a header from its file layout.
+    @param {sudoku_pack_header*} h - Filled in with the header.
+    @param {unsigned char*} buf - SUDOKU_PACK_HEADER_BYTES to read.
+    @return {int} - SUDOKU_PACK_OK if successful. SUDOKU_PACK_BAD_HEADER
+                    otherwise.
+*/
+int decode_sudoku_pack_header(sudoku_pack_header* h, const unsigned char* buf);
+// Starting value of a checksum.
+#define SUDOKU_PACK_SUM_INIT (2166136261u)
+/**
+    Adds bytes to an FNV-1a checksum.
+    @param {uint32_t} sum - The checksum so far. SUDOKU_PACK_SUM_INIT to start.
+    @param {unsigned char*} data - Bytes to add.
+    @param {size_t} len - Number of bytes.
+    @return {uint32_t} - The new checksum.
+*/
+uint32_t sudoku_pack_checksum(uint32_t sum, const unsigned char* data, size_t len);
+/**
+    Packs a text puzzle, size*size characters in the format of the sized
+    kernels, see sudoku_kernel.h.
+    @param {sudoku_pack_header*} h - Header of the file, for the size.
+    @param {char*} line - The puzzle.
+    @param {unsigned char*} record - Buffer of h->record_bytes.
+    @return {int} - 0 if successful. Non-zero on unknown characters.
+*/
+int sudoku_pack_record(const sudoku_pack_header* h, const char* line, unsigned char* record);
+/**
+    Unpacks a record into a text puzzle. Empty cells are written as '0' and
+    cells out of range as '?', which no puzzle reader accepts.
+    @param {sudoku_pack_header*} h - Header of the file, for the size.
+    @param {unsigned char*} record - The record.
+    @param {char*} line - Buffer of size*size characters. Not NUL terminated.
+    @return {int} - SUDOKU_PACK_OK if successful. SUDOKU_PACK_BAD_RECORD if a
+                    cell is out of range.
+*/
+int sudoku_unpack_record(const sudoku_pack_header* h, const unsigned char* record, char* line);
+
+/**
+    Writes records to a stream. The header is written first with an unknown
+    count and rewritten with the real count and checksum when closing, if the
+    stream can be rewound.
+*/
+typedef struct sudoku_pack_writer sudoku_pack_writer;
+struct sudoku_pack_writer {
+    FILE* out;
+    sudoku_pack_header header;
+    long header_pos;    // Position of the header in out. -1 if not seekable.
+};
+/**
+    Starts a packed file on a stream by writing its header.
+    @param {sudoku_pack_writer*} w - The writer.
+    @param {FILE*} out - Stream to write to, opened in binary mode.
+    @param {int} size - Number of rows of the puzzles.
+    @return {int} - 0 if successful. Non-zero on write errors.
+*/
+int open_sudoku_pack_writer(sudoku_pack_writer* w, FILE* out, int size);
+/**
+    Packs a text puzzle and writes its record.
+    @param {sudoku_pack_writer*} w - The writer.
+    @param {char*} line - The puzzle, size*size characters.
+    @return {int} - 0 if successful. Non-zero on unknown characters, in which
+                    case nothing is written, or write errors.
+*/
+int sudoku_pack_write(sudoku_pack_writer* w, const char* line);
+/**
+    Finishes a packed file, writing the count and checksum into its header.
+    The stream is flushed but not closed.
+    @param {sudoku_pack_writer*} w - The writer.
+    @return {int} - 0 if successful. Non-zero on write errors.
+*/
+int close_sudoku_pack_writer(sudoku_pack_writer* w);
+
+/**
+    Reads records from a stream, in order or by index.
+*/
+typedef struct sudoku_pack_reader sudoku_pack_reader;
+struct sudoku_pack_reader {
+    FILE* in;
+    sudoku_pack_header header;
+    long data_pos;      // Position of record 0 in in. -1 if not seekable.
+    uint64_t next;      // Index of the record sudoku_pack_read reads next.
+    uint32_t checksum;  // Of the records read in order so far.
+    int in_order;       // 0 once sudoku_pack_read_at was used.
+};
+/**
+    Starts reading a packed file by reading its header.
+    @param {sudoku_pack_reader*} r - The reader.
+    @param {FILE*} in - Stream to read from, at the start of the header.
+    @return {int} - SUDOKU_PACK_OK if successful. Non-zero otherwise.
+*/
+int open_sudoku_pack_reader(sudoku_pack_reader* r, FILE* in);
+/**
+    Reads the next record as a text puzzle.
+    @param {sudoku_pack_reader*} r - The reader.
+    @param {char*} line - Buffer of size*size characters. Not NUL terminated.
+    @return {int} - SUDOKU_PACK_OK if successful, SUDOKU_PACK_END after the
+                    last record. Other SUDOKU_PACK_ values on errors.
+*/
+int sudoku_pack_read(sudoku_pack_reader* r, char* line);
+/**
+    Reads the record with a given index as a text puzzle. The stream must be
+    seekable. Reading in order continues after the record read.
+    @param {sudoku_pack_reader*} r - The reader.
+    @param {uint64_t} index - Index of the record, from 0.
+    @param {char*} line - Buffer of size*size characters. Not NUL terminated.
+    @return {int} - SUDOKU_PACK_OK if successful, SUDOKU_PACK_END if there is
+                    no such record. Other SUDOKU_PACK_ values on errors.
+*/
+int sudoku_pack_read_at(sudoku_pack_reader* r, uint64_t index, char* line);
+/**
+    Checks, after every record was read in order, that the checksum matches.
+    @param {sudoku_pack_reader*} r - The reader.
+    @return {int} - SUDOKU_PACK_OK if the checksum matches or is not known.
+                    SUDOKU_PACK_BAD_SUM otherwise.
+*/
+int sudoku_pack_check(const sudoku_pack_reader* r);
+
+/**
+    Converts a text file of puzzles, one per line, to a packed file. Empty
+    lines are skipped and lines that can't be packed are reported on stderr
+    and skipped.
+    @param {FILE*} in - Stream of text puzzles.
+    @param {FILE*} out - Stream to write the packed file to.
+    @param {int} size - Number of rows of the puzzles.
+    @param {long*} skipped - Set to the number of lines skipped.
+    @return {int} - 0 if successful. Non-zero on read or write errors.
+*/
+int sudoku_pack_text(FILE* in, FILE* out, int size, long* skipped);
+/**
+    Converts a packed file to text, one puzzle per line.
+    @param {FILE*} in - Stream of the packed file.
+    @param {FILE*} out - Stream to write the puzzles to.
+    @return {int} - SUDOKU_PACK_OK if successful. Non-zero otherwise.
+*/
+int sudoku_unpack_text(FILE* in, FILE* out);
+
+#endif // SUDOKU_PACK_H_INCLUDED
@@ -0,0 +1,370 @@
+// Parallel solving of a single sudoku
+#include <stdio.h>      // For standard IO
+#include <stdlib.h>     // For standard stuff
+#include <string.h>     // memcpy
+#include <time.h>       // clock_gettime
+#include <stdatomic.h>  // Shared subtree index and cancellation
+#include <pthread.h>    // Solver threads
+
+#include "sudoku_general_tools.h"
+#include "sudoku_cache.h"
+#include "sudoku_parallel.h"
+
+/**
+    Splitting of the search tree of one sudoku over several threads.
+*/
+
+// Subtrees to aim for per thread. More subtrees balance the load better.
+#define SUBTREES_PER_THREAD (16)
+
+/**
+    State shared by the threads solving one sudoku.
+*/
+typedef struct parallel_search parallel_search;
+struct parallel_search {
+    sudoku_field* subtrees;     // Partially filled copies of the input field.
+    int n_subtrees;
+    atomic_int next;            // Index of the next subtree to hand out.
+    atomic_int cancel;          // Set once a solution is found.
+    sudoku_field* solution;     // The subtree that was solved first.
+    su_engine_t engine;
+};
+
+/**
+    Expands the frontier breadth first until it holds at least target subtrees
+    or can't be expanded further. Singles are propagated in every subtree
+    before it is split on its cell with the fewest candidates. Subtrees found
+    to be dead ends are dropped.
+
+    @return {int} - Number of subtrees in the frontier, or -1 if a subtree was
+                    solved by propagation alone, in which case it is stored in
+                    frontier[0].
+*/
+static int expand_frontier(sudoku_field** frontier, int n, int target){
+    sudoku_field* next;
+    sudoku_candidates c;
+    su_cell_t candidates, nbr;
+    int n_next, i, rc, count, best_rc, best_count;
+
+    while(n > 0 && n < target){
+        next = malloc(n * SUDOKU_SIZE * sizeof(sudoku_field));
+        if(next == NULL){
+            fprintf(stderr, "Could not allocate memory for the subtrees, %d", __LINE__);
+            exit(1);
+        }
+        n_next = 0;
+        for(i = 0; i < n; i++){
+            init_sudoku_candidates(*frontier + i, &c);
+            if(propagate_sudoku_candidates(*frontier + i, &c))
+                continue;
+            best_rc = SUDOKU_NO_EMPTY_CELL;
+            best_count = SUDOKU_SIZE + 1;
+            for(rc = 0; rc < SUDOKU_CELLS; rc++){
+                count = count_candidates(c.cell[rc]);
+                if(c.cell[rc] && count < best_count){
+                    best_rc = rc;
+                    best_count = count;
+                }
+            }
+            if(best_rc == SUDOKU_NO_EMPTY_CELL){ // Solved while splitting.
+                (*frontier)[0] = (*frontier)[i];
+                free(next);
+                return -1;
+            }
+            candidates = c.cell[best_rc];
+            while(candidates){
+                nbr = candidates & (~candidates + 1);
+                candidates ^= nbr;
+                next[n_next] = (*frontier)[i];
+                set_cell_lin(next + n_next++, best_rc, nbr);
+            }
+        }
+        free(*frontier);
+        *frontier = next;
+        n = n_next;
+    }
+    return n;
+}
+/**
+    Solver thread. Takes subtrees until they run out or a solution is found.
+*/
+static void* parallel_worker_main(void* arg){
+    parallel_search* search = arg;
+    sudoku_solve_ctl ctl;
+    sudoku_field local; // Solved on the thread's own stack, away from the other subtrees.
+    int i;
+
+    init_sudoku_solve_ctl(&ctl);
+    ctl.cancel = &search->cancel;
+    while(!atomic_load(&search->cancel)){
+        i = atomic_fetch_add(&search->next, 1);
+        if(i >= search->n_subtrees)
+            break;
+        local = search->subtrees[i];
+        if(sudoku_solve_engine_ctl(&local, search->engine, &ctl) != NULL){
+            if(atomic_exchange(&search->cancel, 1) == 0){
+                search->subtrees[i] = local;
+                search->solution = search->subtrees + i;
+            }
+            break;
+        }
+    }
+    return NULL;
+}
+
+/**
+    Solves a single sudoku on several threads. The top levels of the search
+    tree are expanded into a list of subtrees (with singles propagated at
+    every split), and the threads take subtrees from the list until one of
+    them finds a solution, at which point the others are cancelled.
+    The field is left unchanged if no solution exists.
+
+    @param {sudoku_field*} f - Input sudoku to solve.
+    @param {su_engine_t} engine - The engine used on every subtree.
+    @param {int} n_threads - Number of solver threads.
+    @return {sudoku_field*} - The input field (solved) if successful. NULL otherwise.
+*/
+sudoku_field* sudoku_solve_parallel(sudoku_field* f, su_engine_t engine, int n_threads){
+    parallel_search search;
+    pthread_t* threads;
+    sudoku_field* frontier;
+    sudoku_field* ret = NULL;
+    int n, t;
+
+    frontier = malloc(sizeof(sudoku_field));
+    threads = malloc(n_threads * sizeof(pthread_t));
+    if(frontier == NULL || threads == NULL){
+        fprintf(stderr, "Could not allocate memory for the parallel search, %d", __LINE__);
+        exit(1);
+    }
+    frontier[0] = *f;
+    n = expand_frontier(&frontier, 1, n_threads * SUBTREES_PER_THREAD);
+    if(n == -1){
+        *f = frontier[0];
+        free(frontier);
+        free(threads);
+        return f;
+    }
+
+    search.subtrees = frontier;
+    search.n_subtrees = n;
+    search.solution = NULL;
+    search.engine = engine;
+    atomic_init(&search.next, 0);
+    atomic_init(&search.cancel, 0);
+    for(t = 0; t < n_threads; t++){
+        if(pthread_create(threads + t, NULL, parallel_worker_main, &search)){
+            fprintf(stderr, "Could not start solver thread, %d", __LINE__);
+            exit(1);
+        }
+    }
+    for(t = 0; t < n_threads; t++)
+        pthread_join(threads[t], NULL);
+
+    if(search.solution != NULL){
+        *f = *search.solution;
+        ret = f;
+    }
+    free(frontier);
+    free(threads);
+    return ret;
+}
+
+// Portfolio
+
+/**
+    State shared by the racers of one sudoku.
+*/
+typedef struct portfolio_race portfolio_race;
+struct portfolio_race {
+    const sudoku_racer* racers;
+    const sudoku_solve_ctl* limits; // Budgets of every racer. May be NULL.
+    char puzzle[SUDOKU_CELLS];
+    atomic_int cancel;          // Set once the race is decided.
+    pthread_mutex_t lock;       // Protects the rest.
+    pthread_cond_t done;
+    int running;                // Racers still searching.
+    int status;                 // SUDOKU_SOLVE_ outcome, -1 until decided.
+    int winner;
+    long long nodes;
+    sudoku_field solution;
+};
+/**
+    A racer's thread.
+*/
+typedef struct portfolio_runner portfolio_runner;
+struct portfolio_runner {
+    pthread_t thread;
+    portfolio_race* race;
+    int id;
+};
+
+/**
+    Racer thread. Solves its version of the puzzle and reports the outcome.
+*/
+static void* portfolio_runner_main(void* arg){
+    portfolio_runner* runner = arg;
+    portfolio_race* race = runner->race;
+    const sudoku_racer* racer = race->racers + runner->id;
+    sudoku_transform t;
+    sudoku_solve_ctl ctl;
+    sudoku_field local;
+    char line[SUDOKU_CELLS], back[SUDOKU_CELLS];
+    int status;
+
+    init_sudoku_solve_ctl(&ctl);
+    if(race->limits != NULL){
+        ctl.max_nodes = race->limits->max_nodes;
+        ctl.max_seconds = race->limits->max_seconds;
+        ctl.deadline = race->limits->deadline;
+    }
+    ctl.cancel = &race->cancel;
+    if(racer->seed){
+        sudoku_transform_random(&t, racer->seed);
+        sudoku_transform_apply(&t, race->puzzle, line);
+    }else{
+        memcpy(line, race->puzzle, SUDOKU_CELLS);
+    }
+    // A transform keeps the clues apart, so only an unsolvable puzzle clashes.
+    status = sudoku_read_line(&local, line) == SUDOKU_LINE_OK
+                ? sudoku_solve_status(&local, racer->engine, &ctl) : SUDOKU_SOLVE_UNSOLVABLE;
+    if(status == SUDOKU_SOLVE_SOLVED && racer->seed){
+        sudoku_write_line(&local, line);
+        sudoku_transform_back(&t, line, back);
+        sudoku_read_line(&local, back);
+    }
+
+    pthread_mutex_lock(&race->lock);
+    race->nodes += ctl.nodes;
+    // Solved and unsolvable both settle the race, stopped searches don't.
+    if(race->status == -1 && (status == SUDOKU_SOLVE_SOLVED || status == SUDOKU_SOLVE_UNSOLVABLE)){
+        race->status = status;
+        race->winner = runner->id;
+        if(status == SUDOKU_SOLVE_SOLVED)
+            race->solution = local;
+        atomic_store(&race->cancel, 1);
+    }
+    race->running--;
+    pthread_cond_signal(&race->done);
+    pthread_mutex_unlock(&race->lock);
+    return NULL;
+}
+/**
+    Fills a portfolio: every engine on the puzzle as given, then the engines
+    in turn on randomly transformed puzzles.
+
+    @param {sudoku_racer*} racers - Buffer of n racers.
+    @param {int} n - Number of racers.
+    @param {su_engine_t*} engines - The engines to use. NULL for a default
+                                    mix of prop, dlx, simd and mrv.
+    @param {int} n_engines - Length of engines.
+    @param {uint64_t} seed - Seed of the transforms.
+*/
+void            sudoku_fill_portfolio(sudoku_racer* racers, int n, const su_engine_t* engines, int n_engines,
+                                                                                    uint64_t seed){
+    static const su_engine_t mix[] = {SUDOKU_ENGINE_PROP, SUDOKU_ENGINE_DLX,
+                                      SUDOKU_ENGINE_SIMD, SUDOKU_ENGINE_MRV};
+    int i;
+
+    if(engines == NULL || n_engines <= 0){
+        engines = mix;
+        n_engines = sizeof(mix) / sizeof(mix[0]);
+    }
+    for(i = 0; i < n; i++){
+        racers[i].engine = engines[i % n_engines];
+        // Different nonzero seeds per racer, 0 for the first round.
+        racers[i].seed = i < n_engines ? 0 : seed * 0x9E3779B97F4A7C15ULL + (uint64_t) i;
+        if(i >= n_engines && racers[i].seed == 0)
+            racers[i].seed = i;
+    }
+}
+/**
+    Solves a single sudoku by racing several solvers against each other, one
+    thread each. The first to solve the puzzle, or to prove it has no
+    solution, wins and the others are cancelled, so the time taken is that
+    of the best solver for the puzzle. The budgets of ctl hold for every
+    racer and its cancel flag stops the whole race. The field is left
+    unchanged unless solved.
+
+    @param {sudoku_field*} f - Input sudoku to solve.
+    @param {sudoku_racer*} racers - The solvers.
+    @param {int} n - Number of racers, 1..SUDOKU_PORTFOLIO_MAX.
+    @param {sudoku_solve_ctl*} ctl - Search control. May be NULL. Its nodes
+                                     are set to those of every racer together.
+    @param {int*} winner - Set to the index of the winning racer, -1 if none.
+                           May be NULL.
+    @return {int} - A SUDOKU_SOLVE_ outcome.
+*/
+int             sudoku_solve_portfolio(sudoku_field* f, const sudoku_racer* racers, int n,
+                                                sudoku_solve_ctl* ctl, int* winner){
+    portfolio_runner runners[SUDOKU_PORTFOLIO_MAX];
+    portfolio_race race;
+    struct timespec until;
+    int i, status, started = 0;
+
+    if(n < 1)
+        n = 1;
+    if(n > SUDOKU_PORTFOLIO_MAX)
+        n = SUDOKU_PORTFOLIO_MAX;
+    race.racers = racers;
+    race.limits = ctl;
+    sudoku_write_line(f, race.puzzle);
+    atomic_init(&race.cancel, 0);
+    pthread_mutex_init(&race.lock, NULL);
+    pthread_cond_init(&race.done, NULL);
+    race.running = 0;
+    race.status = -1;
+    race.winner = -1;
+    race.nodes = 0;
+
+    pthread_mutex_lock(&race.lock);
+    for(i = 0; i < n; i++){
+        runners[i].race = &race;
+        runners[i].id = i;
+        if(pthread_create(&runners[i].thread, NULL, portfolio_runner_main, runners + i)){
+            fprintf(stderr,"Could not create a portfolio thread, %d", __LINE__);
+            exit(1);
+        }
+        race.running++;
+        started++;
+    }
+    // Wait for a winner or every racer stopped. The caller's cancel flag is
+    // polled and passed on to the racers.
+    while(race.status == -1 && race.running > 0){
+        if(ctl != NULL && ctl->cancel != NULL){
+            if(atomic_load(ctl->cancel)){
+                atomic_store(&race.cancel, 1);
+                pthread_cond_wait(&race.done, &race.lock);
+                continue;
+            }
+            clock_gettime(CLOCK_REALTIME, &until);
+            until.tv_nsec += 1000000;
+            if(until.tv_nsec >= 1000000000){
+                until.tv_sec++;
+                until.tv_nsec -= 1000000000;
+            }
+            pthread_cond_timedwait(&race.done, &race.lock, &until);
+        }else{
+            pthread_cond_wait(&race.done, &race.lock);
+        }
+    }
+    pthread_mutex_unlock(&race.lock);
+    for(i = 0; i < started; i++)
+        pthread_join(runners[i].thread, NULL);
+
+    status = race.status;
+    if(status == -1)
+        status = ctl != NULL && ctl->cancel != NULL && atomic_load(ctl->cancel)
+                    ? SUDOKU_SOLVE_CANCELLED : SUDOKU_SOLVE_BUDGET;
+    if(status == SUDOKU_SOLVE_SOLVED)
+        *f = race.solution;
+    if(ctl != NULL){
+        ctl->nodes = race.nodes;
+        ctl->stopped = status == SUDOKU_SOLVE_BUDGET || status == SUDOKU_SOLVE_CANCELLED ? status : 0;
+    }
+    if(winner != NULL)
+        *winner = race.winner;
+    pthread_cond_destroy(&race.done);
+    pthread_mutex_destroy(&race.lock);
+    return status;
+}
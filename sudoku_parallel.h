@@ -0,0 +1,69 @@
+#ifndef SUDOKU_PARALLEL_H_INCLUDED
+#define SUDOKU_PARALLEL_H_INCLUDED
+
+#include <stdint.h>     // uint64_t
+
+#include "sudoku_general_tools.h"
+
+/**
+    Solves a single sudoku on several threads. The top levels of the search
+    tree are expanded into a list of subtrees (with singles propagated at
+    every split), and the threads take subtrees from the list until one of
+    them finds a solution, at which point the others are cancelled.
+    The field is left unchanged if no solution exists.
+
+    @param {sudoku_field*} f - Input sudoku to solve.
+    @param {su_engine_t} engine - The engine used on every subtree.
+    @param {int} n_threads - Number of solver threads.
+    @return {sudoku_field*} - The input field (solved) if successful. NULL otherwise.
+*/
+sudoku_field* sudoku_solve_parallel(sudoku_field* f, su_engine_t engine, int n_threads);
+
+// Most racers of a portfolio.
+#define SUDOKU_PORTFOLIO_MAX (64)
+
+/**
+    One solver of a portfolio: an engine and the puzzle it runs on.
+*/
+typedef struct sudoku_racer sudoku_racer;
+struct sudoku_racer {
+    su_engine_t engine;
+    uint64_t seed;      // 0 solves the puzzle as given. Otherwise the puzzle
+                        // is moved by sudoku_transform_random first, which
+                        // gives the search another cell and value order.
+};
+
+/**
+    Fills a portfolio: every engine on the puzzle as given, then the engines
+    in turn on randomly transformed puzzles.
+
+    @param {sudoku_racer*} racers - Buffer of n racers.
+    @param {int} n - Number of racers.
+    @param {su_engine_t*} engines - The engines to use. NULL for a default
+                                    mix of prop, dlx, simd and mrv.
+    @param {int} n_engines - Length of engines.
+    @param {uint64_t} seed - Seed of the transforms.
+*/
+void sudoku_fill_portfolio(sudoku_racer* racers, int n, const su_engine_t* engines, int n_engines,
+                                                                                    uint64_t seed);
+/**
+    Solves a single sudoku by racing several solvers against each other, one
+    thread each. The first to solve the puzzle, or to prove it has no
+    solution, wins and the others are cancelled, so the time taken is that
+    of the best solver for the puzzle. The budgets of ctl hold for every
+    racer and its cancel flag stops the whole race. The field is left
+    unchanged unless solved.
+
+    @param {sudoku_field*} f - Input sudoku to solve.
+    @param {sudoku_racer*} racers - The solvers.
+    @param {int} n - Number of racers, 1..SUDOKU_PORTFOLIO_MAX.
+    @param {sudoku_solve_ctl*} ctl - Search control. May be NULL. Its nodes
+                                     are set to those of every racer together.
+    @param {int*} winner - Set to the index of the winning racer, -1 if none.
+                           May be NULL.
+    @return {int} - A SUDOKU_SOLVE_ outcome.
+*/
+int sudoku_solve_portfolio(sudoku_field* f, const sudoku_racer* racers, int n,
+                                                sudoku_solve_ctl* ctl, int* winner);
+
+#endif // SUDOKU_PARALLEL_H_INCLUDED
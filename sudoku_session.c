@@ -0,0 +1,223 @@
+// Sudoku incremental play
+#include "sudoku_general_tools.h"
+#include "sudoku_session.h"
+
+/**
+    Sessions for checking a board after every move, see sudoku_session.h.
+*/
+
+/**
+    Gets cell i of a unit: rows first, then columns, then boxes.
+*/
+static int session_cell(int unit, int i){
+    int b;
+    if(unit < SUDOKU_SIZE)
+        return unit * SUDOKU_SIZE + i;
+    if(unit < 2 * SUDOKU_SIZE)
+        return i * SUDOKU_SIZE + unit - SUDOKU_SIZE;
+    b = unit - 2 * SUDOKU_SIZE;
+    return (b / SUDOKU_BOX_WIDTH * SUDOKU_BOX_WIDTH + i / SUDOKU_BOX_WIDTH) * SUDOKU_SIZE
+            + b % SUDOKU_BOX_WIDTH * SUDOKU_BOX_WIDTH + i % SUDOKU_BOX_WIDTH;
+}
+/**
+    Gets the units of a cell, numbered as in session_cell.
+*/
+static void session_units(int rc, int* units){
+    units[0] = rc_to_r(rc);
+    units[1] = SUDOKU_SIZE + rc_to_c(rc);
+    units[2] = 2 * SUDOKU_SIZE + rc_to_b(rc);
+}
+/**
+    Removes a value placed in a cell from the candidates of its peers.
+    @return {int} - Non-zero if an empty peer has no candidates left.
+*/
+static int session_remove(sudoku_session* s, int rc, su_cell_t nbr){
+    int units[3], i, k, peer;
+    int dead = 0;
+
+    s->candidates[rc] = ZERO;
+    session_units(rc, units);
+    for(k = 0; k < 3; k++)
+        for(i = 0; i < SUDOKU_SIZE; i++){
+            peer = session_cell(units[k], i);
+            s->candidates[peer] &= (su_cell_t) ~nbr;
+            dead |= s->candidates[peer] == ZERO && get_cell_lin(&s->board, peer) == ZERO;
+        }
+    return dead;
+}
+/**
+    Sets the candidates of a cell and its peers again from the board, after
+    a value was taken out of the cell.
+*/
+static void session_refresh(sudoku_session* s, int rc){
+    int units[3], i, k, peer;
+
+    session_units(rc, units);
+    for(k = 0; k < 3; k++)
+        for(i = 0; i < SUDOKU_SIZE; i++){
+            peer = session_cell(units[k], i);
+            s->candidates[peer] = get_cell_lin(&s->board, peer) ? ZERO
+                                    : get_candidates_lin(&s->board, peer);
+        }
+}
+/**
+    Searches for a solution of the board and keeps it.
+    @return {int} - SUDOKU_MOVE_SOLVABLE or SUDOKU_MOVE_CONTRADICTION.
+*/
+static int session_search(sudoku_session* s){
+    sudoku_field f = s->board;
+
+    s->searches++;
+    s->solvable = sudoku_solve_engine(&f, s->engine) != NULL;
+    if(s->solvable)
+        s->solution = f;
+    return s->solvable ? SUDOKU_MOVE_SOLVABLE : SUDOKU_MOVE_CONTRADICTION;
+}
+/**
+    Starts a session on a puzzle and searches for its first solution.
+
+    @param {sudoku_session*} s - The session to set up.
+    @param {char*} puzzle - The clues, SUDOKU_CELLS characters as read by sudoku_read_line.
+    @param {su_engine_t} engine - The engine of the full searches. Not dlx,
+                                  which allocates.
+    @return {int} - SUDOKU_MOVE_SOLVABLE or SUDOKU_MOVE_CONTRADICTION.
+                    SUDOKU_MOVE_CONFLICT if clues clash and SUDOKU_MOVE_BAD_ARG
+                    for an unknown character or engine, in which case the
+                    session can't be used.
+*/
+int             init_sudoku_session(sudoku_session* s, const char* puzzle, su_engine_t engine){
+    int rc;
+
+    if((int) engine < 0 || engine >= SUDOKU_ENGINE_COUNT || engine == SUDOKU_ENGINE_DLX)
+        return SUDOKU_MOVE_BAD_ARG;
+    switch(sudoku_read_line(&s->board, puzzle)){
+        case(SUDOKU_LINE_OK):
+            break;
+        case(SUDOKU_LINE_CONFLICT):
+            return SUDOKU_MOVE_CONFLICT;
+        default:
+            return SUDOKU_MOVE_BAD_ARG;
+    }
+    for(rc = 0; rc < SUDOKU_CELLS; rc++){
+        s->given[rc] = get_cell_lin(&s->board, rc) != ZERO;
+        s->candidates[rc] = s->given[rc] ? ZERO : get_candidates_lin(&s->board, rc);
+    }
+    s->engine = engine;
+    s->searches = 0;
+    return session_search(s);
+}
+/**
+    Places a value in an empty cell, or replaces the value of a move.
+
+    @param {sudoku_session*} s - The session.
+    @param {su_rcb_t} r - The row.
+    @param {su_rcb_t} c - The column.
+    @param {int} value - The value, 1..SUDOKU_SIZE.
+    @return {int} - A SUDOKU_MOVE_ outcome.
+*/
+int             sudoku_session_place(sudoku_session* s, su_rcb_t r, su_rcb_t c, int value){
+    int rc;
+    su_cell_t nbr, old;
+
+    if(r >= SUDOKU_SIZE || c >= SUDOKU_SIZE || value < 1 || value > SUDOKU_SIZE)
+        return SUDOKU_MOVE_BAD_ARG;
+    rc = r_and_c_to_rc(r, c);
+    nbr = ONE << (value - 1);
+    if(s->given[rc])
+        return SUDOKU_MOVE_GIVEN;
+    old = get_cell(&s->board, r, c);
+    if(old == nbr)
+        return s->solvable ? SUDOKU_MOVE_SOLVABLE : SUDOKU_MOVE_CONTRADICTION;
+    if(old != ZERO)
+        unset_cell(&s->board, r, c, old);
+    if(set_cell(&s->board, r, c, nbr)){
+        if(old != ZERO)
+            set_cell(&s->board, r, c, old);
+        return SUDOKU_MOVE_CONFLICT;
+    }
+    if(old != ZERO){
+        // The old value is a candidate of the peers again, then the new one goes.
+        session_refresh(s, rc);
+        s->candidates[rc] = ZERO;
+    }else if(session_remove(s, rc, nbr)){
+        s->solvable = 0;
+        return SUDOKU_MOVE_CONTRADICTION;
+    }
+    // The kept solution agrees with every other cell already.
+    if(s->solvable && get_cell_lin(&s->solution, rc) == nbr)
+        return SUDOKU_MOVE_SOLVABLE;
+    return session_search(s);
+}
+/**
+    Empties a cell. Erasing an empty cell does nothing.
+
+    @param {sudoku_session*} s - The session.
+    @param {su_rcb_t} r - The row.
+    @param {su_rcb_t} c - The column.
+    @return {int} - A SUDOKU_MOVE_ outcome.
+*/
+int             sudoku_session_erase(sudoku_session* s, su_rcb_t r, su_rcb_t c){
+    int rc;
+    su_cell_t old;
+
+    if(r >= SUDOKU_SIZE || c >= SUDOKU_SIZE)
+        return SUDOKU_MOVE_BAD_ARG;
+    rc = r_and_c_to_rc(r, c);
+    if(s->given[rc])
+        return SUDOKU_MOVE_GIVEN;
+    old = get_cell(&s->board, r, c);
+    if(old != ZERO){
+        unset_cell(&s->board, r, c, old);
+        session_refresh(s, rc);
+    }
+    // A solution of the board is still one with fewer moves.
+    if(s->solvable)
+        return SUDOKU_MOVE_SOLVABLE;
+    return session_search(s);
+}
+/**
+    Lists the values the board forces: empty cells with one candidate left
+    (naked singles) and values with one cell left in a row, column or box
+    (hidden singles). Every cell is listed once, in reading order.
+
+    @param {sudoku_session*} s - The session.
+    @param {sudoku_forced*} out - Buffer of SUDOKU_CELLS forced values.
+    @return {int} - Number of forced values written.
+*/
+int             sudoku_session_forced(const sudoku_session* s, sudoku_forced* out){
+    su_cell_t forced[SUDOKU_CELLS];
+    su_cell_t once, twice, hidden, cand, nbr;
+    int rc, unit, i, n = 0;
+
+    for(rc = 0; rc < SUDOKU_CELLS; rc++){
+        cand = s->candidates[rc];
+        forced[rc] = cand && !(cand & (cand - 1)) ? cand : ZERO;
+    }
+    // once/twice holds the values seen at least once/twice in a unit.
+    for(unit = 0; unit < 3 * SUDOKU_SIZE; unit++){
+        once = twice = ZERO;
+        for(i = 0; i < SUDOKU_SIZE; i++){
+            cand = s->candidates[session_cell(unit, i)];
+            twice |= once & cand;
+            once  |= cand;
+        }
+        hidden = once & ~twice;
+        for(i = 0; i < SUDOKU_SIZE && hidden; i++){
+            rc = session_cell(unit, i);
+            nbr = s->candidates[rc] & hidden;
+            if(nbr && !forced[rc])
+                forced[rc] = nbr & (~nbr + 1);
+            hidden &= ~nbr;
+        }
+    }
+    for(rc = 0; rc < SUDOKU_CELLS; rc++){
+        if(!forced[rc])
+            continue;
+        out[n].r = rc_to_r(rc);
+        out[n].c = rc_to_c(rc);
+        for(out[n].value = 1; !(forced[rc] & (ONE << (out[n].value - 1))); out[n].value++)
+            ;
+        n++;
+    }
+    return n;
+}
@@ -0,0 +1,97 @@
+#ifndef SUDOKU_SESSION_H_INCLUDED
+#define SUDOKU_SESSION_H_INCLUDED
+
+#include "sudoku_general_tools.h"
+
+/**
+    Incremental play. A session holds a board of clues and moves, the
+    candidates of its empty cells and a solution that agrees with it. Moves
+    are made with set_cell and unset_cell and the candidates of the cells
+    sharing a row, column or box are updated in place. A move is answered
+    from the candidates and the kept solution when it can be: a full search
+    only runs when a placed value differs from the kept solution, or when the
+    board had no solution before an erase. Like sudoku_lib.h, nothing here
+    prints, exits or allocates.
+
+    Rows and columns count from 0, values from 1 as on the board.
+*/
+
+// Outcomes of a move.
+#define SUDOKU_MOVE_SOLVABLE        (0) // The board can still be solved.
+#define SUDOKU_MOVE_CONTRADICTION   (1) // The board has no solution. The move
+                                        // is kept, so it can be erased again.
+#define SUDOKU_MOVE_CONFLICT        (2) // The value is in the row, column or box
+                                        // already. Nothing changed.
+#define SUDOKU_MOVE_GIVEN           (3) // The cell holds a clue. Nothing changed.
+#define SUDOKU_MOVE_BAD_ARG         (4) // Cell or value out of range, or an
+                                        // unreadable puzzle. Nothing changed.
+
+/**
+    A session, see above. May live on the stack or be copied with a plain
+    assignment.
+*/
+typedef struct sudoku_session sudoku_session;
+struct sudoku_session {
+    sudoku_field board;                 // Clues and moves.
+    sudoku_field solution;              // Agrees with board if solvable is set.
+    su_cell_t candidates[SUDOKU_CELLS]; // Of the empty cells of board. ZERO for filled.
+    unsigned char given[SUDOKU_CELLS];  // Non-zero for the clues.
+    int solvable;                       // Non-zero if solution is one of board.
+    su_engine_t engine;                 // Engine of the full searches.
+    long searches;                      // Full searches run so far.
+};
+
+/**
+    A value forced by the board, see sudoku_session_forced.
+*/
+typedef struct sudoku_forced sudoku_forced;
+struct sudoku_forced {
+    int r;
+    int c;
+    int value;
+};
+
+/**
+    Starts a session on a puzzle and searches for its first solution.
+
+    @param {sudoku_session*} s - The session to set up.
+    @param {char*} puzzle - The clues, SUDOKU_CELLS characters as read by sudoku_read_line.
+    @param {su_engine_t} engine - The engine of the full searches. Not dlx,
+                                  which allocates.
+    @return {int} - SUDOKU_MOVE_SOLVABLE or SUDOKU_MOVE_CONTRADICTION.
+                    SUDOKU_MOVE_CONFLICT if clues clash and SUDOKU_MOVE_BAD_ARG
+                    for an unknown character or engine, in which case the
+                    session can't be used.
+*/
+int             init_sudoku_session(sudoku_session* s, const char* puzzle, su_engine_t engine);
+/**
+    Places a value in an empty cell, or replaces the value of a move.
+
+    @param {sudoku_session*} s - The session.
+    @param {su_rcb_t} r - The row.
+    @param {su_rcb_t} c - The column.
+    @param {int} value - The value, 1..SUDOKU_SIZE.
+    @return {int} - A SUDOKU_MOVE_ outcome.
+*/
+int             sudoku_session_place(sudoku_session* s, su_rcb_t r, su_rcb_t c, int value);
+/**
+    Empties a cell. Erasing an empty cell does nothing.
+
+    @param {sudoku_session*} s - The session.
+    @param {su_rcb_t} r - The row.
+    @param {su_rcb_t} c - The column.
+    @return {int} - A SUDOKU_MOVE_ outcome.
+*/
+int             sudoku_session_erase(sudoku_session* s, su_rcb_t r, su_rcb_t c);
+/**
+    Lists the values the board forces: empty cells with one candidate left
+    (naked singles) and values with one cell left in a row, column or box
+    (hidden singles). Every cell is listed once, in reading order.
+
+    @param {sudoku_session*} s - The session.
+    @param {sudoku_forced*} out - Buffer of SUDOKU_CELLS forced values.
+    @return {int} - Number of forced values written.
+*/
+int             sudoku_session_forced(const sudoku_session* s, sudoku_forced* out);
+
+#endif // SUDOKU_SESSION_H_INCLUDED
@@ -1,6 +1,9 @@
 // Sudoku solver solving tools
 #include <stdio.h>      // For standard IO
 #include <stdlib.h>     // For standard stuff
+#include <string.h>     // strcmp, memcpy
+#include <stdatomic.h>  // Cancellation flag
+#include <time.h>       // clock_gettime
 
 
 #include "sudoku_general_tools.h"
@@ -9,6 +12,28 @@
     Tools directly involved in the sudoku solving.
 */
 
+static sudoku_field* solve_rec_lin(sudoku_field*, int rc, sudoku_solve_ctl*);
+static sudoku_field* solve_iter_lin(sudoku_field*, sudoku_solve_ctl*);
+static sudoku_field* solve_rec_mrv(sudoku_field*, sudoku_solve_ctl*);
+static sudoku_field* solve_rec_prop(sudoku_field*, sudoku_candidates*, sudoku_solve_ctl*);
+static void count_rec_prop(sudoku_field*, sudoku_candidates*, int limit, int* count, sudoku_solve_ctl*);
+static sudoku_field* solve_engine(sudoku_field*, su_engine_t, sudoku_solve_ctl*);
+
+#ifdef SUDOKU_STATS
+_Thread_local sudoku_search_stats sudoku_thread_stats;
+#endif
+
+// Engine names, indexed by su_engine_t.
+static const char* engine_names[SUDOKU_ENGINE_COUNT] = {
+    "linear",
+    "mrv",
+    "prop",
+    "iter",
+    "bitboard",
+    "simd",
+    "dlx"
+};
+
 
 /**
     Checks wether or not a row already contain a number of a certain value.
@@ -74,6 +99,26 @@ su_cell_t get_cell( const sudoku_field* f, su_rcb_t r, su_rcb_t c){
 su_cell_t get_cell_lin( const sudoku_field* f, int rc){
     return *(f->field + rc);
 }
+/**
+    Gets the values that can still be placed in a given cell, ie the values
+    not present in the row, column or box of the cell.
+    @param {sudokufield} f - The input sudoku field.
+    @param {int} rc - The position of the cell in a linear memory arena.
+    @return {su_cell_t} - Mask of the candidate values.
+*/
+su_cell_t get_candidates_lin( const sudoku_field* f, int rc){
+    return (su_cell_t) ~( *(f->row_contains + rc_to_r(rc)) |
+                          *(f->col_contains + rc_to_c(rc)) |
+                          *(f->box_contains + rc_to_b(rc)) ) & SUDOKU_ALL_VALUES;
+}
+/**
+    Counts the number of values set in a candidate mask.
+    @param {su_cell_t} candidates - The candidate mask.
+    @return {int} - The number of candidates.
+*/
+int count_candidates(su_cell_t candidates){
+    return __builtin_popcount(candidates);
+}
 
 /**
     Converts the r and c values to the box containing the cell at positon r,c
@@ -113,6 +158,7 @@ int set_cell(sudoku_field* f, su_rcb_t r, su_rcb_t c, su_cell_t input){
     if( check_row(      f, r, input) ||
         check_column(   f, c, input) ||
         check_box(      f, b, input) ){
+            SUDOKU_STAT_ADD(failed_sets, 1);
             return 1;
     }
     *(f->row_contains + r)           = *(f->row_contains + r) | input;
@@ -180,13 +226,22 @@ void unset_cell_lin(sudoku_field* f, int rc, su_cell_t nbr){
     @return {sudoku_field*} - A solved sudoku if successful. NULL otherwise.
 */
 sudoku_field*    init_sudoku_solve(const sudoku_field* f){
+    return init_sudoku_solve_engine(f, SUDOKU_ENGINE_DEFAULT);
+}
+/**
+    Initiates a solving of a sudoku field using a given engine. Returns a new
+    sudoku field.
+
+    @param {sudoku_field*} f - Input sudoku to solve.
+    @param {su_engine_t} engine - The engine to solve with.
+    @return {sudoku_field*} - A solved sudoku if successful. NULL otherwise.
+*/
+sudoku_field*    init_sudoku_solve_engine(const sudoku_field* f, su_engine_t engine){
     sudoku_field* ret, *tmp;
-    if(!sudoku_valid(f)){
-        printf("Input Sudoku not a valid Sudoku. Returning NULL.");
+    if(!sudoku_valid(f))
         return NULL;
-    }
     ret = copy_sudoku_field(f);
-    tmp = sudoku_solve_rec_lin(ret, 0);
+    tmp = sudoku_solve_engine(ret, engine);
     if(tmp == NULL){
         free_sudoku_field(ret);
         return tmp;
@@ -194,6 +249,206 @@ sudoku_field*    init_sudoku_solve(const sudoku_field* f){
         return ret; // Since ret's contents is modified in solve_rec
     }
 }
+/**
+    Solves the input sudoku in place using a given engine. The field is left
+    unchanged if no solution exists.
+
+    @param {sudoku_field*} f - Input sudoku to solve.
+    @param {su_engine_t} engine - The engine to solve with.
+    @return {sudoku_field*} - The input field (solved) if successful. NULL otherwise.
+*/
+sudoku_field*    sudoku_solve_engine(sudoku_field* f, su_engine_t engine){
+    return sudoku_solve_engine_ctl(f, engine, NULL);
+}
+/**
+    Solves the input sudoku in place using a given engine, under the control
+    of a sudoku_solve_ctl. The field is left unchanged if no solution exists
+    or if the search is stopped.
+
+    @param {sudoku_field*} f - Input sudoku to solve.
+    @param {su_engine_t} engine - The engine to solve with.
+    @param {sudoku_solve_ctl*} ctl - Search control. May be NULL.
+    @return {sudoku_field*} - The input field (solved) if successful. NULL otherwise.
+*/
+sudoku_field*    sudoku_solve_engine_ctl(sudoku_field* f, su_engine_t engine, sudoku_solve_ctl* ctl){
+#ifdef SUDOKU_STATS
+    struct timespec start, end;
+    sudoku_field* ret;
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    ret = solve_engine(f, engine, ctl);
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    sudoku_thread_stats.solves++;
+    sudoku_thread_stats.seconds += (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) * 1e-9;
+    return ret;
+#else
+    return solve_engine(f, engine, ctl);
+#endif
+}
+/**
+    Starts the budgets of a control over for a new solve.
+*/
+static void start_solve_ctl(sudoku_solve_ctl* ctl){
+    if(ctl == NULL)
+        return;
+    ctl->stopped = 0;
+    ctl->nodes = 0;
+    ctl->stop_at = ctl->deadline;
+    if(ctl->max_seconds > 0 && (ctl->stop_at <= 0 || sudoku_clock_seconds() + ctl->max_seconds < ctl->stop_at))
+        ctl->stop_at = sudoku_clock_seconds() + ctl->max_seconds;
+}
+/**
+    The engine dispatch of sudoku_solve_engine_ctl.
+*/
+static sudoku_field* solve_engine(sudoku_field* f, su_engine_t engine, sudoku_solve_ctl* ctl){
+    start_solve_ctl(ctl);
+    switch(engine){
+        case(SUDOKU_ENGINE_LINEAR):
+            return solve_rec_lin(f, 0, ctl);
+        case(SUDOKU_ENGINE_MRV):
+            return solve_rec_mrv(f, ctl);
+        case(SUDOKU_ENGINE_PROP):{
+            sudoku_candidates c;
+            init_sudoku_candidates(f, &c);
+            return solve_rec_prop(f, &c, ctl);
+        }
+        case(SUDOKU_ENGINE_ITER):
+            return solve_iter_lin(f, ctl);
+        case(SUDOKU_ENGINE_BITBOARD):
+            return sudoku_solve_bitboard(f, 0, ctl);
+        case(SUDOKU_ENGINE_SIMD):
+            return sudoku_solve_bitboard(f, 1, ctl);
+        case(SUDOKU_ENGINE_DLX):{
+            sudoku_dlx* x = sudoku_thread_dlx();
+            if(x == NULL){
+                fprintf(stderr, "Could not allocate memory for the dancing links, %d", __LINE__);
+                exit(1);
+            }
+            return sudoku_solve_dlx(x, f, ctl);
+        }
+        default:
+            fprintf(stderr, "Unknown solver engine %d, %d", engine, __LINE__);
+            exit(1);
+    }
+}
+/**
+    Checks whether a search should stop, and records it in the control if so.
+    Called once per search node, that is every time an engine descends into a
+    search state and never on backtracking, so the node counts of the engines
+    can be compared. The clock is only read every SUDOKU_CLOCK_NODES nodes,
+    so a time budget can be overrun by that many.
+    @param {sudoku_solve_ctl*} ctl - Search control. May be NULL.
+    @return {int} - Non-zero if the search should stop. 0 otherwise.
+*/
+int             sudoku_solve_stopped(sudoku_solve_ctl* ctl){
+    SUDOKU_STAT_ADD(nodes, 1);
+    if(ctl == NULL)
+        return 0;
+    if(ctl->stopped)
+        return 1;
+    ctl->nodes++;
+    if(ctl->cancel != NULL && atomic_load_explicit(ctl->cancel, memory_order_relaxed))
+        ctl->stopped = SUDOKU_SOLVE_CANCELLED;
+    else if(ctl->max_nodes > 0 && ctl->nodes > ctl->max_nodes)
+        ctl->stopped = SUDOKU_SOLVE_BUDGET;
+    else if(ctl->stop_at > 0 && ctl->nodes % SUDOKU_CLOCK_NODES == 0 && sudoku_clock_seconds() >= ctl->stop_at)
+        ctl->stopped = SUDOKU_SOLVE_BUDGET;
+    return ctl->stopped;
+}
+/**
+    Sets up a control without cancel flag or budgets.
+    @param {sudoku_solve_ctl*} ctl - The control.
+*/
+void            init_sudoku_solve_ctl(sudoku_solve_ctl* ctl){
+    memset(ctl, 0, sizeof(*ctl));
+}
+/**
+    Solves the input sudoku in place like sudoku_solve_engine_ctl, telling a
+    puzzle without solution apart from a search that was stopped.
+
+    @param {sudoku_field*} f - Input sudoku to solve.
+    @param {su_engine_t} engine - The engine to solve with.
+    @param {sudoku_solve_ctl*} ctl - Search control. May be NULL.
+    @return {int} - A SUDOKU_SOLVE_ outcome. The field is solved only for
+                    SUDOKU_SOLVE_SOLVED.
+*/
+int             sudoku_solve_status(sudoku_field* f, su_engine_t engine, sudoku_solve_ctl* ctl){
+    if(sudoku_solve_engine_ctl(f, engine, ctl) != NULL)
+        return SUDOKU_SOLVE_SOLVED;
+    // A stopped search never saw all of the tree.
+    return ctl != NULL && ctl->stopped ? ctl->stopped : SUDOKU_SOLVE_UNSOLVABLE;
+}
+/**
+    Gets the time of the monotonic clock, as used for deadlines.
+    @return {double} - Seconds from an arbitrary starting point.
+*/
+double          sudoku_clock_seconds(void){
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+/**
+    Gets the search counters of the calling thread and starts them over.
+    Taken before and after a solve they give the counters of that solve.
+    @param {sudoku_search_stats*} out - Set to the counters. May be NULL to
+                                        only start over.
+*/
+void            take_sudoku_search_stats(sudoku_search_stats* out){
+#ifdef SUDOKU_STATS
+    if(out != NULL)
+        *out = sudoku_thread_stats;
+    memset(&sudoku_thread_stats, 0, sizeof(sudoku_thread_stats));
+#else
+    if(out != NULL)
+        memset(out, 0, sizeof(*out));
+#endif
+}
+/**
+    Adds counters to a total. max_depth becomes the larger of the two.
+    @param {sudoku_search_stats*} total - The total.
+    @param {sudoku_search_stats*} s - The counters to add.
+*/
+void            add_sudoku_search_stats(sudoku_search_stats* total, const sudoku_search_stats* s){
+    total->solves += s->solves;
+    total->nodes += s->nodes;
+    total->backtracks += s->backtracks;
+    total->failed_sets += s->failed_sets;
+    total->propagations += s->propagations;
+    if(s->max_depth > total->max_depth)
+        total->max_depth = s->max_depth;
+    total->seconds += s->seconds;
+}
+/**
+    Prints counters as a JSON object, without line break.
+    @param {FILE*} out - Stream to print to.
+    @param {sudoku_search_stats*} s - The counters.
+*/
+void            print_sudoku_search_stats_json(FILE* out, const sudoku_search_stats* s){
+    fprintf(out, "{\"solves\": %lld, \"nodes\": %lld, \"backtracks\": %lld, \"failed_sets\": %lld, "
+                 "\"propagations\": %lld, \"max_depth\": %d, \"seconds\": %.6f}",
+                s->solves, s->nodes, s->backtracks, s->failed_sets, s->propagations, s->max_depth, s->seconds);
+}
+/**
+    Gets the engine with a given name, eg "linear" or "mrv".
+    @param {char*} name - The engine name.
+    @return {int} - The su_engine_t value. -1 if there is no such engine.
+*/
+int             sudoku_engine_from_name(const char* name){
+    int e;
+    for(e = 0; e < SUDOKU_ENGINE_COUNT; e++){
+        if(strcmp(name, engine_names[e]) == 0)
+            return e;
+    }
+    return -1;
+}
+/**
+    Gets the name of an engine.
+    @param {su_engine_t} engine - The engine.
+    @return {char*} - The engine name.
+*/
+const char*     sudoku_engine_name(su_engine_t engine){
+    return engine_names[engine];
+}
 /**
     Tries to solve the input sudoku recursively. Returns the input sudoku field
     (solved) if successful and NULL otherwise. Caution is therefore needed to
@@ -219,12 +474,17 @@ sudoku_field*   sudoku_solve_rec(sudoku_field*, su_rcb_t next_x, su_rcb_t next_y
     @return {sudoku_field*} - A solved sudoku if successful. NULL otherwise.
 */
 sudoku_field*   sudoku_solve_rec_lin(sudoku_field* f,int rc){
+    return solve_rec_lin(f, rc, NULL);
+}
+static sudoku_field* solve_rec_lin(sudoku_field* f, int rc, sudoku_solve_ctl* ctl){
     su_cell_t cell_test_value;
     sudoku_field* ret;
 
     if(rc >= SUDOKU_SIZE*SUDOKU_SIZE)
         return f; // If we made it this far the sudoku is valid and solved.
     if(!get_cell_lin(f, rc)){ // If current cell is empty do.
+        if(sudoku_solve_stopped(ctl))
+            return NULL;
         for(cell_test_value = ONE; cell_test_value < (ONE << SUDOKU_SIZE);
                                     cell_test_value=(cell_test_value << 1) ){
             /* ------------------DEBUG--------------------------------------- */
@@ -236,8 +496,11 @@ sudoku_field*   sudoku_solve_rec_lin(sudoku_field* f,int rc){
 //            printf("solve_rec_lin rc: %d Test val: %x\n",rc, cell_test_value); fflush(stdout);
             /* ------------------DEBUG----------------------------------------*/
             if( !set_cell_lin(f, rc, cell_test_value) ){ // Current row, column and box does not contain cell_test_value if the set succeed (return val 0).
-                ret = sudoku_solve_rec_lin(f, rc+1);
+                SUDOKU_STAT_DOWN();
+                ret = solve_rec_lin(f, rc+1, ctl);
+                SUDOKU_STAT_UP();
                 if(ret == NULL){
+                    SUDOKU_STAT_ADD(backtracks, 1);
                     unset_cell_lin(f, rc, cell_test_value);
                 }else{
                     return ret;
@@ -248,9 +511,411 @@ sudoku_field*   sudoku_solve_rec_lin(sudoku_field* f,int rc){
         // empty cell. Ie there is no solution.
         return NULL;
     }else{ // else try next cell
-        return sudoku_solve_rec_lin(f, rc +1);
+        return solve_rec_lin(f, rc +1, ctl);
     }
     //The code shouldn't end up here.
     fprintf(stderr,"Oj, vilken overaskning?");
     exit(1);
 }
+/**
+    Solves the input sudoku without recursion, visiting the cells in the same
+    order and trying the values in the same order as sudoku_solve_rec_lin, so
+    the solutions are the same. The search state is a fixed-size stack of the
+    values placed in the empty cells, which doubles as the trail used to unset
+    them again. Nothing is allocated during the solve.
+
+    @param {sudoku_field*} f - Input sudoku to solve.
+    @return {sudoku_field*} - The input field (solved) if successful. NULL otherwise.
+*/
+sudoku_field*   sudoku_solve_iter_lin(sudoku_field* f){
+    return solve_iter_lin(f, NULL);
+}
+static sudoku_field* solve_iter_lin(sudoku_field* f, sudoku_solve_ctl* ctl){
+    int empty[SUDOKU_CELLS];        // rc index of the empty cells, row-major.
+    su_cell_t placed[SUDOKU_CELLS]; // Value placed in empty[depth]. ZERO if none.
+    int n_empty = 0;
+    int depth = 0;
+    int rc;
+    su_cell_t candidates, cell_test_value;
+
+    for(rc = 0; rc < SUDOKU_CELLS; rc++){
+        if(!get_cell_lin(f, rc))
+            empty[n_empty++] = rc;
+    }
+    if(n_empty == 0)
+        return f;
+    placed[0] = ZERO;
+    while(depth < n_empty){
+        // A node on arriving at a cell, as a call of solve_rec_lin. Coming
+        // back to it after a failure is the same node.
+        if(placed[depth] == ZERO && sudoku_solve_stopped(ctl)){
+            while(depth-- > 0) // Unset everything placed so far.
+                unset_cell_lin(f, empty[depth], placed[depth]);
+            return NULL;
+        }
+        rc = empty[depth];
+        cell_test_value = placed[depth];
+        candidates = get_candidates_lin(f, rc);
+        if(cell_test_value){ // Back here after a failure. Try the next value.
+            SUDOKU_STAT_ADD(backtracks, 1);
+            unset_cell_lin(f, rc, cell_test_value);
+            candidates &= ~((cell_test_value << 1) - 1);
+        }
+        if(candidates){
+            cell_test_value = candidates & (~candidates + 1); // Lowest candidate.
+            set_cell_lin(f, rc, cell_test_value); // Can't fail, it's a candidate.
+            placed[depth++] = cell_test_value;
+            SUDOKU_STAT_DEPTH(depth);
+            if(depth < n_empty)
+                placed[depth] = ZERO;
+        }else{
+            placed[depth] = ZERO;
+            if(depth == 0)
+                return NULL; // Every value failed in the first empty cell.
+            depth--;
+        }
+    }
+    return f;
+}
+/**
+    Finds the empty cell with the fewest candidates (minimum remaining values).
+    Stops early on a cell with a single candidate since no cell can do better,
+    or on a cell without candidates since the field can't be solved.
+
+    @param {sudoku_field*} f - The input sudoku field.
+    @param {su_cell_t*} candidates - Set to the candidates of the found cell.
+    @return {int} - rc index of the cell, SUDOKU_NO_EMPTY_CELL if the field is
+                    full or SUDOKU_DEAD_CELL if an empty cell has no candidates.
+*/
+int             find_mrv_cell(const sudoku_field* f, su_cell_t* candidates){
+    int rc;
+    int best_rc = SUDOKU_NO_EMPTY_CELL;
+    int best_count = SUDOKU_SIZE + 1;
+    int count;
+    su_cell_t cand;
+
+    for(rc = 0; rc < SUDOKU_CELLS; rc++){
+        if(get_cell_lin(f, rc))
+            continue;
+        cand = get_candidates_lin(f, rc);
+        count = count_candidates(cand);
+        if(count < best_count){
+            best_rc = rc;
+            best_count = count;
+            *candidates = cand;
+            if(count <= 1)
+                break;
+        }
+    }
+    if(best_count == 0)
+        return SUDOKU_DEAD_CELL;
+    return best_rc;
+}
+/**
+    Tries to solve the input sudoku recursively, always branching on the empty
+    cell with the fewest candidates. A branch is abandoned as soon as any
+    empty cell runs out of candidates. Returns the input sudoku field (solved)
+    if successful and NULL otherwise.
+
+    @param {sudoku_field*} f - Input sudoku to solve.
+    @return {sudoku_field*} - A solved sudoku if successful. NULL otherwise.
+*/
+sudoku_field*   sudoku_solve_rec_mrv(sudoku_field* f){
+    return solve_rec_mrv(f, NULL);
+}
+static sudoku_field* solve_rec_mrv(sudoku_field* f, sudoku_solve_ctl* ctl){
+    su_cell_t candidates = ZERO;
+    su_cell_t cell_test_value;
+    int rc;
+
+    if(sudoku_solve_stopped(ctl))
+        return NULL;
+    rc = find_mrv_cell(f, &candidates);
+
+    if(rc == SUDOKU_NO_EMPTY_CELL)
+        return f; // Every cell is filled, ie the sudoku is solved.
+    if(rc == SUDOKU_DEAD_CELL)
+        return NULL;
+    while(candidates){
+        cell_test_value = candidates & (~candidates + 1); // Lowest candidate.
+        candidates ^= cell_test_value;
+        set_cell_lin(f, rc, cell_test_value); // Can't fail, it's a candidate.
+        SUDOKU_STAT_DOWN();
+        if(solve_rec_mrv(f, ctl) != NULL){
+            SUDOKU_STAT_UP();
+            return f;
+        }
+        SUDOKU_STAT_UP();
+        SUDOKU_STAT_ADD(backtracks, 1);
+        unset_cell_lin(f, rc, cell_test_value);
+    }
+    return NULL;
+}
+
+// Propagation
+
+/**
+    Gets the rc index of the i:th cell of a unit. Units 0 to SUDOKU_SIZE-1 are
+    the rows, followed by the columns and then the boxes.
+*/
+static int unit_cell_to_rc(int unit, int i){
+    int b;
+    if(unit < SUDOKU_SIZE)
+        return r_and_c_to_rc(unit, i);
+    if(unit < 2 * SUDOKU_SIZE)
+        return r_and_c_to_rc(i, unit - SUDOKU_SIZE);
+    b = unit - 2 * SUDOKU_SIZE;
+    return r_and_c_to_rc( SUDOKU_BOX_WIDTH*(b/SUDOKU_BOX_WIDTH) + i/SUDOKU_BOX_WIDTH,
+                          SUDOKU_BOX_WIDTH*(b%SUDOKU_BOX_WIDTH) + i%SUDOKU_BOX_WIDTH);
+}
+/**
+    Gets the values placed in a unit, numbered as in unit_cell_to_rc.
+*/
+static su_cell_t unit_contains(const sudoku_field* f, int unit){
+    if(unit < SUDOKU_SIZE)
+        return *(f->row_contains + unit);
+    if(unit < 2 * SUDOKU_SIZE)
+        return *(f->col_contains + unit - SUDOKU_SIZE);
+    return *(f->box_contains + unit - 2 * SUDOKU_SIZE);
+}
+/**
+    Sets up the candidate masks of a sudoku field and clears the trail.
+    @param {sudoku_field*} f - The input sudoku field.
+    @param {sudoku_candidates*} c - The candidates to set up.
+*/
+void            init_sudoku_candidates(const sudoku_field* f, sudoku_candidates* c){
+    int rc;
+    for(rc = 0; rc < SUDOKU_CELLS; rc++){
+        c->cell[rc] = get_cell_lin(f, rc) ? ZERO : get_candidates_lin(f, rc);
+    }
+    c->trail_len = 0;
+}
+/**
+    Places a value in a cell and removes it from the candidates of every cell
+    sharing row, column or box with it. The cell is added to the trail.
+    @param {sudoku_field*} f - The sudoku field.
+    @param {sudoku_candidates*} c - The candidates of the field.
+    @param {int} rc - The position of the cell in a linear memory arena.
+    @param {su_cell_t} nbr - The value to place.
+    @return {int} - 0 if successful. Non-zero otherwise.
+*/
+int             place_candidate_lin(sudoku_field* f, sudoku_candidates* c, int rc, su_cell_t nbr){
+    int i;
+    su_cell_t keep = (su_cell_t) ~nbr;
+    int r_unit = rc_to_r(rc);
+    int c_unit = SUDOKU_SIZE + rc_to_c(rc);
+    int b_unit = 2 * SUDOKU_SIZE + rc_to_b(rc);
+
+    if(set_cell_lin(f, rc, nbr))
+        return 1;
+    c->cell[rc] = ZERO; // Filled cells have no candidates.
+    c->trail[c->trail_len++] = rc;
+    for(i = 0; i < SUDOKU_SIZE; i++){
+        c->cell[unit_cell_to_rc(r_unit, i)] &= keep;
+        c->cell[unit_cell_to_rc(c_unit, i)] &= keep;
+        c->cell[unit_cell_to_rc(b_unit, i)] &= keep;
+    }
+    return 0;
+}
+/**
+    Places naked singles (cells with one candidate) and hidden singles (values
+    with one possible cell in a row, column or box) until nothing changes.
+    @param {sudoku_field*} f - The sudoku field.
+    @param {sudoku_candidates*} c - The candidates of the field.
+    @return {int} - 0 if successful. Non-zero if a contradiction was found.
+*/
+int             propagate_sudoku_candidates(sudoku_field* f, sudoku_candidates* c){
+    int rc, unit, i;
+    int changed = 1;
+    su_cell_t cand, once, twice, hidden, nbr, placed;
+
+    while(changed){
+        changed = 0;
+        // Naked singles.
+        for(rc = 0; rc < SUDOKU_CELLS; rc++){
+            if(get_cell_lin(f, rc))
+                continue;
+            cand = c->cell[rc];
+            if(cand == ZERO)
+                return 1; // Empty cell without candidates.
+            if(!(cand & (cand - 1))){
+                if(place_candidate_lin(f, c, rc, cand))
+                    return 1;
+                SUDOKU_STAT_ADD(propagations, 1);
+                changed = 1;
+            }
+        }
+        // Hidden singles. once/twice holds the values seen at least once/twice.
+        for(unit = 0; unit < 3 * SUDOKU_SIZE; unit++){
+            once = twice = ZERO;
+            for(i = 0; i < SUDOKU_SIZE; i++){
+                cand = c->cell[unit_cell_to_rc(unit, i)];
+                twice |= once & cand;
+                once  |= cand;
+            }
+            placed = unit_contains(f, unit);
+            if((once | placed) != SUDOKU_ALL_VALUES)
+                return 1; // A value has nowhere to go.
+            hidden = once & ~twice;
+            while(hidden){
+                nbr = hidden & (~hidden + 1);
+                hidden ^= nbr;
+                for(i = 0; i < SUDOKU_SIZE; i++){
+                    rc = unit_cell_to_rc(unit, i);
+                    if(c->cell[rc] & nbr)
+                        break;
+                }
+                if(i == SUDOKU_SIZE || place_candidate_lin(f, c, rc, nbr))
+                    return 1;
+                SUDOKU_STAT_ADD(propagations, 1);
+                changed = 1;
+            }
+        }
+    }
+    return 0;
+}
+/**
+    Unsets every cell placed since the trail had a given length.
+    NOTE! The candidate masks are not restored.
+    @param {sudoku_field*} f - The sudoku field.
+    @param {sudoku_candidates*} c - The candidates of the field.
+    @param {int} mark - The trail length to go back to.
+*/
+void            undo_sudoku_candidates(sudoku_field* f, sudoku_candidates* c, int mark){
+    int rc;
+    while(c->trail_len > mark){
+        rc = c->trail[--c->trail_len];
+        unset_cell_lin(f, rc, get_cell_lin(f, rc));
+    }
+}
+/**
+    Tries to solve the input sudoku recursively. Singles are propagated before
+    every branch and the search branches on the cell with the fewest
+    candidates. Everything placed is undone on backtrack. Returns the input
+    sudoku field (solved) if successful and NULL otherwise.
+
+    @param {sudoku_field*} f - Input sudoku to solve.
+    @param {sudoku_candidates*} c - Candidates of f, see init_sudoku_candidates.
+    @return {sudoku_field*} - A solved sudoku if successful. NULL otherwise.
+*/
+sudoku_field*   sudoku_solve_rec_prop(sudoku_field* f, sudoku_candidates* c){
+    return solve_rec_prop(f, c, NULL);
+}
+static sudoku_field* solve_rec_prop(sudoku_field* f, sudoku_candidates* c, sudoku_solve_ctl* ctl){
+    su_cell_t saved[SUDOKU_CELLS];
+    su_cell_t candidates, cell_test_value;
+    int mark = c->trail_len;
+    int guess_mark;
+    int rc;
+    int best_rc = SUDOKU_NO_EMPTY_CELL;
+    int best_count = SUDOKU_SIZE + 1;
+    int count;
+
+    if(sudoku_solve_stopped(ctl) || propagate_sudoku_candidates(f, c)){
+        undo_sudoku_candidates(f, c, mark);
+        return NULL;
+    }
+    // After propagation every empty cell has at least two candidates.
+    for(rc = 0; rc < SUDOKU_CELLS && best_count > 2; rc++){
+        if(c->cell[rc] == ZERO)
+            continue;
+        count = count_candidates(c->cell[rc]);
+        if(count < best_count){
+            best_rc = rc;
+            best_count = count;
+        }
+    }
+    if(best_rc == SUDOKU_NO_EMPTY_CELL)
+        return f; // Every cell is filled, ie the sudoku is solved.
+
+    memcpy(saved, c->cell, sizeof(saved));
+    guess_mark = c->trail_len;
+    candidates = c->cell[best_rc];
+    while(candidates){
+        cell_test_value = candidates & (~candidates + 1); // Lowest candidate.
+        candidates ^= cell_test_value;
+        place_candidate_lin(f, c, best_rc, cell_test_value); // Can't fail, it's a candidate.
+        SUDOKU_STAT_DOWN();
+        if(solve_rec_prop(f, c, ctl) != NULL){
+            SUDOKU_STAT_UP();
+            return f;
+        }
+        SUDOKU_STAT_UP();
+        SUDOKU_STAT_ADD(backtracks, 1);
+        undo_sudoku_candidates(f, c, guess_mark);
+        memcpy(c->cell, saved, sizeof(saved));
+    }
+    undo_sudoku_candidates(f, c, mark);
+    return NULL;
+}
+/**
+    Counts the solutions of a sudoku, stopping as soon as limit solutions are
+    found. The search is the one of sudoku_solve_rec_prop, which never loses
+    solutions since propagation only places forced values. With a limit of 2
+    the result is one of the SUDOKU_COUNT_ codes, and a puzzle with several
+    solutions is answered as soon as the second one is found. The field is
+    left unchanged.
+
+    @param {sudoku_field*} f - Input sudoku.
+    @param {int} limit - Largest count of interest, at least 1.
+    @param {sudoku_solve_ctl*} ctl - Search control. May be NULL.
+    @return {int} - Number of solutions found, at most limit. May be less than
+                    the true count if the search was stopped.
+*/
+int             sudoku_count_solutions(sudoku_field* f, int limit, sudoku_solve_ctl* ctl){
+    sudoku_candidates c;
+    int count = 0;
+    start_solve_ctl(ctl);
+    init_sudoku_candidates(f, &c);
+    count_rec_prop(f, &c, limit, &count, ctl);
+    return count;
+}
+/**
+    Search of solve_rec_prop that goes on after a solution until count
+    reaches limit. Everything placed is undone before returning.
+*/
+static void count_rec_prop(sudoku_field* f, sudoku_candidates* c, int limit, int* count, sudoku_solve_ctl* ctl){
+    su_cell_t saved[SUDOKU_CELLS];
+    su_cell_t candidates, cell_test_value;
+    int mark = c->trail_len;
+    int guess_mark;
+    int rc;
+    int best_rc = SUDOKU_NO_EMPTY_CELL;
+    int best_count = SUDOKU_SIZE + 1;
+    int count_cand;
+
+    if(sudoku_solve_stopped(ctl) || propagate_sudoku_candidates(f, c)){
+        undo_sudoku_candidates(f, c, mark);
+        return;
+    }
+    for(rc = 0; rc < SUDOKU_CELLS && best_count > 2; rc++){
+        if(c->cell[rc] == ZERO)
+            continue;
+        count_cand = count_candidates(c->cell[rc]);
+        if(count_cand < best_count){
+            best_rc = rc;
+            best_count = count_cand;
+        }
+    }
+    if(best_rc == SUDOKU_NO_EMPTY_CELL){
+        (*count)++;
+        undo_sudoku_candidates(f, c, mark);
+        return;
+    }
+
+    memcpy(saved, c->cell, sizeof(saved));
+    guess_mark = c->trail_len;
+    candidates = c->cell[best_rc];
+    while(candidates && *count < limit){
+        cell_test_value = candidates & (~candidates + 1);
+        candidates ^= cell_test_value;
+        place_candidate_lin(f, c, best_rc, cell_test_value);
+        SUDOKU_STAT_DOWN();
+        count_rec_prop(f, c, limit, count, ctl);
+        SUDOKU_STAT_UP();
+        SUDOKU_STAT_ADD(backtracks, 1);
+        undo_sudoku_candidates(f, c, guess_mark);
+        memcpy(c->cell, saved, sizeof(saved));
+    }
+    undo_sudoku_candidates(f, c, mark);
+}
@@ -1,10 +1,14 @@
 // Sudoku solver support tools
 #include <stdio.h>      // For standard IO
 #include <stdlib.h>     // For standard stuff
-#include <string.h> // memcpy
+#include <string.h> // memcpy, memset
+#ifdef __SSE2__
+#include <emmintrin.h>  // Vectorized parsing
+#endif
 
 
 #include "sudoku_general_tools.h"
+#include "sudoku_kernel.h"
 
 /**
     Supporting functions for the sudoku solver, ie things not needed for the
@@ -13,243 +17,399 @@
 
 
 /**
-    Get a sudoku field from a string or char array. Currently only designed
-    for 9x9 or 16x16 sudokus.
+    Get a sudoku field from a string or char array, in the format of
+    sudoku_read_line.
 
-    @param {char*} s - The input string.
-    @return {sudoku_field} - The return sudoku field.
+    @param {char*} s - The input string, at least SUDOKU_CELLS characters.
+    @return {sudoku_field} - The return sudoku field. NULL if the string has
+                             unknown characters or conflicting clues.
 */
 sudoku_field*    sudoku_from_input(const char* sudoku_str){
-    int rc;
     sudoku_field* ret = alloc_sudoku_field();
-    for(rc = 0; rc < SUDOKU_SIZE*SUDOKU_SIZE; rc++){
-        switch( *(sudoku_str + rc) ){
-            case('0'):
-                set_cell_lin(ret, rc, ZERO);
-              //  printf("Cell %d set to: %x New val: %x \n", rc, ZERO, get_cell_lin(ret, rc));
-                break;
-            case('1'):
-                set_cell_lin(ret, rc, ONE);
-              //  printf("Cell %d set to: %x New val: %x \n", rc, ONE, get_cell_lin(ret, rc));
-                break;
-            case('2'):
-                set_cell_lin(ret, rc, TWO);
-              //  printf("Cell %d set to: %x New val: %x \n", rc, TWO, get_cell_lin(ret, rc));
-                break;
-            case('3'):
-                set_cell_lin(ret, rc, THREE);
-            // printf("Cell %d set to: %x New val: %x \n", rc, THREE, get_cell_lin(ret, rc));
-                break;
-            case('4'):
-                set_cell_lin(ret, rc, FOUR);
-                //printf("Cell %d set to: %x New val: %x \n", rc, FOUR, get_cell_lin(ret, rc));
-                break;
-            case('5'):
-                set_cell_lin(ret, rc, FIVE);
-               // printf("Cell %d set to: %x New val: %x \n", rc, FIVE, get_cell_lin(ret, rc));
-                break;
-            case('6'):
-                set_cell_lin(ret, rc, SIX);
-               // printf("Cell %d set to: %x New val: %x \n", rc, SIX, get_cell_lin(ret, rc));
-                break;
-            case('7'):
-                set_cell_lin(ret, rc, SEVEN);
-               // printf("Cell %d set to: %x New val: %x \n", rc, SEVEN, get_cell_lin(ret, rc));
-                break;
-            case('8'):
-                set_cell_lin(ret, rc, EIGHT);
-               // printf("Cell %d set to: %x New val: %x \n", rc, EIGHT, get_cell_lin(ret, rc));
-                break;
-            case('9'):
-                set_cell_lin(ret, rc, NINE);
-               // printf("Cell %d set to: %x New val: %x \n", rc, NINE, get_cell_lin(ret, rc));
-                break;
-            case('A'):
-                set_cell_lin(ret, rc, TEN);
-               // printf("Cell %d set to: %x New val: %x \n", rc, TEN, get_cell_lin(ret, rc));
-                break;
-            case('B'):
-                set_cell_lin(ret, rc, ELEVEN);
-               // printf("Cell %d set to: %x New val: %x \n", rc, ELEVEN, get_cell_lin(ret, rc));
-                break;
-            case('C'):
-                set_cell_lin(ret, rc, TWELVE);
-               // printf("Cell %d set to: %x New val: %x \n", rc, TWELVE, get_cell_lin(ret, rc));
-                break;
-            case('D'):
-                set_cell_lin(ret, rc, THIRTEEN);
-               // printf("Cell %d set to: %x New val: %x \n", rc, THIRTEEN, get_cell_lin(ret, rc));
-                break;
-            case('E'):
-                set_cell_lin(ret, rc, FOURTEEN);
-               // printf("Cell %d set to: %x New val: %x \n", rc, FOURTEEN, get_cell_lin(ret, rc));
-                break;
-            case('F'):
-                set_cell_lin(ret, rc, FIFTEEN);
-               // printf("Cell %d set to: %x New val: %x \n", rc, FIFTEEN, get_cell_lin(ret, rc));
-                break;
-            default:
-                fprintf(stderr, "Could not read sudoku from input, %d", __LINE__);
-                exit(1);
+    if(sudoku_read_line(ret, sudoku_str) != SUDOKU_LINE_OK){
+        free_sudoku_field(ret);
+        return NULL;
+    }
+    return ret;
+}
+/**
+    Gets the value mask of an input character.
+    @return {int} - 0 if successful. Non-zero if the character is not a value
+                    of this sudoku size.
+*/
+static int parse_char(char ch, su_cell_t* nbr){
+    if(ch == '0' || ch == '.')
+        *nbr = ZERO;
+    else if(ch >= '1' && ch <= '9')
+        *nbr = ONE << (ch - '1');
+    else if(ch >= 'A' && ch <= 'Z' && ch - 'A' + 10 <= SUDOKU_SIZE)
+        *nbr = ONE << (ch - 'A' + 9);
+    else
+        return 1;
+    return *nbr > SUDOKU_ALL_VALUES;
+}
+#if defined(__SSE2__) && SUDOKU_SIZE <= 9
+/**
+    Turns SUDOKU_CELLS input characters into value masks, 16 at a time. The
+    characters are checked with byte compares, widened to 16 bits and turned
+    into masks with one compare per value.
+    @return {int} - 0 if successful. Non-zero on unknown characters.
+*/
+static int parse_masks(const char* line, su_cell_t* masks){
+    const __m128i zero_ch = _mm_set1_epi8('0');
+    const __m128i dot     = _mm_set1_epi8('.');
+    const __m128i top     = _mm_set1_epi8(SUDOKU_SIZE);
+    const __m128i zero    = _mm_setzero_si128();
+    __m128i bad = zero;
+    __m128i ch, is_dot, digit, lo, hi, mask_lo, mask_hi, value, bit;
+    int rc, v;
+    int ret = 0;
+
+    for(rc = 0; rc + 16 <= SUDOKU_CELLS; rc += 16){
+        ch     = _mm_loadu_si128((const __m128i*) (line + rc));
+        is_dot = _mm_cmpeq_epi8(ch, dot);
+        digit  = _mm_sub_epi8(ch, zero_ch); // Wraps below '0', so one unsigned compare finds both ends.
+        bad    = _mm_or_si128(bad, _mm_andnot_si128(is_dot,
+                    _mm_xor_si128(_mm_cmpeq_epi8(_mm_max_epu8(digit, top), top), _mm_set1_epi8(-1))));
+        digit  = _mm_andnot_si128(is_dot, digit);
+        lo = _mm_unpacklo_epi8(digit, zero);
+        hi = _mm_unpackhi_epi8(digit, zero);
+        mask_lo = mask_hi = zero;
+        for(v = 1; v <= SUDOKU_SIZE; v++){
+            value = _mm_set1_epi16(v);
+            bit   = _mm_set1_epi16(ONE << (v - 1));
+            mask_lo = _mm_or_si128(mask_lo, _mm_and_si128(_mm_cmpeq_epi16(lo, value), bit));
+            mask_hi = _mm_or_si128(mask_hi, _mm_and_si128(_mm_cmpeq_epi16(hi, value), bit));
         }
+        _mm_storeu_si128((__m128i*) (masks + rc), mask_lo);
+        _mm_storeu_si128((__m128i*) (masks + rc + 8), mask_hi);
     }
-    print_sudoku_from_field(ret);
+    for(; rc < SUDOKU_CELLS; rc++)
+        ret |= parse_char(line[rc], masks + rc);
+    return ret || _mm_movemask_epi8(bad);
+}
+#else
+/**
+    Turns SUDOKU_CELLS input characters into value masks.
+    @return {int} - 0 if successful. Non-zero on unknown characters.
+*/
+static int parse_masks(const char* line, su_cell_t* masks){
+    int rc;
+    int ret = 0;
+    for(rc = 0; rc < SUDOKU_CELLS; rc++)
+        ret |= parse_char(line[rc], masks + rc);
     return ret;
 }
+#endif
+/**
+    Reads a sudoku from a line of SUDOKU_CELLS characters into an existing
+    field, without printing anything. '0' and '.' are empty cells.
+
+    @param {sudoku_field*} f - The field to read into. Cleared first.
+    @param {char*} line - The input line.
+    @return {int} - SUDOKU_LINE_OK if successful. Non-zero otherwise.
+*/
+int             sudoku_read_line(sudoku_field* f, const char* line){
+    su_cell_t masks[SUDOKU_CELLS];
+    su_cell_t nbr;
+    su_cell_t conflict = ZERO;
+    int r, c, b;
+    int rc = 0;
+
+    clear_sudoku_field(f);
+    if(parse_masks(line, masks))
+        return SUDOKU_LINE_BAD_CHAR;
+    // As set_cell_lin on every cell, without branches. Empty cells add nothing.
+    for(r = 0; r < SUDOKU_SIZE; r++){
+        for(c = 0; c < SUDOKU_SIZE; c++, rc++){
+            nbr = masks[rc];
+            b = (r / SUDOKU_BOX_WIDTH) * SUDOKU_BOX_WIDTH + c / SUDOKU_BOX_WIDTH;
+            conflict |= (*(f->row_contains + r) | *(f->col_contains + c) | *(f->box_contains + b)) & nbr;
+            *(f->row_contains + r) |= nbr;
+            *(f->col_contains + c) |= nbr;
+            *(f->box_contains + b) |= nbr;
+            *(f->field + rc) = nbr;
+        }
+    }
+    if(conflict)
+        return SUDOKU_LINE_CONFLICT;
+    return SUDOKU_LINE_OK;
+}
 /**
-    Allocates the memory for a sudoku field, including the internal arena.
+    Writes a sudoku as SUDOKU_CELLS characters, the same format as read by
+    sudoku_read_line. No line break or terminating null is written.
 
-    @return {sudoku_field*} - A pointer to the new arena.
+    @param {sudoku_field*} f - The field to write.
+    @param {char*} out - Buffer of at least SUDOKU_CELLS characters.
+*/
+void            sudoku_write_line(const sudoku_field* f, char* out){
+    static const char chars[] = SUDOKU_VALUE_CHARS;
+    int rc;
+    su_cell_t cell;
+
+    for(rc = 0; rc < SUDOKU_CELLS; rc++){
+        cell = get_cell_lin(f, rc);
+        out[rc] = chars[cell ? __builtin_ctz(cell) + 1 : 0];
+    }
+}
+/**
+    Allocates a cleared sudoku field. The cells are held inline, so this is
+    a single allocation.
+
+    @return {sudoku_field*} - A pointer to the new field.
 */
 sudoku_field* alloc_sudoku_field(){
-    sudoku_field* ret = malloc( sizeof(sudoku_field) );
+    sudoku_field* ret = calloc(1, sizeof(sudoku_field));
     if(ret == NULL){
         fprintf(stderr, "Could not allocate memory for the sudoku field, %d", __LINE__);
         exit(1);
     }
-
-    alloc_sudoku_field_internal_arena(ret);
     return ret;
 }
 /**
-    Allocates the  internal memory of the sudoku field as a cleared arena.
-
-    @param {sudoku_field*} s - The field to get a new arena.
-    @return {int} - 0 if successful. Non zero otherwise..
+    Clears a sudoku field, ie empties every cell.
+    @param {sudoku_field*} f - The field to clear.
 */
-int alloc_sudoku_field_internal_arena(sudoku_field* s){
-    su_cell_t* tmp;
-    tmp = (su_cell_t*) calloc( 3 * SUDOKU_SIZE + SUDOKU_SIZE * SUDOKU_SIZE
-                                                        ,sizeof(su_cell_t));
-    if(tmp == NULL){
-        fprintf(stderr, "Could not allocate sudoku field memory, %d", __LINE__);
-        exit(1);
-    }
-    s->row_contains    = tmp;
-    s->col_contains    = tmp + 1 * SUDOKU_SIZE;
-    s->box_contains    = tmp + 2 * SUDOKU_SIZE;
-    s->field           = tmp + 3 * SUDOKU_SIZE;
-    return 0;
+void clear_sudoku_field(sudoku_field* f){
+    memset(f, 0, sizeof(sudoku_field));
 }
 /**
     Frees the memory of  a sudoku field.
     @param {sudoku_field*} f - A pointer to the field to be freed.
 */
 void free_sudoku_field(sudoku_field* f){
-    free_sudoku_field_internal_arena(f);
     free(f);
 }
-/**
-    Frees the internal memory of a sudoku field.
-    @param {sudoku_field*} f - A pointer to the field.
-*/
-void free_sudoku_field_internal_arena(sudoku_field* f){
-    free(f->row_contains);
-}
 /**
     Returns a pointer to a complete copy of the input sudoku field.
     @param {sudoku_field*} f - A pointer to the field to be copied.
 */
 sudoku_field* copy_sudoku_field(const sudoku_field* f){
-    sudoku_field* ret = alloc_sudoku_field();
-    memcpy(ret->row_contains, f->row_contains,
-                        (3 * SUDOKU_SIZE + SUDOKU_SIZE * SUDOKU_SIZE)*sizeof(su_cell_t));
+    sudoku_field* ret = malloc(sizeof(sudoku_field));
+    if(ret == NULL){
+        fprintf(stderr, "Could not allocate memory for the sudoku field, %d", __LINE__);
+        exit(1);
+    }
+    *ret = *f;
     return ret;
 }
 
+// Pool
+
 /**
-    This function is supposed to return a string containing the sudoku.
-    IT DOES NOT CURRENTLY DO THAT.
+    A field padded to a whole number of cache lines.
+*/
+typedef union pool_slot pool_slot;
+union pool_slot {
+    sudoku_field field;
+    unsigned char pad[(sizeof(sudoku_field) + SUDOKU_CACHE_LINE - 1) / SUDOKU_CACHE_LINE * SUDOKU_CACHE_LINE];
+};
+struct sudoku_field_pool {
+    pool_slot* slab;
+    sudoku_field** free_fields; // Stack of the fields not taken.
+    int n_free;
+};
+
+/**
+    Allocates a pool of fields in one contiguous slab. Every field starts on
+    its own cache line, so fields used by different threads never share one.
+    A pool is not thread safe, take the fields before handing them out.
 
-    @param {sudoku_field*} f - A pointer to the field.s
-    @return {char*} - A string containing the sudoku.
+    @param {int} capacity - Number of fields in the pool.
+    @return {sudoku_field_pool*} - A pointer to the new pool.
 */
-char*           sudoku_to_string(sudoku_field* f){
-    return "Function not yet implemented.";
+sudoku_field_pool* alloc_sudoku_field_pool(int capacity){
+    sudoku_field_pool* ret = malloc(sizeof(sudoku_field_pool));
+    int i;
+
+    if(ret == NULL){
+        fprintf(stderr, "Could not allocate memory for the field pool, %d", __LINE__);
+        exit(1);
+    }
+    ret->slab = aligned_alloc(SUDOKU_CACHE_LINE, capacity * sizeof(pool_slot));
+    ret->free_fields = malloc(capacity * sizeof(sudoku_field*));
+    if(ret->slab == NULL || ret->free_fields == NULL){
+        fprintf(stderr, "Could not allocate memory for the field pool, %d", __LINE__);
+        exit(1);
+    }
+    // Handed out from the start of the slab.
+    for(i = 0; i < capacity; i++)
+        ret->free_fields[i] = &ret->slab[capacity - 1 - i].field;
+    ret->n_free = capacity;
+    return ret;
+}
+/**
+    Takes a cleared field from a pool.
+    @param {sudoku_field_pool*} pool - The pool.
+    @return {sudoku_field*} - A pointer to the field. NULL if the pool is empty.
+*/
+sudoku_field* take_sudoku_field(sudoku_field_pool* pool){
+    sudoku_field* ret;
+    if(pool->n_free == 0)
+        return NULL;
+    ret = pool->free_fields[--pool->n_free];
+    clear_sudoku_field(ret);
+    return ret;
+}
+/**
+    Gives a field back to the pool it was taken from, to be taken again.
+    Pools that take their fields once, as the batch pools do, needn't give
+    them back: free_sudoku_field_pool frees taken fields as well.
+    @param {sudoku_field_pool*} pool - The pool.
+    @param {sudoku_field*} f - The field.
+*/
+void give_sudoku_field(sudoku_field_pool* pool, sudoku_field* f){
+    pool->free_fields[pool->n_free++] = f;
+}
+/**
+    Frees a pool and every field in it, taken or not.
+    @param {sudoku_field_pool*} pool - The pool to free.
+*/
+void free_sudoku_field_pool(sudoku_field_pool* pool){
+    free(pool->slab);
+    free(pool->free_fields);
+    free(pool);
 }
 
 /**
-    This function is supposed check wether or not a sudoku is valid before even
-    trying to complete it. IT DOES NOT CURRENTLY DO THAT.
-    However if the sudoku is constructed using the
-    set_cell-functions it will be a correct sudoku.
+    Gets the character of a cell: '0' when empty, 'X' when it holds more than
+    one value. A table lookup on the lowest bit replaces a switch per value.
+*/
+static char cell_to_char(su_cell_t cell){
+    static const char chars[] = SUDOKU_VALUE_CHARS;
+    return cell & (cell - 1) ? 'X' : chars[cell ? __builtin_ctz(cell) + 1 : 0];
+}
+/**
+    Writes a sudoku as text into a buffer, ending with a line break and a
+    terminating null. Nothing is allocated, so many sudokus can be written
+    one after the other into one buffer and printed at once. Empty cells are
+    written as '0' and cells holding more than one value as 'X'.
+
+    @param {sudoku_field*} f - The field to write.
+    @param {int} format - A SUDOKU_FORMAT_.
+    @param {char*} out - Buffer of at least SUDOKU_STRING_MAX characters.
+    @return {size_t} - Number of characters written, without the null. 0 for
+                       an unknown format.
+*/
+size_t          sudoku_to_string(const sudoku_field* f, int format, char* out){
+    char* p = out;
+    char* row = out;
+    int r, c, i;
+
+    switch(format){
+        case(SUDOKU_FORMAT_LINE):
+            for(i = 0; i < SUDOKU_CELLS; i++)
+                *p++ = cell_to_char(get_cell_lin(f, i));
+            *p++ = '\n';
+            break;
+        case(SUDOKU_FORMAT_ROWS):
+            for(r = 0, i = 0; r < SUDOKU_SIZE; r++){
+                *p++ = ' ';
+                for(c = 0; c < SUDOKU_SIZE; c++)
+                    *p++ = cell_to_char(get_cell_lin(f, i++));
+                *p++ = '\n';
+            }
+            break;
+        case(SUDOKU_FORMAT_GRID):
+            for(r = 0, i = 0; r < SUDOKU_SIZE; r++){
+                if(r > 0 && r % SUDOKU_BOX_WIDTH == 0){
+                    // The separator follows the row above: '+' under every '|'.
+                    for(c = 0; c < SUDOKU_GRID_WIDTH; c++)
+                        p[c] = row[c] == '|' ? '+' : '-';
+                    p[SUDOKU_GRID_WIDTH] = '\n';
+                    p += SUDOKU_GRID_WIDTH + 1;
+                }
+                row = p;
+                for(c = 0; c < SUDOKU_SIZE; c++){
+                    if(c > 0 && c % SUDOKU_BOX_WIDTH == 0){
+                        *p++ = ' ';
+                        *p++ = '|';
+                    }
+                    if(c > 0)
+                        *p++ = ' ';
+                    *p++ = cell_to_char(get_cell_lin(f, i++));
+                }
+                *p++ = '\n';
+            }
+            break;
+        default:
+            return 0;
+    }
+    *p = '\0';
+    return p - out;
+}
+
+/**
+    Checks that a sudoku is consistent before trying to complete it: every
+    cell is empty or holds one value, no row, column or box holds a value
+    twice, the row, column and box masks match the cells, every empty cell
+    has a candidate left and every value missing from a row, column or box
+    has a cell left to go in. A field passing this may still be unsolvable,
+    but one failing it is never solvable.
 
-    @param {sudoku_field*} f - A pointer to the field.s
-    @return {int} - 1 if seemingly valid, 0 otherwise.
+    @param {sudoku_field*} f - A pointer to the field.
+    @return {int} - 1 if valid, 0 otherwise.
 */
 int          sudoku_valid(const sudoku_field* f){
+    su_cell_t rows[SUDOKU_SIZE] = {ZERO};
+    su_cell_t cols[SUDOKU_SIZE] = {ZERO};
+    su_cell_t boxes[SUDOKU_SIZE] = {ZERO};
+    su_cell_t row_cand[SUDOKU_SIZE] = {ZERO};
+    su_cell_t col_cand[SUDOKU_SIZE] = {ZERO};
+    su_cell_t box_cand[SUDOKU_SIZE] = {ZERO};
+    su_cell_t bad = ZERO;
+    su_cell_t nbr, cand;
+    int r, c, b, i;
+    int rc = 0;
+
+    // As sudoku_read_line, collecting every problem without branches.
+    for(r = 0; r < SUDOKU_SIZE; r++){
+        for(c = 0; c < SUDOKU_SIZE; c++, rc++){
+            nbr = *(f->field + rc);
+            b = r_and_c_to_b(r, c);
+            bad |= (nbr & (nbr - 1)) | (nbr & ~SUDOKU_ALL_VALUES);
+            bad |= (rows[r] | cols[c] | boxes[b]) & nbr;
+            rows[r]  |= nbr;
+            cols[c]  |= nbr;
+            boxes[b] |= nbr;
+        }
+    }
+    for(i = 0; i < SUDOKU_SIZE; i++)
+        bad |= (rows[i] ^ *(f->row_contains + i)) | (cols[i] ^ *(f->col_contains + i))
+                    | (boxes[i] ^ *(f->box_contains + i));
+    if(bad)
+        return 0;
+    rc = 0;
+    for(r = 0; r < SUDOKU_SIZE; r++){
+        for(c = 0; c < SUDOKU_SIZE; c++, rc++){
+            if(*(f->field + rc))
+                continue;
+            b = r_and_c_to_b(r, c);
+            cand = ~(rows[r] | cols[c] | boxes[b]) & SUDOKU_ALL_VALUES;
+            if(cand == ZERO)
+                return 0;
+            row_cand[r] |= cand;
+            col_cand[c] |= cand;
+            box_cand[b] |= cand;
+        }
+    }
+    for(i = 0; i < SUDOKU_SIZE; i++)
+        if((row_cand[i] | rows[i]) != SUDOKU_ALL_VALUES || (col_cand[i] | cols[i]) != SUDOKU_ALL_VALUES
+                    || (box_cand[i] | boxes[i]) != SUDOKU_ALL_VALUES)
+            return 0;
     return 1;
 }
 
 /**
-    Print a sudoku field. Currently only designed for 9x9 or 16x16 sudokus.
+    Print a sudoku field, one row per line, with a single write to stdout.
 
     @param {sudoku_field} s - The sudoku field to be printed.
     @return {int} - 0 if successful. Non zero otherwise.
 */
 int print_sudoku_from_field(const sudoku_field* s){
-    su_rcb_t r;
-    su_rcb_t c;
+    char out[SUDOKU_STRING_MAX];
+    size_t len = sudoku_to_string(s, SUDOKU_FORMAT_ROWS, out);
 
     printf("Printing sudoku:\n");
-    for(r = 0; r < SUDOKU_SIZE; r++){ // Sudoku size should maybe be switched to a flag instead of a define.
-        printf(" ");// Change of line come after the next for-loop.
-        for(c = 0; c < SUDOKU_SIZE; c++){
-          //  printf("\nRC: %d R: %d C:%d Cell val: %x ", r_and_c_to_rc(r, c),r, c, *(s->field + r_and_c_to_rc(r,c))); // DEBUG
-            switch( get_cell(s, r, c) ){
-                case(ZERO):
-                    printf("0");
-                    break;
-                case(ONE):
-                    printf("1");
-                    break;
-                case(TWO):
-                    printf("2");
-                    break;
-                case(THREE):
-                    printf("3");
-                    break;
-                case(FOUR):
-                    printf("4");
-                    break;
-                case(FIVE):
-                    printf("5");
-                    break;
-                case(SIX):
-                    printf("6");
-                    break;
-                case(SEVEN):
-                    printf("7");
-                    break;
-                case(EIGHT):
-                    printf("8");
-                    break;
-                case(NINE):
-                    printf("9");
-                    break;
-                case(TEN):
-                    printf("A");
-                    break;
-                case(ELEVEN):
-                    printf("B");
-                    break;
-                case(TWELVE):
-                    printf("C");
-                    break;
-                case(THIRTEEN):
-                    printf("D");
-                    break;
-                case(FOURTEEN):
-                    printf("E");
-                    break;
-                case(FIFTEEN):
-                    printf("F");
-                    break;
-                default:
-                    printf("X");
-            }
-        }
-        printf("\n");
-    }
-    return 0;
+    return fwrite(out, 1, len, stdout) != len;
 }
@@ -0,0 +1,176 @@
+// Sudoku solution verification
+#include <string.h>     // memcpy, memset
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>  // SSSE3 intrinsics
+#define VERIFY_X86 (1)
+#endif
+
+#include "sudoku_general_tools.h"
+#include "sudoku_verify.h"
+
+/**
+    Verification of solved grids, see sudoku_verify.h.
+
+    The vectorized check keeps one row per register as 16-bit value masks,
+    made from the characters with two byte table lookups: one for the values
+    1..8 and one for 9. Every cell holding one value, a unit is valid exactly
+    when the OR of its masks has all SUDOKU_SIZE bits set, so rows, columns
+    and boxes are all checked with ORs and one compare at the end.
+*/
+
+#if defined(VERIFY_X86) && SUDOKU_SIZE == 9
+#define VERIFY_SSSE3 (1)
+#endif
+
+/**
+    Checks that a valid grid keeps the clues of its puzzle, from cell rc on.
+*/
+static int verify_clues(const char* grid, const char* puzzle, int rc){
+    for(; rc < SUDOKU_CELLS; rc++)
+        if(puzzle[rc] != '0' && puzzle[rc] != '.' && puzzle[rc] != grid[rc])
+            return SUDOKU_VERIFY_MISMATCH;
+    return SUDOKU_VERIFY_OK;
+}
+/**
+    Scalar check of a grid. Same result as the vectorized check.
+*/
+static int verify_scalar(const char* grid, const char* puzzle){
+    su_cell_t rows[SUDOKU_SIZE] = {ZERO};
+    su_cell_t cols[SUDOKU_SIZE] = {ZERO};
+    su_cell_t boxes[SUDOKU_SIZE] = {ZERO};
+    su_cell_t all = SUDOKU_ALL_VALUES;
+    int r, c, v;
+
+    for(r = 0; r < SUDOKU_SIZE; r++)
+        for(c = 0; c < SUDOKU_SIZE; c++){
+            v = grid[r * SUDOKU_SIZE + c] - '0';
+            if(v < 1 || v > SUDOKU_SIZE)
+                return SUDOKU_VERIFY_INVALID;
+            rows[r] |= ONE << (v - 1);
+            cols[c] |= ONE << (v - 1);
+            boxes[r_and_c_to_b(r, c)] |= ONE << (v - 1);
+        }
+    for(r = 0; r < SUDOKU_SIZE; r++)
+        all &= rows[r] & cols[r] & boxes[r];
+    if(all != SUDOKU_ALL_VALUES)
+        return SUDOKU_VERIFY_INVALID;
+    return puzzle != NULL ? verify_clues(grid, puzzle, 0) : SUDOKU_VERIFY_OK;
+}
+
+#ifdef VERIFY_SSSE3
+/**
+    Vectorized check of a 9x9 grid. See the top of the file.
+*/
+__attribute__((target("ssse3")))
+static int verify_ssse3(const char* grid, const char* puzzle){
+    const __m128i one_ch = _mm_set1_epi8('1');
+    const __m128i eight  = _mm_set1_epi8(8);
+    const __m128i tab_lo = _mm_setr_epi8(1, 2, 4, 8, 16, 32, 64, (char) 128, 0, 0, 0, 0, 0, 0, 0, 0);
+    const __m128i tab_hi = _mm_setr_epi8(0, 0, 0, 0, 0, 0, 0, 0, 1, 0, 0, 0, 0, 0, 0, 0);
+    const __m128i cells  = _mm_setr_epi8(-1, -1, -1, -1, -1, -1, -1, -1, -1, 0, 0, 0, 0, 0, 0, 0);
+    const __m128i all    = _mm_set1_epi16(SUDOKU_ALL_VALUES);
+    const __m128i box_lanes = _mm_setr_epi16(-1, 0, 0, -1, 0, 0, -1, 0);
+    char buf[SUDOKU_CELLS + 16];    // Room to load the last row as 16 bytes.
+    __m128i bad = _mm_setzero_si128();
+    __m128i col_lo = _mm_setzero_si128(), col_hi = _mm_setzero_si128();
+    __m128i band_lo = _mm_setzero_si128(), band_hi = _mm_setzero_si128();
+    __m128i row_all = all, box_all = all;
+    __m128i ch, digit, lo, hi, x;
+    int r, rc;
+
+    memcpy(buf, grid, SUDOKU_CELLS);
+    memset(buf + SUDOKU_CELLS, '1', 16);
+    for(r = 0; r < SUDOKU_SIZE; r++){
+        ch    = _mm_loadu_si128((const __m128i*) (buf + r * SUDOKU_SIZE));
+        digit = _mm_sub_epi8(ch, one_ch); // Wraps below '1', so one unsigned compare finds both ends.
+        bad   = _mm_or_si128(bad, _mm_andnot_si128(_mm_cmpeq_epi8(_mm_max_epu8(digit, eight), eight), cells));
+        digit = _mm_and_si128(digit, cells);
+        // 16-bit masks of columns 0..7, and of column 8 in lane 0 of hi.
+        x  = _mm_and_si128(_mm_shuffle_epi8(tab_lo, digit), cells);
+        ch = _mm_and_si128(_mm_shuffle_epi8(tab_hi, digit), cells);
+        lo = _mm_unpacklo_epi8(x, ch);
+        hi = _mm_and_si128(_mm_unpackhi_epi8(x, ch), _mm_cvtsi32_si128(0xFFFF));
+        col_lo  = _mm_or_si128(col_lo, lo);
+        col_hi  = _mm_or_si128(col_hi, hi);
+        band_lo = _mm_or_si128(band_lo, lo);
+        band_hi = _mm_or_si128(band_hi, hi);
+        // The row in lane 0.
+        x = _mm_or_si128(lo, _mm_srli_si128(lo, 8));
+        x = _mm_or_si128(x, _mm_srli_si128(x, 4));
+        x = _mm_or_si128(x, _mm_srli_si128(x, 2));
+        row_all = _mm_and_si128(row_all, _mm_or_si128(x, hi));
+        if(r % SUDOKU_BOX_WIDTH == SUDOKU_BOX_WIDTH - 1){
+            // Boxes in lanes 0, 3 and 6, the last one with column 8 moved in.
+            x = _mm_or_si128(band_lo, _mm_srli_si128(band_lo, 2));
+            x = _mm_or_si128(x, _mm_srli_si128(band_lo, 4));
+            x = _mm_or_si128(x, _mm_slli_si128(band_hi, 12));
+            box_all = _mm_and_si128(box_all, _mm_or_si128(x, _mm_andnot_si128(box_lanes, all)));
+            band_lo = band_hi = _mm_setzero_si128();
+        }
+    }
+    // Columns 0..7 in every lane of col_lo, column 8 and the rows in lane 0
+    // of col_hi and row_all, the boxes in box_all with its other lanes set.
+    x = _mm_or_si128(_mm_and_si128(col_hi, row_all), _mm_slli_si128(all, 2));
+    x = _mm_and_si128(x, _mm_and_si128(col_lo, box_all));
+    if(_mm_movemask_epi8(bad) || _mm_movemask_epi8(_mm_cmpeq_epi16(x, all)) != 0xFFFF)
+        return SUDOKU_VERIFY_INVALID;
+    if(puzzle == NULL)
+        return SUDOKU_VERIFY_OK;
+    for(rc = 0; rc + 16 <= SUDOKU_CELLS; rc += 16){
+        ch = _mm_loadu_si128((const __m128i*) (puzzle + rc));
+        x  = _mm_or_si128(_mm_cmpeq_epi8(ch, _mm_set1_epi8('0')), _mm_cmpeq_epi8(ch, _mm_set1_epi8('.')));
+        x  = _mm_or_si128(x, _mm_cmpeq_epi8(ch, _mm_loadu_si128((const __m128i*) (buf + rc))));
+        if(_mm_movemask_epi8(x) != 0xFFFF)
+            return SUDOKU_VERIFY_MISMATCH;
+    }
+    return verify_clues(grid, puzzle, rc);
+}
+#endif
+
+/**
+    Verifies a single grid.
+
+    @param {char*} grid - The grid, SUDOKU_CELLS characters.
+    @param {char*} puzzle - Its puzzle, in the format of sudoku_read_line. May
+                            be NULL to only check the grid.
+    @return {int} - A SUDOKU_VERIFY_ outcome.
+*/
+int             sudoku_verify_grid(const char* grid, const char* puzzle){
+#ifdef VERIFY_SSSE3
+    if(__builtin_cpu_supports("ssse3"))
+        return verify_ssse3(grid, puzzle);
+#endif
+    return verify_scalar(grid, puzzle);
+}
+/**
+    Verifies n grids. Grid i starts at grids + i*stride and its puzzle at
+    puzzles + i*puzzle_stride, so newline separated buffers can be used as
+    they are (stride SUDOKU_CELLS + 1).
+
+    @param {char*} grids - The grids.
+    @param {size_t} stride - Distance between grids, at least SUDOKU_CELLS.
+    @param {char*} puzzles - The puzzles. May be NULL to only check the grids.
+    @param {size_t} puzzle_stride - Distance between puzzles.
+    @param {long} n - Number of grids.
+    @param {unsigned char*} outcome - Buffer of n outcomes. May be NULL.
+    @return {long} - Number of grids with outcome SUDOKU_VERIFY_OK.
+*/
+long            sudoku_verify_grids(const char* grids, size_t stride, const char* puzzles,
+                                    size_t puzzle_stride, long n, unsigned char* outcome){
+    int (*verify)(const char*, const char*) = verify_scalar;
+    long i, ok = 0;
+    int ret;
+
+#ifdef VERIFY_SSSE3
+    if(__builtin_cpu_supports("ssse3"))
+        verify = verify_ssse3;
+#endif
+    for(i = 0; i < n; i++){
+        ret = verify(grids + i * stride, puzzles != NULL ? puzzles + i * puzzle_stride : NULL);
+        ok += ret == SUDOKU_VERIFY_OK;
+        if(outcome != NULL)
+            outcome[i] = ret;
+    }
+    return ok;
+}
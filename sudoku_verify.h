@@ -0,0 +1,48 @@
+#ifndef SUDOKU_VERIFY_H_INCLUDED
+#define SUDOKU_VERIFY_H_INCLUDED
+
+#include <stddef.h>     // size_t
+
+#include "sudoku_general_tools.h"
+
+/**
+    Verification of solved grids, SUDOKU_CELLS characters '1'.. without line
+    break. A grid is valid if every cell holds a value and no row, column or
+    box holds a value twice. Given its puzzle, a valid grid must also keep
+    every clue. Like sudoku_lib.h, nothing here prints, exits or allocates.
+
+    9x9 grids are checked one row per register on CPUs with SSSE3, every
+    other size and CPU with the scalar check.
+*/
+
+// Outcomes of a verification.
+#define SUDOKU_VERIFY_OK        (0)
+#define SUDOKU_VERIFY_INVALID   (1) // An unknown or empty cell, or a value twice in a unit.
+#define SUDOKU_VERIFY_MISMATCH  (2) // A valid grid that changes a clue of its puzzle.
+
+/**
+    Verifies a single grid.
+
+    @param {char*} grid - The grid, SUDOKU_CELLS characters.
+    @param {char*} puzzle - Its puzzle, in the format of sudoku_read_line. May
+                            be NULL to only check the grid.
+    @return {int} - A SUDOKU_VERIFY_ outcome.
+*/
+int             sudoku_verify_grid(const char* grid, const char* puzzle);
+/**
+    Verifies n grids. Grid i starts at grids + i*stride and its puzzle at
+    puzzles + i*puzzle_stride, so newline separated buffers can be used as
+    they are (stride SUDOKU_CELLS + 1).
+
+    @param {char*} grids - The grids.
+    @param {size_t} stride - Distance between grids, at least SUDOKU_CELLS.
+    @param {char*} puzzles - The puzzles. May be NULL to only check the grids.
+    @param {size_t} puzzle_stride - Distance between puzzles.
+    @param {long} n - Number of grids.
+    @param {unsigned char*} outcome - Buffer of n outcomes. May be NULL.
+    @return {long} - Number of grids with outcome SUDOKU_VERIFY_OK.
+*/
+long            sudoku_verify_grids(const char* grids, size_t stride, const char* puzzles,
+                                    size_t puzzle_stride, long n, unsigned char* outcome);
+
+#endif // SUDOKU_VERIFY_H_INCLUDED